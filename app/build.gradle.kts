@@ -22,7 +22,7 @@ android {
 
         externalNativeBuild {
             cmake {
-                cppFlags += listOf("-std=c++14", "-frtti", "-fexceptions")
+                cppFlags += listOf("-std=c++17", "-frtti", "-fexceptions")
                 arguments += listOf(
                     "-DANDROID_STL=c++_shared",
                     "-DOpenCV_DIR=\${project.rootDir}/../opencv-sdk/native/jni"
@@ -0,0 +1,170 @@
+#include "edge_polylines.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+// Chains with fewer pixels are dropped as noise
+const size_t kMinChainPixels = 3;
+
+// Neighbour steps, 4-connected first so staircases are followed pixel by pixel
+const int kSteps[8][2] = {
+        {1, 0}, {0, 1}, {-1, 0}, {0, -1}, {1, 1}, {-1, 1}, {-1, -1}, {1, -1}
+};
+
+/**
+ * Walk unvisited edge pixels from p until the chain ends, appending them
+ */
+void follow(const cv::Mat& edges, cv::Mat& visited, cv::Point p,
+            std::vector<cv::Point>& chain) {
+    for (;;) {
+        bool moved = false;
+        for (const auto& step : kSteps) {
+            int x = p.x + step[0];
+            int y = p.y + step[1];
+            if (x < 0 || y < 0 || x >= edges.cols || y >= edges.rows) {
+                continue;
+            }
+            uint8_t& seen = visited.ptr<uint8_t>(y)[x];
+            if (!edges.ptr<uint8_t>(y)[x] || seen) {
+                continue;
+            }
+            seen = 1;
+            p = cv::Point(x, y);
+            chain.push_back(p);
+            moved = true;
+            break;
+        }
+        if (!moved) {
+            return;
+        }
+    }
+}
+
+// Squared distance of p from the line through a and b (from a if they coincide)
+double distanceSquared(const cv::Point& p, const cv::Point& a, const cv::Point& b) {
+    double dx = b.x - a.x;
+    double dy = b.y - a.y;
+    double px = p.x - a.x;
+    double py = p.y - a.y;
+    double length = dx * dx + dy * dy;
+    if (length == 0.0) {
+        return px * px + py * py;
+    }
+    double cross = px * dy - py * dx;
+    return cross * cross / length;
+}
+
+/**
+ * Append the Douglas-Peucker vertices of a chain
+ * Ranges are split on an explicit stack, left half on top, so vertices come
+ * out in chain order without recursion.
+ * @return false if they did not fit in maxFloats
+ */
+bool simplify(const std::vector<cv::Point>& chain, double tolerance, size_t maxFloats,
+              std::vector<std::pair<int, int>>& ranges, std::vector<float>& vertices) {
+    auto append = [&](const cv::Point& p) {
+        if (vertices.size() + 2 > maxFloats) {
+            return false;
+        }
+        vertices.push_back(static_cast<float>(p.x));
+        vertices.push_back(static_cast<float>(p.y));
+        return true;
+    };
+
+    double limit = tolerance * tolerance;
+    int last = static_cast<int>(chain.size()) - 1;
+    ranges.assign(1, std::make_pair(0, last));
+    while (!ranges.empty()) {
+        std::pair<int, int> range = ranges.back();
+        ranges.pop_back();
+
+        int split = -1;
+        double farthest = limit;
+        for (int i = range.first + 1; i < range.second; ++i) {
+            double d = distanceSquared(chain[i], chain[range.first], chain[range.second]);
+            if (d > farthest) {
+                farthest = d;
+                split = i;
+            }
+        }
+
+        if (split < 0) {
+            if (!append(chain[range.first])) {
+                return false;
+            }
+        } else {
+            ranges.emplace_back(split, range.second);
+            ranges.emplace_back(range.first, split);
+        }
+    }
+    return append(chain[last]);
+}
+
+} // namespace
+
+void traceEdgePolylines(const cv::Mat& edges, cv::Mat& visited, double tolerance,
+                        int maxVertices, PolylineScratch& scratch, PolylineSet& polylines) {
+    CV_Assert(edges.type() == CV_8UC1 && visited.type() == CV_8UC1);
+    CV_Assert(visited.rows == edges.rows && visited.cols == edges.cols);
+
+    // Capacity is reserved once per limit; later frames reuse it
+    size_t maxFloats = 2 * static_cast<size_t>(std::max(maxVertices, 0));
+    polylines.vertices.clear();
+    polylines.vertices.reserve(maxFloats);
+    polylines.offsets.clear();
+    polylines.offsets.reserve(maxFloats / 4 + 1);  // At least two vertices each
+    polylines.offsets.push_back(0);
+    polylines.truncated = false;
+
+    for (int y = 0; y < visited.rows; ++y) {
+        std::memset(visited.ptr<uint8_t>(y), 0, visited.cols);
+    }
+
+    std::vector<cv::Point>& chain = scratch.chain;
+    std::vector<cv::Point>& backward = scratch.backward;
+    for (int y = 0; y < edges.rows; ++y) {
+        const uint8_t* row = edges.ptr<uint8_t>(y);
+        uint8_t* seen = visited.ptr<uint8_t>(y);
+        for (int x = 0; x < edges.cols; ++x) {
+            if (!row[x] || seen[x]) {
+                continue;
+            }
+            seen[x] = 1;
+
+            // Both directions from the seed, joined into one chain
+            cv::Point seed(x, y);
+            chain.assign(1, seed);
+            follow(edges, visited, seed, chain);
+            backward.clear();
+            follow(edges, visited, seed, backward);
+            if (!backward.empty()) {
+                std::reverse(backward.begin(), backward.end());
+                backward.insert(backward.end(), chain.begin(), chain.end());
+                std::swap(chain, backward);
+            }
+            if (chain.size() < kMinChainPixels) {
+                continue;
+            }
+
+            // Close loops whose ends touch
+            cv::Point first = chain.front();
+            cv::Point end = chain.back();
+            if (chain.size() > 3 && std::abs(first.x - end.x) <= 1 &&
+                std::abs(first.y - end.y) <= 1) {
+                chain.push_back(first);
+            }
+
+            size_t mark = polylines.vertices.size();
+            if (!simplify(chain, tolerance, maxFloats, scratch.ranges, polylines.vertices)) {
+                // Out of capacity: keep what fits and drop the rest of the frame
+                polylines.vertices.resize(mark);
+                polylines.truncated = true;
+                return;
+            }
+            polylines.offsets.push_back(static_cast<int32_t>(polylines.vertices.size() / 2));
+        }
+    }
+}
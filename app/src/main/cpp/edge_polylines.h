@@ -0,0 +1,54 @@
+#ifndef EDGE_POLYLINES_H
+#define EDGE_POLYLINES_H
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * Vector output for edge maps
+ *
+ * Connected chains of edge pixels are traced into polylines and simplified
+ * with Douglas-Peucker, which turns a frame of mask pixels into a few
+ * kilobytes of geometry. Output goes to flat arrays with a fixed capacity:
+ * once the vertex limit is reached the remaining chains are dropped, so a
+ * frame never needs more memory than its limit.
+ */
+
+/**
+ * Polylines in flat arrays
+ * Polyline i is the vertices offsets[i] .. offsets[i + 1] - 1, stored as
+ * x, y pairs in vertices. Closed chains repeat their first vertex.
+ */
+struct PolylineSet {
+    std::vector<float> vertices;    // x, y per vertex
+    std::vector<int32_t> offsets;   // First vertex of each polyline, then the vertex count
+    bool truncated = false;         // Chains were dropped at the vertex limit
+
+    int count() const { return offsets.empty() ? 0 : static_cast<int>(offsets.size()) - 1; }
+    int vertexCount() const { return static_cast<int>(vertices.size() / 2); }
+};
+
+/**
+ * Working memory reused across frames (grows to the longest chain seen)
+ */
+struct PolylineScratch {
+    std::vector<cv::Point> chain;
+    std::vector<cv::Point> backward;
+    std::vector<std::pair<int, int>> ranges;
+};
+
+/**
+ * Trace and simplify the edge chains of a mask
+ * @param edges CV_8UC1 edge mask (non-zero = edge)
+ * @param visited CV_8UC1 image of the same size, overwritten
+ * @param tolerance Douglas-Peucker tolerance in pixels (0 keeps every corner)
+ * @param maxVertices Vertex capacity of the output
+ * @param scratch Working memory
+ * @param polylines Receives the polylines in the mask's pixel coordinates
+ */
+void traceEdgePolylines(const cv::Mat& edges, cv::Mat& visited, double tolerance,
+                        int maxVertices, PolylineScratch& scratch, PolylineSet& polylines);
+
+#endif // EDGE_POLYLINES_H
@@ -0,0 +1,480 @@
+#include "edge_stream.h"
+
+#include <algorithm>
+#include <cstring>
+
+#define LOG_TAG "EdgeStream"
+#include "native_log.h"
+
+namespace {
+
+const char kMagic[4] = {'E', 'D', 'G', 'S'};
+const char kIndexMagic[4] = {'E', 'D', 'G', 'I'};
+const uint16_t kVersion = 1;
+
+const uint8_t kKeyframe = 0;
+const uint8_t kDelta = 1;
+
+const size_t kHeaderBytes = 20;
+const size_t kFrameHeaderBytes = 8;
+const size_t kIndexEntryBytes = 16;
+const size_t kFooterBytes = 16;
+
+// Zero bytes inside a literal run shorter than this stay literals
+const size_t kMinZeroRun = 2;
+
+template <typename T>
+void put(uint8_t*& out, T value) {
+    std::memcpy(out, &value, sizeof(T));
+    out += sizeof(T);
+}
+
+template <typename T>
+T get(const uint8_t*& in) {
+    T value;
+    std::memcpy(&value, in, sizeof(T));
+    in += sizeof(T);
+    return value;
+}
+
+void putVarint(std::vector<uint8_t>& out, size_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+bool getVarint(const uint8_t*& in, const uint8_t* end, size_t& value) {
+    value = 0;
+    for (int shift = 0; in < end && shift < 64; shift += 7) {
+        uint8_t byte = *in++;
+        value |= static_cast<size_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Length of the run of zero bytes in a ^ b starting at i
+size_t zeroRun(const uint8_t* a, const uint8_t* b, size_t i, size_t n) {
+    size_t start = i;
+    while (i + 8 <= n) {
+        uint64_t x;
+        uint64_t y;
+        std::memcpy(&x, a + i, 8);
+        std::memcpy(&y, b + i, 8);
+        if (x != y) {
+            break;
+        }
+        i += 8;
+    }
+    while (i < n && a[i] == b[i]) {
+        ++i;
+    }
+    return i - start;
+}
+
+/**
+ * Pack one row: bit 7 of byte 0 is pixel 0
+ */
+void packRow(const uint8_t* pixels, int pixelStride, int width, uint8_t* out) {
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const uint8_t* p = pixels + x * pixelStride;
+        *out++ = static_cast<uint8_t>((p[0] ? 0x80 : 0) |
+                                      (p[pixelStride] ? 0x40 : 0) |
+                                      (p[2 * pixelStride] ? 0x20 : 0) |
+                                      (p[3 * pixelStride] ? 0x10 : 0) |
+                                      (p[4 * pixelStride] ? 0x08 : 0) |
+                                      (p[5 * pixelStride] ? 0x04 : 0) |
+                                      (p[6 * pixelStride] ? 0x02 : 0) |
+                                      (p[7 * pixelStride] ? 0x01 : 0));
+    }
+
+    if (x < width) {
+        uint8_t last = 0;
+        for (int bit = 0; x < width; ++x, ++bit) {
+            if (pixels[x * pixelStride]) {
+                last |= static_cast<uint8_t>(0x80 >> bit);
+            }
+        }
+        *out = last;
+    }
+}
+
+/**
+ * Eight output bytes (0 / 255) for every packed byte value
+ */
+struct UnpackTable {
+    uint64_t expanded[256];
+
+    UnpackTable() {
+        for (int value = 0; value < 256; ++value) {
+            uint8_t bytes[8];
+            for (int bit = 0; bit < 8; ++bit) {
+                bytes[bit] = (value & (0x80 >> bit)) ? 255 : 0;
+            }
+            std::memcpy(&expanded[value], bytes, 8);
+        }
+    }
+};
+
+void unpackRow(const uint8_t* packed, int width, uint8_t* out) {
+    static const UnpackTable table;
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        std::memcpy(out + x, &table.expanded[*packed++], 8);
+    }
+    for (int bit = 0; x < width; ++x, ++bit) {
+        out[x] = (*packed & (0x80 >> bit)) ? 255 : 0;
+    }
+}
+
+} // namespace
+
+EdgeStreamWriter::EdgeStreamWriter()
+        : file(nullptr)
+        , width(0)
+        , height(0)
+        , keyframeInterval(0)
+        , rowBytes(0)
+        , failed(false)
+        , offset(0) {
+}
+
+EdgeStreamWriter::~EdgeStreamWriter() {
+    close();
+}
+
+bool EdgeStreamWriter::open(const std::string& path, int frameWidth, int frameHeight,
+                            int interval) {
+    close();
+
+    if (frameWidth <= 0 || frameHeight <= 0) {
+        LOGE("Invalid frame size: %dx%d", frameWidth, frameHeight);
+        return false;
+    }
+
+    file = fopen(path.c_str(), "wb");
+    if (!file) {
+        LOGE("Cannot create %s", path.c_str());
+        return false;
+    }
+
+    width = frameWidth;
+    height = frameHeight;
+    keyframeInterval = std::max(1, interval);
+    rowBytes = (static_cast<size_t>(width) + 7) / 8;
+    failed = false;
+    offset = 0;
+
+    current.assign(rowBytes * height, 0);
+    previous.assign(rowBytes * height, 0);
+    payload.clear();
+    payload.reserve(current.size());
+    index.clear();
+
+    uint8_t header[kHeaderBytes];
+    uint8_t* out = header;
+    std::memcpy(out, kMagic, 4);
+    out += 4;
+    put<uint16_t>(out, kVersion);
+    put<uint16_t>(out, 0);
+    put<uint32_t>(out, static_cast<uint32_t>(width));
+    put<uint32_t>(out, static_cast<uint32_t>(height));
+    put<uint32_t>(out, static_cast<uint32_t>(keyframeInterval));
+    return write(header, sizeof(header));
+}
+
+bool EdgeStreamWriter::addFrame(const uint8_t* pixels, int pixelStride, size_t rowStride) {
+    if (!file || failed) {
+        return false;
+    }
+
+    for (int y = 0; y < height; ++y) {
+        packRow(pixels + rowStride * y, pixelStride, width, current.data() + rowBytes * y);
+    }
+
+    uint8_t type = kKeyframe;
+    const uint8_t* data = current.data();
+    size_t size = current.size();
+
+    if (index.size() % keyframeInterval != 0) {
+        // XOR with the previous mask, as (zero run, literal run) pairs
+        payload.clear();
+        const uint8_t* a = current.data();
+        const uint8_t* b = previous.data();
+        size_t n = current.size();
+        size_t i = 0;
+        while (i < n && payload.size() < n) {
+            size_t zeros = zeroRun(a, b, i, n);
+            i += zeros;
+
+            size_t literalStart = i;
+            while (i < n) {
+                size_t limit = std::min(n, i + kMinZeroRun);
+                if (a[i] == b[i] && zeroRun(a, b, i, limit) == kMinZeroRun) {
+                    break;
+                }
+                ++i;
+            }
+
+            putVarint(payload, zeros);
+            putVarint(payload, i - literalStart);
+            for (size_t j = literalStart; j < i; ++j) {
+                payload.push_back(a[j] ^ b[j]);
+            }
+        }
+
+        // A delta that is no smaller than the frame (scene cut) becomes a keyframe
+        if (payload.size() < n) {
+            type = kDelta;
+            data = payload.data();
+            size = payload.size();
+        }
+    }
+
+    uint8_t header[kFrameHeaderBytes];
+    uint8_t* out = header;
+    put<uint8_t>(out, type);
+    put<uint8_t>(out, 0);
+    put<uint16_t>(out, 0);
+    put<uint32_t>(out, static_cast<uint32_t>(size));
+
+    IndexEntry entry = {offset, static_cast<uint32_t>(size), type};
+    if (!write(header, sizeof(header)) || !write(data, size)) {
+        return false;
+    }
+    index.push_back(entry);
+
+    current.swap(previous);
+    return true;
+}
+
+bool EdgeStreamWriter::close() {
+    if (!file) {
+        return !failed;
+    }
+
+    uint64_t indexOffset = offset;
+    std::vector<uint8_t> table(index.size() * kIndexEntryBytes + kFooterBytes);
+    uint8_t* out = table.data();
+    for (const IndexEntry& entry : index) {
+        put<uint64_t>(out, entry.offset);
+        put<uint32_t>(out, entry.size);
+        put<uint8_t>(out, entry.type);
+        put<uint8_t>(out, 0);
+        put<uint16_t>(out, 0);
+    }
+    put<uint64_t>(out, indexOffset);
+    put<uint32_t>(out, static_cast<uint32_t>(index.size()));
+    std::memcpy(out, kIndexMagic, 4);
+
+    write(table.data(), table.size());
+    if (fclose(file) != 0) {
+        failed = true;
+    }
+    file = nullptr;
+
+    if (failed) {
+        LOGE("Edge stream incomplete after %zu frames", index.size());
+    }
+    return !failed;
+}
+
+bool EdgeStreamWriter::write(const void* data, size_t bytes) {
+    if (fwrite(data, 1, bytes, file) != bytes) {
+        failed = true;
+        return false;
+    }
+    offset += bytes;
+    return true;
+}
+
+EdgeStreamReader::EdgeStreamReader()
+        : file(nullptr)
+        , width(0)
+        , height(0)
+        , packedRowBytes(0)
+        , position(0)
+        , havePrevious(false) {
+}
+
+EdgeStreamReader::~EdgeStreamReader() {
+    close();
+}
+
+bool EdgeStreamReader::open(const std::string& path) {
+    close();
+
+    file = fopen(path.c_str(), "rb");
+    if (!file) {
+        LOGE("Cannot open %s", path.c_str());
+        return false;
+    }
+
+    uint8_t header[kHeaderBytes];
+    uint8_t footer[kFooterBytes];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header) ||
+        std::memcmp(header, kMagic, 4) != 0 ||
+        fseeko(file, -static_cast<off_t>(kFooterBytes), SEEK_END) != 0 ||
+        fread(footer, 1, sizeof(footer), file) != sizeof(footer) ||
+        std::memcmp(footer + 12, kIndexMagic, 4) != 0) {
+        LOGE("%s is not a complete edge stream", path.c_str());
+        close();
+        return false;
+    }
+
+    const uint8_t* in = header + 4;
+    if (get<uint16_t>(in) != kVersion) {
+        LOGE("%s: unsupported version", path.c_str());
+        close();
+        return false;
+    }
+    get<uint16_t>(in);
+    width = static_cast<int>(get<uint32_t>(in));
+    height = static_cast<int>(get<uint32_t>(in));
+    packedRowBytes = (static_cast<size_t>(width) + 7) / 8;
+
+    in = footer;
+    uint64_t indexOffset = get<uint64_t>(in);
+    uint32_t count = get<uint32_t>(in);
+
+    std::vector<uint8_t> table(static_cast<size_t>(count) * kIndexEntryBytes);
+    if (fseeko(file, static_cast<off_t>(indexOffset), SEEK_SET) != 0 ||
+        fread(table.data(), 1, table.size(), file) != table.size()) {
+        LOGE("%s: cannot read index", path.c_str());
+        close();
+        return false;
+    }
+
+    in = table.data();
+    entries.resize(count);
+    for (IndexEntry& entry : entries) {
+        entry.offset = get<uint64_t>(in);
+        entry.size = get<uint32_t>(in);
+        entry.type = get<uint8_t>(in);
+        in += 3;
+    }
+
+    mask.assign(packedRowBytes * height, 0);
+    position = 0;
+    havePrevious = false;
+    return true;
+}
+
+void EdgeStreamReader::close() {
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+    entries.clear();
+    position = 0;
+    havePrevious = false;
+}
+
+bool EdgeStreamReader::seek(int frame) {
+    if (!file || frame < 0 || frame > frameCount()) {
+        return false;
+    }
+
+    if (frame == frameCount()) {
+        // At the end: nothing to decode, the next read returns no frame
+        position = frame;
+        return true;
+    }
+
+    if (frame == position && (havePrevious || frame == 0)) {
+        return true;
+    }
+
+    // Decode forward from the nearest keyframe, or from here if that is closer
+    int start = frame;
+    while (start > 0 && entries[start].type != kKeyframe) {
+        --start;
+    }
+    if (havePrevious && position > start && position < frame) {
+        start = position;
+    }
+
+    for (int i = start; i < frame; ++i) {
+        if (!decodeFrame(i)) {
+            return false;
+        }
+    }
+    position = frame;
+    return true;
+}
+
+const uint8_t* EdgeStreamReader::nextPacked() {
+    // decodeFrame() advances the position
+    if (!file || position >= frameCount() || !decodeFrame(position)) {
+        return nullptr;
+    }
+    return mask.data();
+}
+
+bool EdgeStreamReader::next(uint8_t* out, size_t rowStride) {
+    const uint8_t* packed = nextPacked();
+    if (!packed) {
+        return false;
+    }
+
+    for (int y = 0; y < height; ++y) {
+        unpackRow(packed + packedRowBytes * y, width, out + rowStride * y);
+    }
+    return true;
+}
+
+bool EdgeStreamReader::decodeFrame(int frame) {
+    const IndexEntry& entry = entries[frame];
+    if (entry.type == kDelta && !(havePrevious && position == frame)) {
+        // A delta only applies on top of the frame before it
+        if (!seek(frame)) {
+            return false;
+        }
+    }
+
+    payload.resize(entry.size);
+    if (fseeko(file, static_cast<off_t>(entry.offset + kFrameHeaderBytes), SEEK_SET) != 0 ||
+        fread(payload.data(), 1, payload.size(), file) != payload.size()) {
+        LOGE("Cannot read frame %d", frame);
+        havePrevious = false;
+        return false;
+    }
+
+    if (entry.type == kKeyframe) {
+        if (payload.size() != mask.size()) {
+            havePrevious = false;
+            return false;
+        }
+        mask.swap(payload);
+    } else {
+        const uint8_t* in = payload.data();
+        const uint8_t* end = in + payload.size();
+        size_t i = 0;
+        while (in < end) {
+            size_t zeros;
+            size_t literals;
+            if (!getVarint(in, end, zeros) || !getVarint(in, end, literals) ||
+                literals > static_cast<size_t>(end - in) ||
+                i + zeros + literals > mask.size()) {
+                LOGE("Corrupt delta in frame %d", frame);
+                havePrevious = false;
+                return false;
+            }
+
+            i += zeros;
+            for (size_t j = 0; j < literals; ++j) {
+                mask[i++] ^= *in++;
+            }
+        }
+    }
+
+    havePrevious = true;
+    position = frame + 1;
+    return true;
+}
@@ -0,0 +1,152 @@
+#ifndef EDGE_STREAM_H
+#define EDGE_STREAM_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * Edge-stream container for binary edge masks
+ *
+ * Layout (little-endian):
+ *   header   "EDGS", version u16, reserved u16, width u32, height u32,
+ *            keyframe interval u32
+ *   frames   type u8 (0 = key, 1 = delta), reserved u8[3], payload size u32,
+ *            payload
+ *   index    one entry per frame: file offset u64, payload size u32, type u8,
+ *            reserved u8[3]
+ *   footer   index offset u64, frame count u32, "EDGI"
+ *
+ * Masks are bit-packed one bit per pixel, MSB first, each row padded to a
+ * whole byte. A keyframe stores the packed mask as is. A delta frame stores
+ * the XOR with the previous mask, run-length coded as (zero bytes, literal
+ * bytes) varint pairs, each followed by the literals - consecutive edge
+ * masks differ in few pixels, so most of the XOR is zero. The index makes
+ * any frame reachable by decoding forward from the keyframe before it.
+ */
+
+/**
+ * Encodes masks into an edge-stream file
+ */
+class EdgeStreamWriter {
+public:
+    EdgeStreamWriter();
+    ~EdgeStreamWriter();
+
+    EdgeStreamWriter(const EdgeStreamWriter&) = delete;
+    EdgeStreamWriter& operator=(const EdgeStreamWriter&) = delete;
+
+    /**
+     * Create the file
+     * @param keyframeInterval Frames between keyframes (1 = keyframes only)
+     */
+    bool open(const std::string& path, int width, int height, int keyframeInterval = 60);
+
+    /**
+     * Append a frame; a pixel is an edge if its first byte is non-zero
+     * @param pixels First pixel of the image
+     * @param pixelStride Bytes between pixels (1 for a mask, 4 for RGBA)
+     * @param rowStride Bytes between rows
+     */
+    bool addFrame(const uint8_t* pixels, int pixelStride, size_t rowStride);
+
+    /**
+     * Write the index and footer and close the file
+     */
+    bool close();
+
+    int frameCount() const { return static_cast<int>(index.size()); }
+
+    /**
+     * Bytes in the file so far
+     */
+    uint64_t bytesWritten() const { return offset; }
+
+private:
+    struct IndexEntry {
+        uint64_t offset;
+        uint32_t size;
+        uint8_t type;
+    };
+
+    FILE* file;
+    int width;
+    int height;
+    int keyframeInterval;
+    size_t rowBytes;
+    bool failed;
+    uint64_t offset;
+
+    std::vector<uint8_t> current;
+    std::vector<uint8_t> previous;
+    std::vector<uint8_t> payload;
+    std::vector<IndexEntry> index;
+
+    bool write(const void* data, size_t bytes);
+};
+
+/**
+ * Decodes an edge-stream file
+ */
+class EdgeStreamReader {
+public:
+    EdgeStreamReader();
+    ~EdgeStreamReader();
+
+    EdgeStreamReader(const EdgeStreamReader&) = delete;
+    EdgeStreamReader& operator=(const EdgeStreamReader&) = delete;
+
+    /**
+     * Open a file and load its index
+     */
+    bool open(const std::string& path);
+
+    void close();
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int frameCount() const { return static_cast<int>(entries.size()); }
+
+    /**
+     * Position so that the next read returns the given frame
+     * frameCount() seeks to the end, where reads return no frame.
+     */
+    bool seek(int frame);
+
+    /**
+     * Decode the next frame as an 8-bit mask (0 or 255)
+     * @param mask Output, width x height
+     * @param rowStride Bytes between output rows
+     */
+    bool next(uint8_t* mask, size_t rowStride);
+
+    /**
+     * Decode the next frame, leaving it bit-packed (rowBytes() per row)
+     */
+    const uint8_t* nextPacked();
+
+    size_t rowBytes() const { return packedRowBytes; }
+
+private:
+    struct IndexEntry {
+        uint64_t offset;
+        uint32_t size;
+        uint8_t type;
+    };
+
+    FILE* file;
+    int width;
+    int height;
+    size_t packedRowBytes;
+    int position;
+    bool havePrevious;
+
+    std::vector<IndexEntry> entries;
+    std::vector<uint8_t> mask;
+    std::vector<uint8_t> payload;
+
+    bool decodeFrame(int frame);
+};
+
+#endif // EDGE_STREAM_H
@@ -0,0 +1,288 @@
+#include "fast_corners.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "thread_pool.h"
+
+namespace {
+
+// Rows per task
+const int kRowGrain = 16;
+
+// Circle radius; pixels closer to the border are never corners
+const int kRadius = 3;
+
+// Bresenham circle of radius 3, clockwise from the top; 0, 4, 8 and 12 are
+// the compass points
+const int kCircle[16][2] = {
+        {0, -3}, {1, -3}, {2, -2}, {3, -1}, {3, 0}, {3, 1}, {2, 2}, {1, 3},
+        {0, 3}, {-1, 3}, {-2, 2}, {-3, 1}, {-3, 0}, {-3, -1}, {-2, -2}, {-1, -3}
+};
+
+void parallelRange(int count, int grain, const std::function<void(int, int)>& body) {
+    ThreadPool* pool = ThreadPool::current();
+    if (pool) {
+        pool->parallelFor(0, count, grain, body);
+    } else {
+        body(0, count);
+    }
+}
+
+// True if the 16 circle bits hold Arc contiguous set bits, wrapping around
+template <int Arc>
+inline bool hasArc(uint32_t bits) {
+    uint32_t ring = bits | (bits << 16);
+    uint32_t run = ring;
+    for (int k = 1; k < Arc; ++k) {
+        run &= ring >> k;
+    }
+    return run != 0;
+}
+
+/**
+ * Full arc test at one pixel
+ * @return Score (summed contrast beyond the threshold on the winning side),
+ *         0 if the pixel is no corner
+ */
+template <int Arc>
+inline int cornerScore(const uint8_t* p, const int* offsets, int threshold) {
+    int center = p[0];
+    uint32_t bright = 0;
+    uint32_t dark = 0;
+    int brightSum = 0;
+    int darkSum = 0;
+    for (int i = 0; i < 16; ++i) {
+        int d = p[offsets[i]] - center;
+        if (d > threshold) {
+            bright |= 1u << i;
+            brightSum += d - threshold;
+        } else if (d < -threshold) {
+            dark |= 1u << i;
+            darkSum += -d - threshold;
+        }
+    }
+
+    int score = hasArc<Arc>(bright) ? brightSum : 0;
+    if (hasArc<Arc>(dark)) {
+        score = std::max(score, darkSum);
+    }
+    return score;
+}
+
+// Compass pre-test: an arc of 9 covers two neighbouring compass points, an
+// arc of 12 three of them
+template <int Arc>
+inline bool compassPass(bool n, bool e, bool s, bool w) {
+    if (Arc >= 12) {
+        return (n && e && s) || (e && s && w) || (s && w && n) || (w && n && e);
+    }
+    return (n && e) || (e && s) || (s && w) || (w && n);
+}
+
+#if defined(__ARM_NEON)
+template <int Arc>
+inline uint8x16_t compassMask(uint8x16_t n, uint8x16_t e, uint8x16_t s, uint8x16_t w) {
+    if (Arc >= 12) {
+        return vorrq_u8(vorrq_u8(vandq_u8(vandq_u8(n, e), s), vandq_u8(vandq_u8(e, s), w)),
+                        vorrq_u8(vandq_u8(vandq_u8(s, w), n), vandq_u8(vandq_u8(w, n), e)));
+    }
+    return vorrq_u8(vorrq_u8(vandq_u8(n, e), vandq_u8(e, s)),
+                    vorrq_u8(vandq_u8(s, w), vandq_u8(w, n)));
+}
+#elif defined(__SSE2__)
+template <int Arc>
+inline __m128i compassMask(__m128i n, __m128i e, __m128i s, __m128i w) {
+    if (Arc >= 12) {
+        return _mm_or_si128(
+                _mm_or_si128(_mm_and_si128(_mm_and_si128(n, e), s),
+                             _mm_and_si128(_mm_and_si128(e, s), w)),
+                _mm_or_si128(_mm_and_si128(_mm_and_si128(s, w), n),
+                             _mm_and_si128(_mm_and_si128(w, n), e)));
+    }
+    return _mm_or_si128(_mm_or_si128(_mm_and_si128(n, e), _mm_and_si128(e, s)),
+                        _mm_or_si128(_mm_and_si128(s, w), _mm_and_si128(w, n)));
+}
+
+inline __m128i loadSigned(const uint8_t* p, __m128i sign) {
+    return _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), sign);
+}
+#endif
+
+/**
+ * Scores of one row (kRadius <= y < rows - kRadius); 0 where there is no corner
+ */
+template <int Arc>
+void scoreRow(const cv::Mat& gray, int y, const int* offsets, int threshold, uint16_t* out) {
+    int width = gray.cols;
+    std::memset(out, 0, width * sizeof(uint16_t));
+
+    const uint8_t* row = gray.ptr<uint8_t>(y);
+    const uint8_t* north = gray.ptr<uint8_t>(y - kRadius);
+    const uint8_t* south = gray.ptr<uint8_t>(y + kRadius);
+    int x = kRadius;
+    int end = width - kRadius;
+
+#if defined(__ARM_NEON)
+    const uint8x16_t limit = vdupq_n_u8(static_cast<uint8_t>(threshold));
+    for (; x + 16 <= end; x += 16) {
+        uint8x16_t center = vld1q_u8(row + x);
+        uint8x16_t high = vqaddq_u8(center, limit);
+        uint8x16_t low = vqsubq_u8(center, limit);
+        uint8x16_t n = vld1q_u8(north + x);
+        uint8x16_t e = vld1q_u8(row + x + kRadius);
+        uint8x16_t s = vld1q_u8(south + x);
+        uint8x16_t w = vld1q_u8(row + x - kRadius);
+
+        uint8x16_t candidates = vorrq_u8(
+                compassMask<Arc>(vcgtq_u8(n, high), vcgtq_u8(e, high),
+                                 vcgtq_u8(s, high), vcgtq_u8(w, high)),
+                compassMask<Arc>(vcltq_u8(n, low), vcltq_u8(e, low),
+                                 vcltq_u8(s, low), vcltq_u8(w, low)));
+        uint64x2_t any = vreinterpretq_u64_u8(candidates);
+        if ((vgetq_lane_u64(any, 0) | vgetq_lane_u64(any, 1)) == 0) {
+            continue;
+        }
+
+        uint8_t lanes[16];
+        vst1q_u8(lanes, candidates);
+        for (int i = 0; i < 16; ++i) {
+            if (lanes[i]) {
+                out[x + i] = static_cast<uint16_t>(
+                        cornerScore<Arc>(row + x + i, offsets, threshold));
+            }
+        }
+    }
+#elif defined(__SSE2__)
+    // SSE2 compares signed bytes only: shift everything by 0x80
+    const __m128i sign = _mm_set1_epi8(static_cast<char>(0x80));
+    const __m128i limit = _mm_set1_epi8(static_cast<char>(threshold));
+    for (; x + 16 <= end; x += 16) {
+        __m128i center = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x));
+        __m128i high = _mm_xor_si128(_mm_adds_epu8(center, limit), sign);
+        __m128i low = _mm_xor_si128(_mm_subs_epu8(center, limit), sign);
+        __m128i n = loadSigned(north + x, sign);
+        __m128i e = loadSigned(row + x + kRadius, sign);
+        __m128i s = loadSigned(south + x, sign);
+        __m128i w = loadSigned(row + x - kRadius, sign);
+
+        __m128i candidates = _mm_or_si128(
+                compassMask<Arc>(_mm_cmpgt_epi8(n, high), _mm_cmpgt_epi8(e, high),
+                                 _mm_cmpgt_epi8(s, high), _mm_cmpgt_epi8(w, high)),
+                compassMask<Arc>(_mm_cmplt_epi8(n, low), _mm_cmplt_epi8(e, low),
+                                 _mm_cmplt_epi8(s, low), _mm_cmplt_epi8(w, low)));
+        for (int mask = _mm_movemask_epi8(candidates); mask != 0; mask &= mask - 1) {
+            int i = __builtin_ctz(mask);
+            out[x + i] = static_cast<uint16_t>(cornerScore<Arc>(row + x + i, offsets, threshold));
+        }
+    }
+#endif
+
+    for (; x < end; ++x) {
+        int high = row[x] + threshold;
+        int low = row[x] - threshold;
+        int n = north[x];
+        int e = row[x + kRadius];
+        int s = south[x];
+        int w = row[x - kRadius];
+        if (compassPass<Arc>(n > high, e > high, s > high, w > high) ||
+            compassPass<Arc>(n < low, e < low, s < low, w < low)) {
+            out[x] = static_cast<uint16_t>(cornerScore<Arc>(row + x, offsets, threshold));
+        }
+    }
+}
+
+template <int Arc>
+void scoreImage(const cv::Mat& gray, cv::Mat& scores, int threshold) {
+    int offsets[16];
+    for (int i = 0; i < 16; ++i) {
+        offsets[i] = kCircle[i][1] * static_cast<int>(gray.step) + kCircle[i][0];
+    }
+
+    int height = gray.rows;
+    parallelRange(height, kRowGrain, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            uint16_t* out = scores.ptr<uint16_t>(y);
+            if (y < kRadius || y >= height - kRadius) {
+                std::memset(out, 0, scores.cols * sizeof(uint16_t));
+            } else {
+                scoreRow<Arc>(gray, y, offsets, threshold, out);
+            }
+        }
+    });
+}
+
+// Strongest first; position breaks ties so the order does not depend on threads
+bool stronger(const Keypoint& a, const Keypoint& b) {
+    if (a.score != b.score) {
+        return a.score > b.score;
+    }
+    return a.y != b.y ? a.y < b.y : a.x < b.x;
+}
+
+} // namespace
+
+void detectFastCorners(const cv::Mat& gray, cv::Mat& scores, int threshold, FastArc arc,
+                       int maxKeypoints, std::vector<Keypoint>& keypoints) {
+    CV_Assert(gray.type() == CV_8UC1 && scores.type() == CV_16UC1);
+    CV_Assert(scores.rows == gray.rows && scores.cols == gray.cols);
+    keypoints.clear();
+    if (gray.rows <= 2 * kRadius || gray.cols <= 2 * kRadius || maxKeypoints <= 0) {
+        return;
+    }
+
+    threshold = std::min(std::max(threshold, 1), 254);
+    if (arc == FAST_12) {
+        scoreImage<12>(gray, scores, threshold);
+    } else {
+        scoreImage<9>(gray, scores, threshold);
+    }
+
+    // 3x3 non-maximum suppression; of equal neighbours the last in raster order wins
+    int height = gray.rows;
+    int width = gray.cols;
+    std::mutex mergeMutex;
+    parallelRange(height, kRowGrain, [&](int begin, int end) {
+        std::vector<Keypoint> local;
+        for (int y = std::max(begin, kRadius); y < std::min(end, height - kRadius); ++y) {
+            const uint16_t* above = scores.ptr<uint16_t>(y - 1);
+            const uint16_t* row = scores.ptr<uint16_t>(y);
+            const uint16_t* below = scores.ptr<uint16_t>(y + 1);
+            for (int x = kRadius; x < width - kRadius; ++x) {
+                int s = row[x];
+                if (s == 0 ||
+                    s < above[x - 1] || s < above[x] || s < above[x + 1] || s < row[x - 1] ||
+                    s <= row[x + 1] || s <= below[x - 1] || s <= below[x] || s <= below[x + 1]) {
+                    continue;
+                }
+                Keypoint keypoint;
+                keypoint.x = static_cast<float>(x);
+                keypoint.y = static_cast<float>(y);
+                keypoint.score = static_cast<float>(s);
+                local.push_back(keypoint);
+            }
+        }
+
+        if (!local.empty()) {
+            std::lock_guard<std::mutex> lock(mergeMutex);
+            keypoints.insert(keypoints.end(), local.begin(), local.end());
+        }
+    });
+
+    if (static_cast<int>(keypoints.size()) > maxKeypoints) {
+        std::partial_sort(keypoints.begin(), keypoints.begin() + maxKeypoints, keypoints.end(),
+                          stronger);
+        keypoints.resize(maxKeypoints);
+    } else {
+        std::sort(keypoints.begin(), keypoints.end(), stronger);
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef FAST_CORNERS_H
+#define FAST_CORNERS_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+/**
+ * FAST corner detection
+ *
+ * A pixel is a corner when a contiguous arc of the 16-pixel circle of radius
+ * 3 around it is brighter or darker than the center by more than the
+ * threshold. The four compass points of the circle reject most pixels 16 at
+ * a time (NEON / SSE2 with a scalar tail); the rest get the full arc test
+ * and a score, followed by 3x3 non-maximum suppression. Rows are spread over
+ * the thread pool bound to the calling thread, if any.
+ */
+
+enum FastArc {
+    FAST_9 = 9,     // 9 of 16: most repeatable
+    FAST_12 = 12    // 12 of 16: fewer, sharper corners; cheaper pre-test
+};
+
+/**
+ * One corner
+ */
+struct Keypoint {
+    float x, y;
+    float score;  // Summed contrast beyond the threshold over the arc pixels
+};
+
+// Floats per keypoint in flat arrays (x, y, score)
+const int kKeypointFloats = 3;
+
+/**
+ * Detect corners
+ * @param gray CV_8UC1 image, usually blurred (may be a view)
+ * @param scores CV_16UC1 image of the same size, overwritten
+ * @param threshold Contrast a circle pixel needs against the center (1..254)
+ * @param arc FAST_9 or FAST_12
+ * @param maxKeypoints Largest number of corners kept, strongest first
+ * @param keypoints Receives the corners by descending score
+ */
+void detectFastCorners(const cv::Mat& gray, cv::Mat& scores, int threshold, FastArc arc,
+                       int maxKeypoints, std::vector<Keypoint>& keypoints);
+
+#endif // FAST_CORNERS_H
@@ -0,0 +1,459 @@
+#include "frame_io.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define LOG_TAG "FrameIO"
+#include "native_log.h"
+
+namespace {
+
+/**
+ * Bounded ring of frame buffers between one producer and one consumer
+ * The producer fills producerBuffer() and calls produce(); the consumer
+ * reads consumerBuffer() and calls consume(). Buffers are allocated once.
+ */
+class BufferRing {
+public:
+    BufferRing(int slots, size_t bytes)
+            : buffers(std::max(1, slots), std::vector<uint8_t>(bytes))
+            , produced(0)
+            , consumed(0)
+            , finished(false)
+            , cancelled(false) {
+    }
+
+    // Free buffer to fill; nullptr once the consumer cancelled
+    uint8_t* producerBuffer() {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this] { return cancelled || produced - consumed < buffers.size(); });
+        return cancelled ? nullptr : buffers[produced % buffers.size()].data();
+    }
+
+    void produce() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++produced;
+        }
+        changed.notify_all();
+    }
+
+    // No more buffers will be produced
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished = true;
+        }
+        changed.notify_all();
+    }
+
+    // Filled buffer; nullptr once the producer finished and the ring is drained
+    uint8_t* consumerBuffer() {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this] { return finished || cancelled || consumed < produced; });
+        if (cancelled || consumed == produced) {
+            return nullptr;
+        }
+        return buffers[consumed % buffers.size()].data();
+    }
+
+    void consume() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++consumed;
+        }
+        changed.notify_all();
+    }
+
+    // The consumer is going away; unblock the producer
+    void cancel() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            cancelled = true;
+        }
+        changed.notify_all();
+    }
+
+private:
+    std::vector<std::vector<uint8_t>> buffers;
+    uint64_t produced;
+    uint64_t consumed;
+    bool finished;
+    bool cancelled;
+    std::mutex mutex;
+    std::condition_variable changed;
+};
+
+bool readFully(int fd, uint8_t* data, size_t bytes, off_t offset) {
+    while (bytes > 0) {
+        ssize_t n = pread(fd, data, bytes, offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        bytes -= n;
+        offset += n;
+    }
+    return true;
+}
+
+bool writeFully(int fd, const uint8_t* data, size_t bytes) {
+    while (bytes > 0) {
+        ssize_t n = write(fd, data, bytes);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+} // namespace
+
+struct FrameSource::Ring : BufferRing {
+    using BufferRing::BufferRing;
+};
+
+struct FrameSink::Ring : BufferRing {
+    using BufferRing::BufferRing;
+};
+
+void convertI420ToNv21(const uint8_t* i420, uint8_t* nv21, int width, int height) {
+    size_t lumaBytes = static_cast<size_t>(width) * height;
+    size_t chromaBytes = lumaBytes / 4;
+    std::memcpy(nv21, i420, lumaBytes);
+
+    const uint8_t* u = i420 + lumaBytes;
+    const uint8_t* v = u + chromaBytes;
+    uint8_t* vu = nv21 + lumaBytes;
+    for (size_t i = 0; i < chromaBytes; ++i) {
+        vu[2 * i] = v[i];
+        vu[2 * i + 1] = u[i];
+    }
+}
+
+FrameSource::FrameSource()
+        : fd(-1)
+        , width(0)
+        , height(0)
+        , format(FRAME_NV21)
+        , access(ACCESS_MMAP)
+        , bytesPerFrame(0)
+        , frames(0)
+        , position(0)
+        , mapping(nullptr)
+        , mappingBytes(0)
+        , readAheadFrames(0)
+        , holding(false) {
+}
+
+FrameSource::~FrameSource() {
+    close();
+}
+
+bool FrameSource::open(const std::string& path, int frameWidth, int frameHeight,
+                       FrameFormat frameFormat, FrameAccess frameAccess, int readAhead) {
+    close();
+
+    if (frameWidth <= 0 || frameHeight <= 0 || (frameWidth | frameHeight) & 1) {
+        LOGE("Invalid frame size: %dx%d", frameWidth, frameHeight);
+        return false;
+    }
+
+    fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOGE("Cannot open %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        LOGE("Cannot stat %s: %s", path.c_str(), strerror(errno));
+        close();
+        return false;
+    }
+
+    width = frameWidth;
+    height = frameHeight;
+    format = frameFormat;
+    access = frameAccess;
+    bytesPerFrame = static_cast<size_t>(width) * height * 3 / 2;
+    frames = static_cast<int>(static_cast<size_t>(info.st_size) / bytesPerFrame);
+    position = 0;
+
+    if (frames == 0) {
+        LOGE("%s holds no whole %dx%d frame", path.c_str(), width, height);
+        close();
+        return false;
+    }
+
+    if (access == ACCESS_MMAP) {
+        mappingBytes = bytesPerFrame * frames;
+        void* addr = mmap(nullptr, mappingBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            LOGE("mmap of %s failed: %s", path.c_str(), strerror(errno));
+            mapping = nullptr;
+            close();
+            return false;
+        }
+        mapping = static_cast<uint8_t*>(addr);
+        madvise(mapping, mappingBytes, MADV_SEQUENTIAL);
+
+        if (format == FRAME_I420) {
+            converted.resize(bytesPerFrame);
+        }
+    } else {
+        readAheadFrames = std::max(1, readAhead);
+        startReader(0);
+    }
+
+    LOGI("Opened %s: %d frames %dx%d (%s, %s)", path.c_str(), frames, width, height,
+         format == FRAME_I420 ? "I420" : "NV21", access == ACCESS_MMAP ? "mmap" : "stream");
+    return true;
+}
+
+const uint8_t* FrameSource::next() {
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    if (access == ACCESS_STREAM) {
+        // The previous frame is handed back to the reader first
+        if (holding) {
+            ring->consume();
+            holding = false;
+        }
+
+        const uint8_t* frame = ring->consumerBuffer();
+        if (frame) {
+            holding = true;
+            ++position;
+        }
+        return frame;
+    }
+
+    if (position >= frames) {
+        return nullptr;
+    }
+
+    const uint8_t* frame = mapping + bytesPerFrame * position++;
+    if (format == FRAME_I420) {
+        convertI420ToNv21(frame, converted.data(), width, height);
+        frame = converted.data();
+    }
+    return frame;
+}
+
+void FrameSource::rewind() {
+    if (fd < 0) {
+        return;
+    }
+
+    if (access == ACCESS_STREAM) {
+        stopReader();
+        startReader(0);
+    }
+    position = 0;
+}
+
+void FrameSource::close() {
+    stopReader();
+
+    if (mapping) {
+        munmap(mapping, mappingBytes);
+        mapping = nullptr;
+        mappingBytes = 0;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+
+    converted.clear();
+    frames = 0;
+    position = 0;
+}
+
+void FrameSource::startReader(int firstFrame) {
+    ring.reset(new Ring(readAheadFrames, bytesPerFrame));
+    holding = false;
+    reader = std::thread(&FrameSource::readerLoop, this, firstFrame);
+}
+
+void FrameSource::stopReader() {
+    if (ring) {
+        ring->cancel();
+    }
+    if (reader.joinable()) {
+        reader.join();
+    }
+    ring.reset();
+}
+
+void FrameSource::readerLoop(int firstFrame) {
+    std::vector<uint8_t> i420(format == FRAME_I420 ? bytesPerFrame : 0);
+
+    for (int frame = firstFrame; frame < frames; ++frame) {
+        uint8_t* buffer = ring->producerBuffer();
+        if (!buffer) {
+            return;  // Cancelled
+        }
+
+        off_t offset = static_cast<off_t>(bytesPerFrame) * frame;
+        uint8_t* target = format == FRAME_I420 ? i420.data() : buffer;
+        if (!readFully(fd, target, bytesPerFrame, offset)) {
+            LOGE("Read of frame %d failed: %s", frame, strerror(errno));
+            break;
+        }
+
+        if (format == FRAME_I420) {
+            convertI420ToNv21(i420.data(), buffer, width, height);
+        }
+        ring->produce();
+    }
+
+    ring->finish();
+}
+
+FrameSink::FrameSink()
+        : fd(-1)
+        , access(ACCESS_MMAP)
+        , bytesPerFrame(0)
+        , capacity(0)
+        , committed(0)
+        , failed(false)
+        , mapping(nullptr)
+        , mappingBytes(0) {
+}
+
+FrameSink::~FrameSink() {
+    close();
+}
+
+bool FrameSink::open(const std::string& path, size_t frameBytes, FrameAccess frameAccess,
+                     int frameCapacity, int writeBehind) {
+    close();
+
+    if (frameBytes == 0 || (frameAccess == ACCESS_MMAP && frameCapacity <= 0)) {
+        LOGE("Invalid sink: %zu bytes per frame, capacity %d", frameBytes, frameCapacity);
+        return false;
+    }
+
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOGE("Cannot create %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    access = frameAccess;
+    bytesPerFrame = frameBytes;
+    capacity = frameCapacity;
+    committed = 0;
+    failed = false;
+
+    if (access == ACCESS_MMAP) {
+        mappingBytes = bytesPerFrame * capacity;
+        void* addr = MAP_FAILED;
+        if (ftruncate(fd, static_cast<off_t>(mappingBytes)) == 0) {
+            addr = mmap(nullptr, mappingBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        if (addr == MAP_FAILED) {
+            LOGE("Cannot map %s for %d frames: %s", path.c_str(), capacity, strerror(errno));
+            mappingBytes = 0;
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+        mapping = static_cast<uint8_t*>(addr);
+    } else {
+        ring.reset(new Ring(writeBehind, bytesPerFrame));
+        writer = std::thread(&FrameSink::writerLoop, this);
+    }
+
+    return true;
+}
+
+uint8_t* FrameSink::acquire() {
+    if (fd < 0 || failed) {
+        return nullptr;
+    }
+
+    if (access == ACCESS_STREAM) {
+        return ring->producerBuffer();
+    }
+
+    if (committed >= capacity) {
+        return nullptr;
+    }
+    return mapping + bytesPerFrame * committed;
+}
+
+bool FrameSink::commit() {
+    if (fd < 0 || failed) {
+        return false;
+    }
+
+    if (access == ACCESS_STREAM) {
+        ring->produce();
+    } else if (committed >= capacity) {
+        return false;
+    }
+
+    ++committed;
+    return true;
+}
+
+bool FrameSink::close() {
+    if (fd < 0) {
+        return !failed;
+    }
+
+    if (ring) {
+        ring->finish();
+        writer.join();
+        ring.reset();
+    }
+
+    if (mapping) {
+        munmap(mapping, mappingBytes);
+        mapping = nullptr;
+        mappingBytes = 0;
+
+        // Drop preallocated frames that were never written
+        if (ftruncate(fd, static_cast<off_t>(bytesPerFrame * committed)) != 0) {
+            failed = true;
+        }
+    }
+
+    if (::close(fd) != 0) {
+        failed = true;
+    }
+    fd = -1;
+
+    if (failed) {
+        LOGE("Output incomplete after %d frames", committed);
+    }
+    return !failed;
+}
+
+void FrameSink::writerLoop() {
+    while (const uint8_t* frame = ring->consumerBuffer()) {
+        if (!failed && !writeFully(fd, frame, bytesPerFrame)) {
+            LOGE("Write failed: %s", strerror(errno));
+            failed = true;
+        }
+        ring->consume();
+    }
+}
@@ -0,0 +1,184 @@
+#ifndef FRAME_IO_H
+#define FRAME_IO_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Layout of raw YUV 4:2:0 frames in a sequence file
+ * Frames are stored back to back with no header, width * height * 3 / 2
+ * bytes each (the format written by ffmpeg -f rawvideo).
+ */
+enum FrameFormat {
+    FRAME_NV21 = 0,  // Y plane, interleaved VU (Android camera layout)
+    FRAME_I420 = 1   // Y plane, U plane, V plane
+};
+
+/**
+ * How a sequence file is accessed
+ */
+enum FrameAccess {
+    ACCESS_MMAP = 0,   // Memory-mapped; the kernel reads ahead
+    ACCESS_STREAM = 1  // read()/write() on a background thread with a buffer ring
+};
+
+/**
+ * Convert one I420 frame to NV21
+ */
+void convertI420ToNv21(const uint8_t* i420, uint8_t* nv21, int width, int height);
+
+/**
+ * Reads a raw YUV sequence file and yields NV21 frames
+ *
+ * Mapped NV21 files are served straight from the mapping. I420 frames are
+ * converted while reading - on the read-ahead thread in stream mode.
+ */
+class FrameSource {
+public:
+    FrameSource();
+    ~FrameSource();
+
+    FrameSource(const FrameSource&) = delete;
+    FrameSource& operator=(const FrameSource&) = delete;
+
+    /**
+     * Open a sequence file
+     * @param path File to read
+     * @param width Frame width (even)
+     * @param height Frame height (even)
+     * @param format Layout of the frames in the file
+     * @param access Memory-mapped or streamed
+     * @param readAhead Frames buffered ahead of the consumer (stream mode)
+     * @return true if the file holds at least one whole frame
+     */
+    bool open(const std::string& path, int width, int height, FrameFormat format,
+              FrameAccess access, int readAhead = 4);
+
+    /**
+     * Next NV21 frame, or nullptr at the end of the file
+     * The data stays valid until the following next(), rewind() or close().
+     */
+    const uint8_t* next();
+
+    /**
+     * Start again from the first frame
+     */
+    void rewind();
+
+    void close();
+
+    /**
+     * Whole frames in the file (a trailing partial frame is ignored)
+     */
+    int frameCount() const { return frames; }
+
+    /**
+     * Bytes of one NV21 frame
+     */
+    size_t frameBytes() const { return bytesPerFrame; }
+
+private:
+    struct Ring;
+
+    int fd;
+    int width;
+    int height;
+    FrameFormat format;
+    FrameAccess access;
+    size_t bytesPerFrame;
+    int frames;
+    int position;
+
+    // ACCESS_MMAP
+    uint8_t* mapping;
+    size_t mappingBytes;
+    std::vector<uint8_t> converted;
+
+    // ACCESS_STREAM
+    std::unique_ptr<Ring> ring;
+    std::thread reader;
+    int readAheadFrames;
+    bool holding;  // A ring buffer is lent out to the caller
+
+    void startReader(int firstFrame);
+    void stopReader();
+    void readerLoop(int firstFrame);
+};
+
+/**
+ * Writes processed frames to a raw sequence file
+ *
+ * Callers fill the buffer returned by acquire() and then commit() it. In
+ * mmap mode the buffer is the file itself; in stream mode a writer thread
+ * drains a ring of buffers so the caller never waits on the disk unless the
+ * ring is full.
+ */
+class FrameSink {
+public:
+    FrameSink();
+    ~FrameSink();
+
+    FrameSink(const FrameSink&) = delete;
+    FrameSink& operator=(const FrameSink&) = delete;
+
+    /**
+     * Create (or truncate) a sequence file
+     * @param path File to write
+     * @param frameBytes Bytes per output frame
+     * @param access Memory-mapped or streamed
+     * @param frameCapacity Frames to preallocate (required for mmap mode)
+     * @param writeBehind Frames buffered behind the producer (stream mode)
+     * @return true if the file is ready
+     */
+    bool open(const std::string& path, size_t frameBytes, FrameAccess access,
+              int frameCapacity = 0, int writeBehind = 4);
+
+    /**
+     * Buffer for the next frame, or nullptr if the sink is full or failed
+     */
+    uint8_t* acquire();
+
+    /**
+     * Queue the acquired buffer for writing
+     */
+    bool commit();
+
+    /**
+     * Flush pending frames and close the file
+     * @return false if any write failed
+     */
+    bool close();
+
+    /**
+     * Frames committed so far
+     */
+    int frameCount() const { return committed; }
+
+private:
+    struct Ring;
+
+    int fd;
+    FrameAccess access;
+    size_t bytesPerFrame;
+    int capacity;
+    int committed;
+    std::atomic<bool> failed;  // Also set by the writer thread
+
+    // ACCESS_MMAP
+    uint8_t* mapping;
+    size_t mappingBytes;
+
+    // ACCESS_STREAM
+    std::unique_ptr<Ring> ring;
+    std::thread writer;
+
+    void writerLoop();
+};
+
+#endif // FRAME_IO_H
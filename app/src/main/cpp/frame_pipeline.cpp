@@ -0,0 +1,261 @@
+#include "frame_pipeline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+
+#define LOG_TAG "FramePipeline"
+#include "native_log.h"
+
+namespace {
+
+// Slot states: stage k takes slots in state k and moves them to k + 1
+enum SlotState {
+    SLOT_FREE = 0,
+    SLOT_CONVERT = 1,
+    SLOT_BLUR = 2,
+    SLOT_EDGES = 3,
+    SLOT_EXPAND = 4,
+    SLOT_DONE = 5
+};
+
+const int kStageCount = SLOT_DONE - SLOT_CONVERT;
+
+// Polls before a waiting thread sleeps; stages usually hand over within this
+const int kSpinCount = 2000;
+
+} // namespace
+
+/**
+ * One frame in flight with its own scratch buffers
+ */
+struct FramePipeline::Slot {
+    explicit Slot(MemoryTracker* tracker)
+            : state(SLOT_FREE)
+            , workspace(tracker) {
+    }
+
+    std::atomic<int> state;
+
+    // Set by submit()
+    const uint8_t* yuvData;
+    uint8_t* outputRgba;
+    OpenCVProcessor::ProcessingMode mode;
+    OpenCVProcessor::Params params;
+    QualityLevel quality;
+    std::chrono::steady_clock::time_point submitTime;
+
+    // Carried between stages
+    OpenCVProcessor::Workspace workspace;
+    cv::Rect roi;
+    cv::Rect work;
+    cv::Mat image;
+    bool ok;
+};
+
+FramePipeline::FramePipeline(OpenCVProcessor& processor, int slotCount, int edgeThreads)
+        : processor(processor)
+        , stopping(false)
+        , submitted(0)
+        , collected(0) {
+    // A slot always comes back to the same edge replica, which has finished
+    // its previous frame before waiting for the next one
+    edgeThreads = std::max(1, edgeThreads);
+    slotCount = std::max(1, slotCount);
+    slotCount = (slotCount + edgeThreads - 1) / edgeThreads * edgeThreads;
+    for (int i = 0; i < slotCount; ++i) {
+        slots.emplace_back(new Slot(&processor.memoryTracker));
+    }
+
+    for (int stage = SLOT_CONVERT; stage < SLOT_DONE; ++stage) {
+        int replicas = stage == SLOT_EDGES ? edgeThreads : 1;
+        for (int replica = 0; replica < replicas; ++replica) {
+            stages.emplace_back(&FramePipeline::stageLoop, this, stage, replica, replicas);
+        }
+    }
+
+    LOGI("Pipeline started: %d stages, %d edge threads, %d slots", kStageCount, edgeThreads,
+         slotCount);
+}
+
+FramePipeline::~FramePipeline() {
+    while (inFlight() > 0) {
+        collect(nullptr, nullptr);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    stateChanged.notify_all();
+
+    for (std::thread& thread : stages) {
+        thread.join();
+    }
+}
+
+int FramePipeline::stageCount() {
+    return kStageCount;
+}
+
+bool FramePipeline::submit(const uint8_t* yuvData, size_t yuvSize, uint8_t* outputRgba,
+                           OpenCVProcessor::ProcessingMode mode) {
+    if (!processor.initialized) {
+        LOGE("Processor not initialized");
+        return false;
+    }
+
+    if (!yuvData || !outputRgba || yuvSize < processor.yuvFrameBytes()) {
+        LOGE("Invalid frame: %zu bytes", yuvSize);
+        return false;
+    }
+
+    if (mode < OpenCVProcessor::MODE_RAW || mode > OpenCVProcessor::MODE_LOG) {
+        LOGE("Unknown processing mode: %d", mode);
+        return false;
+    }
+
+    Slot& slot = *slots[submitted % slots.size()];
+    waitFor(slot, SLOT_FREE);
+
+    slot.yuvData = yuvData;
+    slot.outputRgba = outputRgba;
+    slot.mode = mode;
+    slot.params = processor.params.load();
+    slot.quality = processor.frameQuality(slot.params, false);
+    slot.submitTime = std::chrono::steady_clock::now();
+    slot.ok = true;
+
+    ++submitted;
+    advance(slot, SLOT_CONVERT);
+    return true;
+}
+
+bool FramePipeline::collect(uint8_t** outputRgba, bool* success) {
+    if (inFlight() == 0) {
+        return false;
+    }
+
+    Slot& slot = *slots[collected % slots.size()];
+    waitFor(slot, SLOT_DONE);
+
+    if (slot.ok) {
+        std::chrono::duration<double, std::milli> latency =
+                std::chrono::steady_clock::now() - slot.submitTime;
+        processor.recordFrames(latency.count(), 1, false);
+    }
+
+    if (outputRgba) {
+        *outputRgba = slot.outputRgba;
+    }
+    if (success) {
+        *success = slot.ok;
+    }
+
+    ++collected;
+    advance(slot, SLOT_FREE);
+    return true;
+}
+
+void FramePipeline::stageLoop(int stage, int replica, int replicas) {
+    // Every replica sees its share of the slots in submission order
+    for (uint64_t index = replica;; index += replicas) {
+        Slot& slot = *slots[index % slots.size()];
+        if (!waitFor(slot, stage)) {
+            return;
+        }
+
+        if (slot.ok) {
+            // A throwing stage fails its frame, never the thread
+            try {
+                runStage(stage, slot);
+            } catch (const cv::Exception& e) {
+                LOGE("OpenCV exception in stage %d: %s", stage, e.what());
+                slot.ok = false;
+            } catch (const std::exception& e) {
+                LOGE("Exception in stage %d: %s", stage, e.what());
+                slot.ok = false;
+            }
+        }
+
+        advance(slot, stage + 1);
+    }
+}
+
+void FramePipeline::runStage(int stage, Slot& slot) {
+    // Pipelined frames are never rotated or cropped
+    OpenCVProcessor::InputView input =
+            processor.inputView(slot.yuvData, OpenCVProcessor::FrameTransform());
+    cv::Mat output(input.size.height, input.size.width, CV_8UC4, slot.outputRgba);
+
+    bool canny = slot.mode == OpenCVProcessor::MODE_CANNY;
+
+    switch (stage) {
+        case SLOT_CONVERT:
+            slot.roi = processor.activeRoi(slot.params, input.size);
+            if (canny) {
+                slot.work = processor.cannyWorkRect(slot.roi, slot.params, slot.quality,
+                                                    input.size);
+                slot.image = processor.cannyPrepare(input.yPlane, slot.work, slot.quality,
+                                                    slot.workspace);
+            } else if (slot.mode == OpenCVProcessor::MODE_RAW) {
+                processor.convertYuv(input, slot.roi, slot.workspace, output);
+            }
+            break;
+
+        case SLOT_BLUR:
+            if (canny) {
+                slot.image = processor.cannySmooth(slot.image, slot.params, slot.quality,
+                                                   slot.workspace);
+            }
+            break;
+
+        case SLOT_EDGES:
+            if (canny) {
+                slot.image = processor.cannyEdges(slot.image, slot.work, slot.params,
+                                                  slot.quality, slot.workspace);
+            } else if (slot.mode >= OpenCVProcessor::MODE_SOBEL) {
+                // Single pass from luma to output; cheap enough for one stage
+                processor.applyGradient(input, slot.roi, slot.mode, slot.params, slot.quality,
+                                        slot.workspace, output);
+            }
+            break;
+
+        case SLOT_EXPAND:
+            if (canny) {
+                processor.cannyExpand(input, slot.image, slot.roi, slot.work, slot.params,
+                                      output);
+                slot.image.release();
+            } else if (slot.mode == OpenCVProcessor::MODE_GRAYSCALE) {
+                processor.applyGrayscale(input, slot.roi, slot.workspace, output);
+            }
+
+            if (slot.params.roiOutsidePolicy == OpenCVProcessor::ROI_OUTSIDE_RAW) {
+                processor.fillOutsideRoi(input, slot.roi, slot.workspace, output);
+            }
+            break;
+    }
+}
+
+bool FramePipeline::waitFor(Slot& slot, int state) {
+    for (int spin = 0; spin < kSpinCount; ++spin) {
+        if (slot.state.load(std::memory_order_acquire) == state) {
+            return true;
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(stateMutex);
+    stateChanged.wait(lock, [&] {
+        return stopping || slot.state.load(std::memory_order_acquire) == state;
+    });
+    return slot.state.load(std::memory_order_acquire) == state;
+}
+
+void FramePipeline::advance(Slot& slot, int state) {
+    {
+        // Publishing under the lock closes the gap between a waiter's check and its sleep
+        std::lock_guard<std::mutex> lock(stateMutex);
+        slot.state.store(state, std::memory_order_release);
+    }
+    stateChanged.notify_all();
+}
@@ -0,0 +1,116 @@
+#ifndef FRAME_PIPELINE_H
+#define FRAME_PIPELINE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "opencv_processor.h"
+
+/**
+ * Frame-level software pipeline for throughput mode
+ *
+ * Splits frame processing into stages that run on their own threads:
+ * conversion (crop / downscale, or the full NV21 conversion in MODE_RAW),
+ * blur, gradient + non-maximum suppression + hysteresis, and RGBA output
+ * expansion. While frame N is in stage k, frame N + 1 is in stage k - 1, so
+ * small frames keep several cores busy where intra-frame parallelism has
+ * too little work per loop. Each frame adds up to a few stages of latency.
+ * The single-pass edge modes (MODE_SOBEL, MODE_SCHARR, MODE_LOG) run whole
+ * in the gradient stage.
+ *
+ * The gradient stage does most of the work, so it can run on several
+ * threads: replica r takes frames r, r + N, r + 2N, ... Later stages still
+ * walk the frames in submission order, so frames retire in order. The
+ * stages run their kernels single-threaded; parallelism comes from frames.
+ *
+ * Frames live in a fixed ring of preallocated slots. Every stage walks the
+ * ring in order and hands a slot on by advancing its state, so there are no
+ * queues and no allocation per frame; submit() blocks while all slots are in
+ * flight. Frames use the processor's parameters at submit time and the
+ * default quality level (the governor only drives processFrame()). The
+ * processor's frame size must not change while a pipeline exists.
+ */
+class FramePipeline {
+public:
+    /**
+     * @param processor Processor providing parameters and frame size
+     * @param slotCount Frames in flight (at least one per stage thread is
+     *                  useful); rounded up to a multiple of edgeThreads
+     * @param edgeThreads Threads running the gradient stage
+     */
+    FramePipeline(OpenCVProcessor& processor, int slotCount, int edgeThreads = 1);
+
+    /**
+     * Finishes the frames in flight, then stops the stage threads
+     */
+    ~FramePipeline();
+
+    FramePipeline(const FramePipeline&) = delete;
+    FramePipeline& operator=(const FramePipeline&) = delete;
+
+    /**
+     * Queue a frame; blocks while every slot is busy
+     * The input and output buffers must stay valid until the frame has been
+     * collected.
+     * @param yuvData NV21 frame
+     * @param yuvSize Size of yuvData in bytes
+     * @param outputRgba RGBA output for the frame
+     * @param mode Processing mode
+     * @return false if the frame was rejected (nothing queued)
+     */
+    bool submit(const uint8_t* yuvData, size_t yuvSize, uint8_t* outputRgba,
+                OpenCVProcessor::ProcessingMode mode);
+
+    /**
+     * Wait for the oldest frame in flight
+     * @param outputRgba Receives the output pointer given to submit()
+     * @param success Receives whether the frame was processed
+     * @return false if no frame is in flight
+     */
+    bool collect(uint8_t** outputRgba, bool* success);
+
+    /**
+     * Frames submitted but not yet collected
+     */
+    int inFlight() const { return submitted - collected; }
+
+    /**
+     * Number of stages
+     */
+    static int stageCount();
+
+    /**
+     * Number of stage threads, replicas included
+     */
+    int threadCount() const { return static_cast<int>(stages.size()); }
+
+private:
+    struct Slot;
+
+    OpenCVProcessor& processor;
+    std::vector<std::unique_ptr<Slot>> slots;
+    std::vector<std::thread> stages;
+
+    // Guards slot state changes for waiting threads
+    std::mutex stateMutex;
+    std::condition_variable stateChanged;
+    bool stopping;
+
+    // Producer / consumer positions (used by the submitting thread only)
+    uint64_t submitted;
+    uint64_t collected;
+
+    void stageLoop(int stage, int replica, int replicas);
+    void runStage(int stage, Slot& slot);
+
+    // Block until the slot reaches state (or the pipeline stops)
+    bool waitFor(Slot& slot, int state);
+    void advance(Slot& slot, int state);
+};
+
+#endif // FRAME_PIPELINE_H
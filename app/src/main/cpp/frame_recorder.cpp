@@ -0,0 +1,243 @@
+#include "frame_recorder.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define LOG_TAG "FrameRecorder"
+#include "native_log.h"
+
+namespace {
+
+// O_DIRECT transfers must be aligned to the logical block size; a page covers it
+const size_t kPageBytes = 4096;
+
+// Longest the writer sleeps before checking the ring again
+const std::chrono::milliseconds kIdleWait(20);
+
+} // namespace
+
+void FrameRecorder::AlignedDeleter::operator()(uint8_t* data) const {
+    free(data);
+}
+
+FrameRecorder::FrameRecorder(size_t frameBytes, int queueFrames, size_t batchBytes)
+        : frameBytes(frameBytes)
+        , slotCount(std::max(1, queueFrames))
+        , batchCapacity(std::max(kPageBytes, (batchBytes + kPageBytes - 1) & ~(kPageBytes - 1)))
+        , head(0)
+        , tail(0)
+        , batchFill(0)
+        , fd(-1)
+        , directIo(false)
+        , running(false)
+        , failed(false)
+        , statSubmitted(0)
+        , statWritten(0)
+        , statDropped(0)
+        , statBytes(0) {
+}
+
+FrameRecorder::~FrameRecorder() {
+    stop();
+}
+
+bool FrameRecorder::start(const std::string& path) {
+    if (fd >= 0) {
+        LOGE("Recorder already started");
+        return false;
+    }
+
+    int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+#ifdef O_DIRECT
+    fd = open(path.c_str(), flags | O_DIRECT, 0644);
+    directIo.store(fd >= 0);
+#endif
+    if (fd < 0) {
+        // tmpfs, FUSE and some SD card filesystems refuse O_DIRECT
+        fd = open(path.c_str(), flags, 0644);
+    }
+    if (fd < 0) {
+        LOGE("Cannot create %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    // Everything the recorder will ever need, allocated up front
+    void* memory = nullptr;
+    if (posix_memalign(&memory, kPageBytes, batchCapacity) != 0) {
+        LOGE("Cannot allocate %zu byte batch buffer", batchCapacity);
+        close(fd);
+        fd = -1;
+        return false;
+    }
+    batch.reset(static_cast<uint8_t*>(memory));
+    slots.resize(frameBytes * slotCount);
+
+    head.store(0, std::memory_order_relaxed);
+    tail.store(0, std::memory_order_relaxed);
+    batchFill = 0;
+    failed.store(false, std::memory_order_relaxed);
+    running.store(true, std::memory_order_release);
+    writer = std::thread(&FrameRecorder::writerLoop, this);
+
+    LOGI("Recording to %s: %zu-byte frames, %d slots, %zu-byte batches%s", path.c_str(),
+         frameBytes, slotCount, batchCapacity, directIo ? ", O_DIRECT" : "");
+    return true;
+}
+
+bool FrameRecorder::stop() {
+    if (fd < 0) {
+        return !failed.load();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        running.store(false, std::memory_order_release);
+    }
+    wake.notify_one();
+    writer.join();
+
+    if (close(fd) != 0) {
+        failed.store(true);
+    }
+    fd = -1;
+
+    // Release the memory; a stopped recorder holds nothing
+    std::vector<uint8_t>().swap(slots);
+    batch.reset();
+
+    LOGI("Recording stopped: %llu frames written, %llu dropped",
+         static_cast<unsigned long long>(statWritten.load()),
+         static_cast<unsigned long long>(statDropped.load()));
+    return !failed.load();
+}
+
+bool FrameRecorder::submit(const uint8_t* data, size_t bytes) {
+    statSubmitted.fetch_add(1, std::memory_order_relaxed);
+
+    if (!running.load(std::memory_order_acquire) || failed.load(std::memory_order_relaxed) ||
+        bytes != frameBytes) {
+        statDropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    uint64_t position = head.load(std::memory_order_relaxed);
+    if (position - tail.load(std::memory_order_acquire) >= static_cast<uint64_t>(slotCount)) {
+        // Writer behind: drop rather than stall the processing thread
+        statDropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    std::memcpy(slots.data() + frameBytes * (position % slotCount), data, bytes);
+    head.store(position + 1, std::memory_order_release);
+
+    // No lock: a missed wake-up only delays the writer by kIdleWait
+    wake.notify_one();
+    return true;
+}
+
+RecorderStats FrameRecorder::getStats() const {
+    RecorderStats stats;
+    stats.framesSubmitted = statSubmitted.load(std::memory_order_relaxed);
+    stats.framesWritten = statWritten.load(std::memory_order_relaxed);
+    stats.framesDropped = statDropped.load(std::memory_order_relaxed);
+    stats.bytesWritten = statBytes.load(std::memory_order_relaxed);
+    stats.directIo = directIo.load(std::memory_order_relaxed);
+    stats.failed = failed.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void FrameRecorder::writerLoop() {
+    for (;;) {
+        uint64_t position = tail.load(std::memory_order_relaxed);
+        if (position == head.load(std::memory_order_acquire)) {
+            if (!running.load(std::memory_order_acquire)) {
+                break;
+            }
+
+            // Idle: put the whole pages gathered so far on disk, then sleep
+            flushBatch(false);
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wake.wait_for(lock, kIdleWait, [this, position] {
+                return !running.load(std::memory_order_acquire) ||
+                       head.load(std::memory_order_acquire) != position;
+            });
+            continue;
+        }
+
+        const uint8_t* frame = slots.data() + frameBytes * (position % slotCount);
+        if (failed.load(std::memory_order_relaxed)) {
+            statDropped.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            // A frame may straddle several batches
+            size_t copied = 0;
+            while (copied < frameBytes) {
+                size_t chunk = std::min(frameBytes - copied, batchCapacity - batchFill);
+                std::memcpy(batch.get() + batchFill, frame + copied, chunk);
+                batchFill += chunk;
+                copied += chunk;
+                if (batchFill == batchCapacity) {
+                    flushBatch(false);
+                }
+            }
+            statWritten.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Slot free again
+        tail.store(position + 1, std::memory_order_release);
+    }
+
+    flushBatch(true);
+}
+
+bool FrameRecorder::flushBatch(bool final) {
+    if (batchFill == 0 || failed.load(std::memory_order_relaxed)) {
+        return !failed.load(std::memory_order_relaxed);
+    }
+
+    size_t bytes = directIo ? batchFill & ~(kPageBytes - 1) : batchFill;
+#ifdef O_DIRECT
+    if (final && bytes < batchFill) {
+        // The unaligned tail can only go through the page cache
+        int flags = fcntl(fd, F_GETFL);
+        if (flags >= 0 && fcntl(fd, F_SETFL, flags & ~O_DIRECT) == 0) {
+            directIo.store(false);
+            bytes = batchFill;
+        }
+    }
+#endif
+    if (bytes == 0) {
+        return true;
+    }
+
+    if (!writeAll(batch.get(), bytes)) {
+        LOGE("Write failed: %s - dropping further frames", strerror(errno));
+        failed.store(true, std::memory_order_relaxed);
+        batchFill = 0;
+        return false;
+    }
+
+    statBytes.fetch_add(bytes, std::memory_order_relaxed);
+    batchFill -= bytes;
+    std::memmove(batch.get(), batch.get() + bytes, batchFill);
+    return true;
+}
+
+bool FrameRecorder::writeAll(const uint8_t* data, size_t bytes) {
+    while (bytes > 0) {
+        ssize_t n = write(fd, data, bytes);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        bytes -= n;
+    }
+    return true;
+}
@@ -0,0 +1,109 @@
+#ifndef FRAME_RECORDER_H
+#define FRAME_RECORDER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Recorder counters snapshot (see FrameRecorder::getStats)
+ */
+struct RecorderStats {
+    uint64_t framesSubmitted;
+    uint64_t framesWritten;
+    uint64_t framesDropped;  // Queue full, wrong size or writer failed
+    uint64_t bytesWritten;
+    bool directIo;           // Batches bypass the page cache (O_DIRECT)
+    bool failed;             // A write failed; later frames are dropped
+};
+
+/**
+ * Asynchronous recorder for processed frames
+ *
+ * submit() copies a frame into a free slot of a fixed ring and returns; it
+ * never waits for the disk or a lock. If no slot is free the frame is
+ * dropped and counted. A writer thread drains the ring into a page-aligned
+ * batch buffer and writes full batches with O_DIRECT where the filesystem
+ * allows it, buffered write() otherwise. All memory is allocated by start(),
+ * so recording for hours does not grow the footprint.
+ *
+ * The file holds the frames back to back (a raw sequence file).
+ */
+class FrameRecorder {
+public:
+    /**
+     * @param frameBytes Size of every frame
+     * @param queueFrames Frames the ring can hold while the writer is busy
+     * @param batchBytes Target size of one write (rounded to whole pages)
+     */
+    FrameRecorder(size_t frameBytes, int queueFrames, size_t batchBytes = 4 << 20);
+    ~FrameRecorder();
+
+    FrameRecorder(const FrameRecorder&) = delete;
+    FrameRecorder& operator=(const FrameRecorder&) = delete;
+
+    /**
+     * Create the file and start the writer thread
+     */
+    bool start(const std::string& path);
+
+    /**
+     * Write everything queued, then close the file
+     * @return false if any write failed
+     */
+    bool stop();
+
+    /**
+     * Queue a frame without blocking (single producer)
+     * @return false if the frame was dropped
+     */
+    bool submit(const uint8_t* data, size_t bytes);
+
+    RecorderStats getStats() const;
+
+    size_t frameSize() const { return frameBytes; }
+
+private:
+    struct AlignedDeleter {
+        void operator()(uint8_t* data) const;
+    };
+    typedef std::unique_ptr<uint8_t[], AlignedDeleter> AlignedBuffer;
+
+    const size_t frameBytes;
+    const int slotCount;
+    const size_t batchCapacity;
+
+    // Ring of frame slots; head is advanced by submit(), tail by the writer
+    std::vector<uint8_t> slots;
+    std::atomic<uint64_t> head;
+    std::atomic<uint64_t> tail;
+
+    AlignedBuffer batch;
+    size_t batchFill;
+
+    int fd;
+    std::atomic<bool> directIo;
+    std::thread writer;
+    std::atomic<bool> running;
+    std::atomic<bool> failed;
+
+    // Only used to let the writer sleep; submit() never takes the mutex
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+
+    std::atomic<uint64_t> statSubmitted;
+    std::atomic<uint64_t> statWritten;
+    std::atomic<uint64_t> statDropped;
+    std::atomic<uint64_t> statBytes;
+
+    void writerLoop();
+    bool flushBatch(bool final);
+    bool writeAll(const uint8_t* data, size_t bytes);
+};
+
+#endif // FRAME_RECORDER_H
@@ -0,0 +1,536 @@
+#include "gaussian_blur.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "thread_pool.h"
+
+namespace {
+
+// Separable weights: 8 fractional bits per pass, so 255 * 2^8 fits the
+// 16-bit intermediate and 2^16 * 2^8 the 32-bit accumulator
+const int kWeightBits = 8;
+const int kWeightOne = 1 << kWeightBits;
+const int kOutputShift = 2 * kWeightBits;
+const uint32_t kOutputRound = 1u << (kOutputShift - 1);
+
+// Kernels generated at compile time: sizes 3, 5, 7, 9 x sigma 0.1 .. 3.0
+const int kTableSizes = 4;
+const int kTableSigmaSteps = 30;
+constexpr double kTableSigmaStep = 0.1;
+
+// BLUR_AUTO: separable up to this kernel size, then box up to this sigma
+const int kAutoSeparableKernel = 9;
+const double kAutoBoxSigma = 8.0;
+
+// The recursive coefficients are fitted for sigma >= 0.5
+const double kMinRecursiveSigma = 0.5;
+
+// Box cascade length (odd, so the vertical passes end in the destination)
+const int kBoxPasses = 3;
+static_assert(kBoxPasses % 2 == 1, "vertical box passes must end in the destination");
+
+// Box average as multiply and shift: 255 * width * (2^22 / width) fits a uint32
+const int kBoxShift = 22;
+const uint32_t kBoxRound = 1u << (kBoxShift - 1);
+
+// Rows per task for horizontal passes, columns per task for vertical ones
+const int kRowGrain = 16;
+const int kColumnStrip = 64;
+
+/**
+ * exp(x) for x <= 0, usable in constant expressions (std::exp is not)
+ * Halves x into [-0.5, 0] for the series, then squares the result back.
+ */
+constexpr double constexprExp(double x) {
+    int halvings = 0;
+    while (x < -0.5) {
+        x *= 0.5;
+        ++halvings;
+    }
+    double term = 1.0;
+    double sum = 1.0;
+    for (int n = 1; n < 14; ++n) {
+        term *= x / n;
+        sum += term;
+    }
+    for (; halvings > 0; --halvings) {
+        sum *= sum;
+    }
+    return sum;
+}
+
+/**
+ * Fixed-point 1-D Gaussian
+ */
+struct FixedKernel {
+    int size;
+    uint16_t weights[kMaxSeparableKernel];  // Summing to kWeightOne
+};
+
+constexpr FixedKernel makeKernel(int size, double sigma) {
+    FixedKernel kernel{size, {}};
+    double exact[kMaxSeparableKernel] = {};
+    double total = 0.0;
+    int center = size / 2;
+    for (int i = 0; i < size; ++i) {
+        double d = i - center;
+        exact[i] = constexprExp(-d * d / (2.0 * sigma * sigma));
+        total += exact[i];
+    }
+
+    // The center tap absorbs the rounding so the weights sum to one
+    int sum = 0;
+    for (int i = 0; i < size; ++i) {
+        kernel.weights[i] = static_cast<uint16_t>(exact[i] / total * kWeightOne + 0.5);
+        sum += kernel.weights[i];
+    }
+    kernel.weights[center] = static_cast<uint16_t>(kernel.weights[center] + kWeightOne - sum);
+    return kernel;
+}
+
+struct KernelTable {
+    FixedKernel kernels[kTableSizes][kTableSigmaSteps];
+};
+
+constexpr KernelTable makeKernelTable() {
+    KernelTable table{};
+    for (int s = 0; s < kTableSizes; ++s) {
+        for (int i = 0; i < kTableSigmaSteps; ++i) {
+            table.kernels[s][i] = makeKernel(3 + 2 * s, (i + 1) * kTableSigmaStep);
+        }
+    }
+    return table;
+}
+
+constexpr KernelTable kKernelTable = makeKernelTable();
+
+// Checks on the default blur's kernel (5 taps, sigma 1.5)
+static_assert(kKernelTable.kernels[1][14].weights[0] == kKernelTable.kernels[1][14].weights[4],
+              "kernels are symmetric");
+static_assert(kKernelTable.kernels[1][14].weights[0] + kKernelTable.kernels[1][14].weights[1]
+              + kKernelTable.kernels[1][14].weights[2] + kKernelTable.kernels[1][14].weights[3]
+              + kKernelTable.kernels[1][14].weights[4] == kWeightOne,
+              "kernel weights sum to one");
+
+/**
+ * Kernel from the table when the parameters are on its grid, else built now
+ */
+FixedKernel kernelFor(int size, double sigma) {
+    int step = static_cast<int>(std::lround(sigma / kTableSigmaStep));
+    if (size <= 1 + 2 * kTableSizes && step >= 1 && step <= kTableSigmaSteps
+            && std::fabs(sigma - step * kTableSigmaStep) < 1e-6) {
+        return kKernelTable.kernels[(size - 3) / 2][step - 1];
+    }
+    return makeKernel(size, sigma);
+}
+
+// Index into [0, length) mirrored at the ends without repeating the edge
+inline int reflect101(int i, int length) {
+    if (length == 1) {
+        return 0;
+    }
+    while (i < 0 || i >= length) {
+        i = i < 0 ? -i : 2 * length - 2 - i;
+    }
+    return i;
+}
+
+// Copy a row with radius mirrored pixels on each side
+void extendRow(const uint8_t* row, int width, int radius, uint8_t* extended) {
+    for (int i = -radius; i < 0; ++i) {
+        extended[i + radius] = row[reflect101(i, width)];
+    }
+    std::copy(row, row + width, extended + radius);
+    for (int i = width; i < width + radius; ++i) {
+        extended[i + radius] = row[reflect101(i, width)];
+    }
+}
+
+void parallelRange(int count, int grain, const std::function<void(int, int)>& body) {
+    ThreadPool* pool = ThreadPool::current();
+    if (pool) {
+        pool->parallelFor(0, count, grain, body);
+    } else {
+        body(0, count);
+    }
+}
+
+void blurSeparable(const cv::Mat& source, cv::Mat& destination, const FixedKernel& kernel,
+                   ScratchBuffer& scratch) {
+    int width = source.cols;
+    int height = source.rows;
+    int radius = kernel.size / 2;
+
+    // Horizontal pass into 16-bit rows (8 fractional bits). Loops run over
+    // taps outside and pixels inside, so the compiler vectorizes the latter.
+    cv::Mat rows = scratch.get(height, width, CV_16UC1);
+    parallelRange(height, kRowGrain, [&](int begin, int end) {
+        std::vector<uint8_t> extended(width + 2 * radius);
+        for (int y = begin; y < end; ++y) {
+            extendRow(source.ptr<uint8_t>(y), width, radius, extended.data());
+            uint16_t* out = rows.ptr<uint16_t>(y);
+            std::fill(out, out + width, 0);
+            for (int k = 0; k < kernel.size; ++k) {
+                const uint8_t* in = extended.data() + k;
+                uint16_t weight = kernel.weights[k];
+                for (int x = 0; x < width; ++x) {
+                    out[x] = static_cast<uint16_t>(out[x] + weight * in[x]);
+                }
+            }
+        }
+    });
+
+    // Vertical pass over mirrored rows of the intermediate
+    parallelRange(height, kRowGrain, [&](int begin, int end) {
+        std::vector<uint32_t> accumulator(width);
+        for (int y = begin; y < end; ++y) {
+            std::fill(accumulator.begin(), accumulator.end(), kOutputRound);
+            for (int k = 0; k < kernel.size; ++k) {
+                const uint16_t* in = rows.ptr<uint16_t>(reflect101(y + k - radius, height));
+                uint32_t weight = kernel.weights[k];
+                for (int x = 0; x < width; ++x) {
+                    accumulator[x] += weight * in[x];
+                }
+            }
+            uint8_t* out = destination.ptr<uint8_t>(y);
+            for (int x = 0; x < width; ++x) {
+                out[x] = static_cast<uint8_t>(accumulator[x] >> kOutputShift);
+            }
+        }
+    });
+}
+
+/**
+ * Box radii whose cascade has the Gaussian's variance (widths w and w + 2)
+ */
+void boxRadii(double sigma, int* radii) {
+    double variance = 12.0 * sigma * sigma;
+    int lower = static_cast<int>(std::floor(std::sqrt(variance / kBoxPasses + 1.0)));
+    if (lower % 2 == 0) {
+        --lower;
+    }
+    int upper = lower + 2;
+    double narrow = (variance - kBoxPasses * (lower * lower + 4.0 * lower + 3.0))
+                    / (-4.0 * lower - 4.0);
+    int narrowCount = static_cast<int>(std::lround(narrow));
+    for (int i = 0; i < kBoxPasses; ++i) {
+        radii[i] = ((i < narrowCount ? lower : upper) - 1) / 2;
+    }
+}
+
+inline uint32_t boxScale(int radius) {
+    uint32_t size = 2 * radius + 1;
+    return ((1u << kBoxShift) + size / 2) / size;
+}
+
+// One horizontal box pass with a running sum
+void boxRow(const uint8_t* in, uint8_t* out, int width, int radius, uint8_t* extended) {
+    extendRow(in, width, radius, extended);
+    int size = 2 * radius + 1;
+    uint32_t scale = boxScale(radius);
+    uint32_t sum = 0;
+    for (int k = 0; k < size; ++k) {
+        sum += extended[k];
+    }
+    for (int x = 0; x < width; ++x) {
+        if (x > 0) {
+            sum += extended[x + size - 1];
+            sum -= extended[x - 1];
+        }
+        out[x] = static_cast<uint8_t>((sum * scale + kBoxRound) >> kBoxShift);
+    }
+}
+
+// One vertical box pass; column strips keep a row of running sums each
+void boxColumns(const cv::Mat& source, cv::Mat& destination, int radius) {
+    int height = source.rows;
+    uint32_t scale = boxScale(radius);
+    parallelRange(source.cols, kColumnStrip, [&](int begin, int end) {
+        int count = end - begin;
+        std::vector<uint32_t> sums(count, 0);
+        for (int k = -radius; k <= radius; ++k) {
+            const uint8_t* in = source.ptr<uint8_t>(reflect101(k, height)) + begin;
+            for (int x = 0; x < count; ++x) {
+                sums[x] += in[x];
+            }
+        }
+        for (int y = 0; y < height; ++y) {
+            if (y > 0) {
+                const uint8_t* add = source.ptr<uint8_t>(reflect101(y + radius, height)) + begin;
+                const uint8_t* remove =
+                        source.ptr<uint8_t>(reflect101(y - radius - 1, height)) + begin;
+                for (int x = 0; x < count; ++x) {
+                    sums[x] += add[x];
+                    sums[x] -= remove[x];
+                }
+            }
+            uint8_t* out = destination.ptr<uint8_t>(y) + begin;
+            for (int x = 0; x < count; ++x) {
+                out[x] = static_cast<uint8_t>((sums[x] * scale + kBoxRound) >> kBoxShift);
+            }
+        }
+    });
+}
+
+void blurBox(const cv::Mat& source, cv::Mat& destination, double sigma, ScratchBuffer& scratch) {
+    int width = source.cols;
+    int height = source.rows;
+    int radii[kBoxPasses];
+    boxRadii(sigma, radii);
+    int maxRadius = *std::max_element(radii, radii + kBoxPasses);
+
+    // Horizontal passes run back to back on one row while it is in L1
+    cv::Mat temp = scratch.get(height, width, CV_8UC1);
+    parallelRange(height, kRowGrain, [&](int begin, int end) {
+        std::vector<uint8_t> extended(width + 2 * maxRadius);
+        std::vector<uint8_t> rows[2] = {std::vector<uint8_t>(width), std::vector<uint8_t>(width)};
+        for (int y = begin; y < end; ++y) {
+            const uint8_t* in = source.ptr<uint8_t>(y);
+            for (int pass = 0; pass < kBoxPasses; ++pass) {
+                uint8_t* out = pass == kBoxPasses - 1 ? temp.ptr<uint8_t>(y)
+                                                       : rows[pass % 2].data();
+                boxRow(in, out, width, radii[pass], extended.data());
+                in = out;
+            }
+        }
+    });
+
+    // Vertical passes alternate between the intermediate and the destination
+    // (the source is no longer needed, so it may be the destination)
+    for (int pass = 0; pass < kBoxPasses; ++pass) {
+        if (pass % 2 == 0) {
+            boxColumns(temp, destination, radii[pass]);
+        } else {
+            boxColumns(destination, temp, radii[pass]);
+        }
+    }
+}
+
+/**
+ * Young / van Vliet recursive Gaussian:
+ * w[n] = b * x[n] + a1 * w[n - 1] + a2 * w[n - 2] + a3 * w[n - 3], then the
+ * same backwards over w
+ */
+struct RecursiveCoefficients {
+    float b;
+    float a1, a2, a3;
+};
+
+RecursiveCoefficients recursiveCoefficients(double sigma) {
+    double q = sigma >= 2.5 ? 0.98711 * sigma - 0.96330
+                            : 3.97156 - 4.14554 * std::sqrt(1.0 - 0.26891 * sigma);
+    double q2 = q * q;
+    double q3 = q2 * q;
+    double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+    double b1 = 2.44413 * q + 2.85619 * q2 + 1.26661 * q3;
+    double b2 = -(1.4281 * q2 + 1.26661 * q3);
+    double b3 = 0.422205 * q3;
+
+    RecursiveCoefficients c;
+    c.a1 = static_cast<float>(b1 / b0);
+    c.a2 = static_cast<float>(b2 / b0);
+    c.a3 = static_cast<float>(b3 / b0);
+    c.b = 1.0f - (c.a1 + c.a2 + c.a3);
+    return c;
+}
+
+// One step of the recursion over contiguous values; the state rows shift down
+inline void recursiveStep(const float* in, float* out, float* s1, float* s2, float* s3,
+                          int count, const RecursiveCoefficients& c) {
+    for (int x = 0; x < count; ++x) {
+        float w = c.b * in[x] + c.a1 * s1[x] + c.a2 * s2[x] + c.a3 * s3[x];
+        out[x] = w;
+        s3[x] = s2[x];
+        s2[x] = s1[x];
+        s1[x] = w;
+    }
+}
+
+// Both directions along a row extended by warmUp mirrored pixels on each side
+void recursiveRow(const uint8_t* extended, float* values, int length,
+                  const RecursiveCoefficients& c) {
+    float w1 = extended[0];
+    float w2 = w1;
+    float w3 = w1;
+    for (int x = 0; x < length; ++x) {
+        float w = c.b * extended[x] + c.a1 * w1 + c.a2 * w2 + c.a3 * w3;
+        values[x] = w;
+        w3 = w2;
+        w2 = w1;
+        w1 = w;
+    }
+
+    w1 = values[length - 1];
+    w2 = w1;
+    w3 = w1;
+    for (int x = length - 1; x >= 0; --x) {
+        float w = c.b * values[x] + c.a1 * w1 + c.a2 * w2 + c.a3 * w3;
+        values[x] = w;
+        w3 = w2;
+        w2 = w1;
+        w1 = w;
+    }
+}
+
+void blurRecursive(const cv::Mat& source, cv::Mat& destination, double sigma,
+                   ScratchBuffer& scratch) {
+    int width = source.cols;
+    int height = source.rows;
+    RecursiveCoefficients c = recursiveCoefficients(sigma);
+
+    // The recursion runs over warmUp mirrored pixels before and after the
+    // image, so its state has settled at the borders (BORDER_REFLECT_101 like
+    // the other engines); beyond that it starts from the edge value
+    int warmUp = static_cast<int>(std::ceil(3.0 * sigma));
+
+    cv::Mat temp = scratch.get(height, width, CV_32FC1);
+    parallelRange(height, kRowGrain, [&](int begin, int end) {
+        std::vector<uint8_t> extended(width + 2 * warmUp);
+        std::vector<float> values(width + 2 * warmUp);
+        for (int y = begin; y < end; ++y) {
+            extendRow(source.ptr<uint8_t>(y), width, warmUp, extended.data());
+            recursiveRow(extended.data(), values.data(), width + 2 * warmUp, c);
+            std::copy(values.begin() + warmUp, values.begin() + warmUp + width,
+                      temp.ptr<float>(y));
+        }
+    });
+
+    // Vertical: a strip of columns is filtered a row at a time, so the
+    // recursion runs across contiguous pixels and vectorizes
+    parallelRange(width, kColumnStrip, [&](int begin, int end) {
+        int count = end - begin;
+        std::vector<float> state(3 * count);
+        float* s1 = state.data();
+        float* s2 = s1 + count;
+        float* s3 = s2 + count;
+        std::vector<float> discard(count);
+
+        // Rows past the bottom edge, copied before the forward pass overwrites them
+        std::vector<float> after(static_cast<size_t>(warmUp) * count);
+        for (int i = 0; i < warmUp; ++i) {
+            const float* row = temp.ptr<float>(reflect101(height + i, height)) + begin;
+            std::copy(row, row + count, after.begin() + static_cast<size_t>(i) * count);
+        }
+
+        const float* first = temp.ptr<float>(reflect101(-warmUp, height)) + begin;
+        std::copy(first, first + count, s1);
+        std::copy(first, first + count, s2);
+        std::copy(first, first + count, s3);
+        for (int y = -warmUp; y < 0; ++y) {
+            recursiveStep(temp.ptr<float>(reflect101(y, height)) + begin, discard.data(),
+                          s1, s2, s3, count, c);
+        }
+        for (int y = 0; y < height; ++y) {
+            float* row = temp.ptr<float>(y) + begin;
+            recursiveStep(row, row, s1, s2, s3, count, c);
+        }
+        for (int i = 0; i < warmUp; ++i) {
+            float* row = after.data() + static_cast<size_t>(i) * count;
+            recursiveStep(row, row, s1, s2, s3, count, c);
+        }
+
+        const float* last = warmUp > 0 ? after.data() + static_cast<size_t>(warmUp - 1) * count
+                                       : temp.ptr<float>(height - 1) + begin;
+        std::copy(last, last + count, s1);
+        std::copy(last, last + count, s2);
+        std::copy(last, last + count, s3);
+        for (int i = warmUp - 1; i >= 0; --i) {
+            recursiveStep(after.data() + static_cast<size_t>(i) * count, discard.data(),
+                          s1, s2, s3, count, c);
+        }
+        for (int y = height - 1; y >= 0; --y) {
+            float* row = temp.ptr<float>(y) + begin;
+            recursiveStep(row, row, s1, s2, s3, count, c);
+            uint8_t* out = destination.ptr<uint8_t>(y) + begin;
+            for (int x = 0; x < count; ++x) {
+                out[x] = static_cast<uint8_t>(std::min(std::max(row[x] + 0.5f, 0.0f), 255.0f));
+            }
+        }
+    });
+}
+
+} // namespace
+
+int gaussianKernelSize(double sigma) {
+    return std::max(static_cast<int>(std::lround(sigma * 6.0 + 1.0)) | 1, 1);
+}
+
+double gaussianSigma(int kernelSize) {
+    return 0.3 * ((kernelSize - 1) * 0.5 - 1.0) + 0.8;
+}
+
+BlurMethod resolveBlurMethod(BlurMethod method, int kernelSize, double sigma) {
+    if (kernelSize <= 0) {
+        kernelSize = gaussianKernelSize(sigma);
+    }
+    if (sigma <= 0.0) {
+        sigma = gaussianSigma(kernelSize);
+    }
+
+    switch (method) {
+        case BLUR_SEPARABLE:
+            return kernelSize <= kMaxSeparableKernel ? BLUR_SEPARABLE : BLUR_BOX;
+        case BLUR_BOX:
+            return BLUR_BOX;
+        case BLUR_RECURSIVE:
+            return sigma >= kMinRecursiveSigma
+                   ? BLUR_RECURSIVE : resolveBlurMethod(BLUR_SEPARABLE, kernelSize, sigma);
+        default:
+            if (kernelSize <= kAutoSeparableKernel) {
+                return BLUR_SEPARABLE;
+            }
+            return sigma <= kAutoBoxSigma ? BLUR_BOX : BLUR_RECURSIVE;
+    }
+}
+
+int gaussianBlurRadius(BlurMethod method, int kernelSize, double sigma) {
+    if (kernelSize <= 0) {
+        kernelSize = gaussianKernelSize(sigma);
+    }
+    if (sigma <= 0.0) {
+        sigma = gaussianSigma(kernelSize);
+    }
+    if (resolveBlurMethod(method, kernelSize, sigma) == BLUR_SEPARABLE) {
+        return kernelSize / 2;
+    }
+    // Box cascades and the recursive filter follow sigma; 3 sigma holds 99.7%
+    return static_cast<int>(std::ceil(3.0 * sigma));
+}
+
+void gaussianBlur(const cv::Mat& source, cv::Mat& destination, int kernelSize, double sigma,
+                  BlurMethod method, ScratchBuffer& scratch) {
+    CV_Assert(source.type() == CV_8UC1 && destination.type() == CV_8UC1);
+    CV_Assert(source.rows == destination.rows && source.cols == destination.cols);
+    if (source.empty()) {
+        return;
+    }
+
+    if (kernelSize <= 0) {
+        kernelSize = gaussianKernelSize(sigma);
+    }
+    if (sigma <= 0.0) {
+        sigma = gaussianSigma(kernelSize);
+    }
+    if (kernelSize < 3) {
+        if (source.data != destination.data) {
+            source.copyTo(destination);
+        }
+        return;
+    }
+
+    switch (resolveBlurMethod(method, kernelSize, sigma)) {
+        case BLUR_BOX:
+            blurBox(source, destination, sigma, scratch);
+            break;
+        case BLUR_RECURSIVE:
+            blurRecursive(source, destination, sigma, scratch);
+            break;
+        default:
+            blurSeparable(source, destination, kernelFor(kernelSize, sigma), scratch);
+            break;
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef GAUSSIAN_BLUR_H
+#define GAUSSIAN_BLUR_H
+
+#include <opencv2/opencv.hpp>
+
+#include "scratch_buffer.h"
+
+/**
+ * Gaussian blur for 8-bit planes with engines for different kernel sizes
+ *
+ * - Separable: fixed-point taps (8 fractional bits per pass, like OpenCV's
+ *   bit-exact 8-bit path). Kernels for the common sizes are generated at
+ *   compile time; cost grows with the kernel size.
+ * - Box: three box filters of widths chosen to match sigma (running sums,
+ *   integer only). Cost does not depend on sigma.
+ * - Recursive: Young / van Vliet third-order IIR in float, run forwards and
+ *   backwards. Cost does not depend on sigma, and it stays accurate where the
+ *   box cascade gets blocky.
+ *
+ * All engines mirror the image at its borders (BORDER_REFLECT_101, OpenCV's
+ * default). Rows, or column strips for vertical passes, are spread over the
+ * thread pool bound to the calling thread, if any.
+ */
+
+enum BlurMethod {
+    BLUR_AUTO = 0,        // Fastest engine for the kernel size and sigma
+    BLUR_SEPARABLE = 1,
+    BLUR_BOX = 2,
+    BLUR_RECURSIVE = 3
+};
+
+// Largest kernel the separable engine takes; larger ones fall back to box
+const int kMaxSeparableKernel = 31;
+
+/**
+ * Kernel size cv::GaussianBlur derives from sigma for 8-bit images
+ */
+int gaussianKernelSize(double sigma);
+
+/**
+ * Sigma cv::GaussianBlur derives from the kernel size
+ */
+double gaussianSigma(int kernelSize);
+
+/**
+ * Engine a blur runs on
+ * Resolves BLUR_AUTO, and requests an engine cannot serve (e.g. a separable
+ * kernel above kMaxSeparableKernel).
+ * @param kernelSize Odd size, or 0 to derive it from sigma
+ * @param sigma Standard deviation, or <= 0 to derive it from kernelSize
+ */
+BlurMethod resolveBlurMethod(BlurMethod method, int kernelSize, double sigma);
+
+/**
+ * Pixels a blur reads on each side of an output pixel (3 sigma for the
+ * box and recursive engines, whose support is unbounded or sigma-driven)
+ */
+int gaussianBlurRadius(BlurMethod method, int kernelSize, double sigma);
+
+/**
+ * Blur an 8-bit plane
+ * The box and recursive engines follow sigma alone.
+ * @param source CV_8UC1 image (may be a view, or the destination itself)
+ * @param destination CV_8UC1 image of the same size
+ * @param kernelSize Odd size, or 0 to derive it from sigma
+ * @param sigma Standard deviation, or <= 0 to derive it from kernelSize
+ * @param scratch Intermediate image storage
+ */
+void gaussianBlur(const cv::Mat& source, cv::Mat& destination, int kernelSize, double sigma,
+                  BlurMethod method, ScratchBuffer& scratch);
+
+#endif // GAUSSIAN_BLUR_H
@@ -0,0 +1,259 @@
+#include "gradient_edges.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "thread_pool.h"
+
+namespace {
+
+// Rows per task
+const int kRowGrain = 16;
+
+// Largest threshold in Sobel units that still fits the int16 lanes once scaled
+const int kMaxSobelThreshold = 8191;
+
+/**
+ * Operator weights: side, center, side across the derivative direction
+ * kShift scales the magnitude of a full-contrast step (255 * weight sum) to 255.
+ */
+struct Sobel {
+    static constexpr int kSide = 1;
+    static constexpr int kCenter = 2;
+    static constexpr int kShift = 2;
+};
+
+struct Scharr {
+    static constexpr int kSide = 3;
+    static constexpr int kCenter = 10;
+    static constexpr int kShift = 4;
+};
+
+// Index into [0, length) mirrored at the ends without repeating the edge
+inline int reflect101(int i, int length) {
+    if (length == 1) {
+        return 0;
+    }
+    return i < 0 ? -i : (i >= length ? 2 * length - 2 - i : i);
+}
+
+void parallelRange(int count, int grain, const std::function<void(int, int)>& body) {
+    ThreadPool* pool = ThreadPool::current();
+    if (pool) {
+        pool->parallelFor(0, count, grain, body);
+    } else {
+        body(0, count);
+    }
+}
+
+inline uint8_t edgeValue(int strength, int threshold, int shift) {
+    if (threshold > 0) {
+        return strength >= threshold ? 255 : 0;
+    }
+    strength >>= shift;
+    return static_cast<uint8_t>(strength > 255 ? 255 : strength);
+}
+
+template <typename Op>
+inline int magnitudeAt(const uint8_t* above, const uint8_t* row, const uint8_t* below,
+                       int left, int x, int right) {
+    int gx = Op::kSide * (above[right] - above[left]) + Op::kCenter * (row[right] - row[left])
+             + Op::kSide * (below[right] - below[left]);
+    int gy = Op::kSide * (below[left] - above[left]) + Op::kCenter * (below[x] - above[x])
+             + Op::kSide * (below[right] - above[right]);
+    return std::abs(gx) + std::abs(gy);
+}
+
+#if !defined(__ARM_NEON) && defined(__SSE2__)
+inline __m128i load8(const uint8_t* p, __m128i zero) {
+    return _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)), zero);
+}
+
+// SSE2 has no 16-bit abs (SSSE3 does)
+inline __m128i abs16(__m128i v, __m128i zero) {
+    return _mm_max_epi16(v, _mm_sub_epi16(zero, v));
+}
+#endif
+
+/**
+ * One output row: both derivatives, magnitude and threshold / scale fused
+ * @param threshold In the operator's own units; 0 = scaled magnitude
+ */
+template <typename Op>
+void gradientRow(const uint8_t* above, const uint8_t* row, const uint8_t* below, uint8_t* out,
+                 int width, int threshold) {
+    if (width == 1) {
+        out[0] = edgeValue(magnitudeAt<Op>(above, row, below, 0, 0, 0), threshold, Op::kShift);
+        return;
+    }
+
+    out[0] = edgeValue(magnitudeAt<Op>(above, row, below, 1, 0, 1), threshold, Op::kShift);
+    int x = 1;
+
+#if defined(__ARM_NEON)
+    const int16x8_t limit = vdupq_n_s16(static_cast<int16_t>(threshold));
+    for (; x + 9 <= width; x += 8) {
+        int16x8_t al = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(above + x - 1)));
+        int16x8_t am = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(above + x)));
+        int16x8_t ar = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(above + x + 1)));
+        int16x8_t bl = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(row + x - 1)));
+        int16x8_t br = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(row + x + 1)));
+        int16x8_t cl = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(below + x - 1)));
+        int16x8_t cm = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(below + x)));
+        int16x8_t cr = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(below + x + 1)));
+
+        int16x8_t gx = vmulq_n_s16(vaddq_s16(vsubq_s16(ar, al), vsubq_s16(cr, cl)), Op::kSide);
+        gx = vmlaq_n_s16(gx, vsubq_s16(br, bl), Op::kCenter);
+        int16x8_t gy = vmulq_n_s16(vaddq_s16(vsubq_s16(cl, al), vsubq_s16(cr, ar)), Op::kSide);
+        gy = vmlaq_n_s16(gy, vsubq_s16(cm, am), Op::kCenter);
+        int16x8_t magnitude = vaddq_s16(vabsq_s16(gx), vabsq_s16(gy));
+
+        uint8x8_t result = threshold > 0 ? vmovn_u16(vcgeq_s16(magnitude, limit))
+                                         : vqshrun_n_s16(magnitude, Op::kShift);
+        vst1_u8(out + x, result);
+    }
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i side = _mm_set1_epi16(Op::kSide);
+    const __m128i center = _mm_set1_epi16(Op::kCenter);
+    const __m128i limit = _mm_set1_epi16(static_cast<short>(threshold - 1));
+    const __m128i lowByte = _mm_set1_epi16(0xFF);
+    for (; x + 9 <= width; x += 8) {
+        __m128i al = load8(above + x - 1, zero);
+        __m128i am = load8(above + x, zero);
+        __m128i ar = load8(above + x + 1, zero);
+        __m128i bl = load8(row + x - 1, zero);
+        __m128i br = load8(row + x + 1, zero);
+        __m128i cl = load8(below + x - 1, zero);
+        __m128i cm = load8(below + x, zero);
+        __m128i cr = load8(below + x + 1, zero);
+
+        __m128i gx = _mm_add_epi16(
+                _mm_mullo_epi16(_mm_add_epi16(_mm_sub_epi16(ar, al), _mm_sub_epi16(cr, cl)), side),
+                _mm_mullo_epi16(_mm_sub_epi16(br, bl), center));
+        __m128i gy = _mm_add_epi16(
+                _mm_mullo_epi16(_mm_add_epi16(_mm_sub_epi16(cl, al), _mm_sub_epi16(cr, ar)), side),
+                _mm_mullo_epi16(_mm_sub_epi16(cm, am), center));
+        __m128i magnitude = _mm_add_epi16(abs16(gx, zero), abs16(gy, zero));
+
+        __m128i result = threshold > 0
+                         ? _mm_and_si128(_mm_cmpgt_epi16(magnitude, limit), lowByte)
+                         : _mm_srli_epi16(magnitude, Op::kShift);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + x), _mm_packus_epi16(result, zero));
+    }
+#endif
+
+    for (; x < width - 1; ++x) {
+        out[x] = edgeValue(magnitudeAt<Op>(above, row, below, x - 1, x, x + 1), threshold,
+                           Op::kShift);
+    }
+    out[width - 1] = edgeValue(magnitudeAt<Op>(above, row, below, width - 2, width - 1,
+                                               width - 2), threshold, Op::kShift);
+}
+
+template <typename Op>
+void gradientImage(const cv::Mat& source, cv::Mat& destination, int threshold) {
+    int width = source.cols;
+    int height = source.rows;
+
+    // Thresholds are given in Sobel units; other operators respond (sum / 4) times stronger
+    int scaled = std::min(threshold, kMaxSobelThreshold) << (Op::kShift - Sobel::kShift);
+
+    parallelRange(height, kRowGrain, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            gradientRow<Op>(source.ptr<uint8_t>(reflect101(y - 1, height)),
+                            source.ptr<uint8_t>(y),
+                            source.ptr<uint8_t>(reflect101(y + 1, height)),
+                            destination.ptr<uint8_t>(y), width, scaled);
+        }
+    });
+}
+
+// 4-neighbour Laplacian of one row (plain loops; the compiler vectorizes the interior)
+void laplacianRow(const uint8_t* above, const uint8_t* row, const uint8_t* below, int16_t* out,
+                  int width) {
+    if (width == 1) {
+        out[0] = static_cast<int16_t>(above[0] + below[0] - 2 * row[0]);
+        return;
+    }
+    out[0] = static_cast<int16_t>(above[0] + below[0] + 2 * row[1] - 4 * row[0]);
+    for (int x = 1; x < width - 1; ++x) {
+        out[x] = static_cast<int16_t>(above[x] + below[x] + row[x - 1] + row[x + 1] - 4 * row[x]);
+    }
+    out[width - 1] = static_cast<int16_t>(above[width - 1] + below[width - 1]
+                                          + 2 * row[width - 2] - 4 * row[width - 1]);
+}
+
+// Jump across a strict sign change between two Laplacian values, else 0
+// (a zero next to a peak is its flank, not a second crossing)
+inline int crossingJump(int a, int b) {
+    return a * b < 0 ? std::abs(a - b) : 0;
+}
+
+void crossingRow(const int16_t* row, const int16_t* below, uint8_t* out, int width,
+                 int threshold) {
+    for (int x = 0; x < width - 1; ++x) {
+        int jump = std::max(crossingJump(row[x], row[x + 1]), crossingJump(row[x], below[x]));
+        out[x] = edgeValue(jump, threshold, 0);
+    }
+    out[width - 1] = edgeValue(crossingJump(row[width - 1], below[width - 1]), threshold, 0);
+}
+
+} // namespace
+
+void gradientMagnitude(const cv::Mat& source, cv::Mat& destination, GradientOperator op,
+                       int threshold) {
+    CV_Assert(source.type() == CV_8UC1 && destination.type() == CV_8UC1);
+    CV_Assert(source.rows == destination.rows && source.cols == destination.cols);
+    if (source.empty()) {
+        return;
+    }
+
+    if (op == GRADIENT_SCHARR) {
+        gradientImage<Scharr>(source, destination, threshold);
+    } else {
+        gradientImage<Sobel>(source, destination, threshold);
+    }
+}
+
+void laplacianZeroCrossings(const cv::Mat& source, cv::Mat& destination, int threshold) {
+    CV_Assert(source.type() == CV_8UC1 && destination.type() == CV_8UC1);
+    CV_Assert(source.rows == destination.rows && source.cols == destination.cols);
+    if (source.empty()) {
+        return;
+    }
+
+    int width = source.cols;
+    int height = source.rows;
+    auto laplacian = [&](int y, int16_t* out) {
+        laplacianRow(source.ptr<uint8_t>(reflect101(y - 1, height)), source.ptr<uint8_t>(y),
+                     source.ptr<uint8_t>(reflect101(y + 1, height)), out, width);
+    };
+
+    // Each task keeps its rows' Laplacian in two rolling buffers; the row
+    // after the last one is computed twice, at the next task's start
+    parallelRange(height, kRowGrain, [&](int begin, int end) {
+        std::vector<int16_t> current(width);
+        std::vector<int16_t> next(width);
+        laplacian(begin, current.data());
+        for (int y = begin; y < end; ++y) {
+            // Nothing below the last row: compare it with itself (no crossing)
+            bool last = y + 1 == height;
+            if (!last) {
+                laplacian(y + 1, next.data());
+            }
+            crossingRow(current.data(), last ? current.data() : next.data(),
+                        destination.ptr<uint8_t>(y), width, threshold);
+            std::swap(current, next);
+        }
+    });
+}
@@ -0,0 +1,45 @@
+#ifndef GRADIENT_EDGES_H
+#define GRADIENT_EDGES_H
+
+#include <opencv2/opencv.hpp>
+
+/**
+ * Single-pass edge maps for a fast preview tier
+ *
+ * Cheaper than Canny (no non-maximum suppression or hysteresis): a 3x3
+ * gradient pair fused with the magnitude and threshold in one SIMD pass
+ * (NEON / SSE2 with a scalar tail), or the zero crossings of a Laplacian.
+ * Both write 0 / 255 masks when given a threshold and an edge strength
+ * image otherwise, so they feed the same output stage as Canny masks.
+ * Borders are mirrored (BORDER_REFLECT_101). Rows are spread over the thread
+ * pool bound to the calling thread, if any.
+ */
+
+enum GradientOperator {
+    GRADIENT_SOBEL = 0,   // 1, 2, 1 smoothing
+    GRADIENT_SCHARR = 1   // 3, 10, 3: closer to rotation invariant
+};
+
+/**
+ * L1 gradient magnitude |gx| + |gy|
+ * @param source CV_8UC1 image (may be a view)
+ * @param destination CV_8UC1 image of the same size
+ * @param threshold Magnitude in Sobel units (like Canny's thresholds) at
+ *                  which a pixel becomes 255; 0 writes the magnitude scaled
+ *                  so a full-contrast step is 255
+ */
+void gradientMagnitude(const cv::Mat& source, cv::Mat& destination, GradientOperator op,
+                       int threshold);
+
+/**
+ * Zero crossings of the 4-neighbour Laplacian (LoG when the source is blurred)
+ * A pixel is on an edge when the Laplacian changes sign towards its right or
+ * lower neighbour; its strength is the jump across the crossing.
+ * @param source CV_8UC1 image (may be a view)
+ * @param destination CV_8UC1 image of the same size
+ * @param threshold Jump at which a pixel becomes 255; 0 writes the jump
+ *                  (saturated)
+ */
+void laplacianZeroCrossings(const cv::Mat& source, cv::Mat& destination, int threshold);
+
+#endif // GRADIENT_EDGES_H
@@ -0,0 +1,108 @@
+#include "gray_expand.h"
+
+#include <cstring>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+inline void storePixel(uint8_t* destination, uint32_t pixel) {
+    std::memcpy(destination, &pixel, sizeof(pixel));
+}
+
+#if !defined(__ARM_NEON) && defined(__SSE2__)
+// Pixels to write one at a time before the destination is 16-byte aligned
+inline int pixelsToAlignment(const uint8_t* destination, int count) {
+    uintptr_t address = reinterpret_cast<uintptr_t>(destination);
+    if (address & 3) {
+        return count;  // Never aligned; stay scalar
+    }
+    int pixels = static_cast<int>(((16 - (address & 15)) & 15) / 4);
+    return pixels < count ? pixels : count;
+}
+#endif
+
+} // namespace
+
+void expandGrayRow(const uint8_t* source, uint8_t* destination, int count, uint8_t alpha) {
+    int i = 0;
+
+#if defined(__ARM_NEON)
+    uint8x16x4_t pixels;
+    pixels.val[3] = vdupq_n_u8(alpha);
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t v = vld1q_u8(source + i);
+        pixels.val[0] = v;
+        pixels.val[1] = v;
+        pixels.val[2] = v;
+        vst4q_u8(destination + i * 4, pixels);
+    }
+#elif defined(__SSE2__)
+    for (int head = pixelsToAlignment(destination, count); i < head; ++i) {
+        storePixel(destination + i * 4, source[i] * 0x010101u | uint32_t(alpha) << 24);
+    }
+
+    const __m128i rgbMask = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i alphaBits = _mm_set1_epi32(static_cast<int>(uint32_t(alpha) << 24));
+    for (; i + 16 <= count; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        __m128i lo = _mm_unpacklo_epi8(v, v);
+        __m128i hi = _mm_unpackhi_epi8(v, v);
+        __m128i quads[] = {_mm_unpacklo_epi16(lo, lo), _mm_unpackhi_epi16(lo, lo),
+                           _mm_unpacklo_epi16(hi, hi), _mm_unpackhi_epi16(hi, hi)};
+        __m128i* out = reinterpret_cast<__m128i*>(destination + i * 4);
+        for (int q = 0; q < 4; ++q) {
+            _mm_stream_si128(out + q, _mm_or_si128(_mm_and_si128(quads[q], rgbMask), alphaBits));
+        }
+    }
+    // Streaming stores are weakly ordered; publish them before the row is handed on
+    _mm_sfence();
+#endif
+
+    for (; i < count; ++i) {
+        storePixel(destination + i * 4, source[i] * 0x010101u | uint32_t(alpha) << 24);
+    }
+}
+
+void expandLutRow(const uint8_t* source, uint8_t* destination, int count, const uint32_t* lut) {
+    int i = 0;
+
+#if !defined(__ARM_NEON) && defined(__SSE2__)
+    for (int head = pixelsToAlignment(destination, count); i < head; ++i) {
+        storePixel(destination + i * 4, lut[source[i]]);
+    }
+
+    __m128i* out = reinterpret_cast<__m128i*>(destination + i * 4);
+    for (; i + 4 <= count; i += 4, ++out) {
+        _mm_stream_si128(out, _mm_set_epi32(static_cast<int>(lut[source[i + 3]]),
+                                            static_cast<int>(lut[source[i + 2]]),
+                                            static_cast<int>(lut[source[i + 1]]),
+                                            static_cast<int>(lut[source[i]])));
+    }
+    _mm_sfence();
+#endif
+
+    for (; i < count; ++i) {
+        storePixel(destination + i * 4, lut[source[i]]);
+    }
+}
+
+void buildBlendLut(uint32_t backgroundArgb, uint32_t foregroundArgb, uint32_t* lut) {
+    uint32_t background = argbToRgba(backgroundArgb);
+    uint32_t foreground = argbToRgba(foregroundArgb);
+    for (int v = 0; v < kExpandLutSize; ++v) {
+        uint32_t pixel = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+            int from = (background >> shift) & 0xFF;
+            int to = (foreground >> shift) & 0xFF;
+            int step = (to - from) * v;
+            uint32_t channel = static_cast<uint32_t>(from + (step + (step < 0 ? -127 : 127)) / 255);
+            pixel |= channel << shift;
+        }
+        lut[v] = pixel;
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef GRAY_EXPAND_H
+#define GRAY_EXPAND_H
+
+#include <cstdint>
+
+/**
+ * 8-bit -> RGBA expansion for the final write of grayscale and edge frames
+ *
+ * Output frames are only read again by the GL upload, so on x86 the rows are
+ * written with streaming (non-temporal) stores that bypass the caches the
+ * next frame's blur works in. ARM has no equivalent worth using for whole
+ * rows; there the kernel issues plain interleaving stores (vst4), which
+ * write full lines and do not read the destination first.
+ *
+ * RGBA pixels are uint32 values in R, G, B, A memory order (little-endian,
+ * like every Android ABI).
+ */
+
+/**
+ * Entries of a color lookup table
+ */
+const int kExpandLutSize = 256;
+
+/**
+ * Replicate each value into R, G and B
+ * @param alpha Value written to every A byte
+ */
+void expandGrayRow(const uint8_t* source, uint8_t* destination, int count, uint8_t alpha);
+
+/**
+ * Map each value through a color table
+ * @param lut kExpandLutSize RGBA pixels
+ */
+void expandLutRow(const uint8_t* source, uint8_t* destination, int count, const uint32_t* lut);
+
+/**
+ * Build a table blending from background (value 0) to foreground (255)
+ * Intermediate values, e.g. from a resampled edge mask, blend linearly.
+ * @param backgroundArgb 0xAARRGGBB, like android.graphics.Color
+ * @param foregroundArgb 0xAARRGGBB
+ * @param lut Receives kExpandLutSize RGBA pixels
+ */
+void buildBlendLut(uint32_t backgroundArgb, uint32_t foregroundArgb, uint32_t* lut);
+
+/**
+ * RGBA pixel (R, G, B, A memory order) of a 0xAARRGGBB color
+ */
+inline uint32_t argbToRgba(uint32_t argb) {
+    return (argb & 0xFF00FF00u) | ((argb >> 16) & 0xFFu) | ((argb & 0xFFu) << 16);
+}
+
+#endif // GRAY_EXPAND_H
@@ -1,6 +1,11 @@
 #include <jni.h>
 #include <android/log.h>
+#include <algorithm>
+#include <mutex>
+#include <vector>
+#include "frame_recorder.h"
 #include "opencv_processor.h"
+#include "output_buffer_pool.h"
 
 #define LOG_TAG "JNI_Bridge"
 #define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
@@ -9,6 +14,63 @@
 // Global processor instance
 static OpenCVProcessor* g_processor = nullptr;
 
+// Active recording, if any (JNI threads only; the processor holds its own reference)
+static std::shared_ptr<FrameRecorder> g_recorder;
+
+// Transform the recording was started with; its frame size and format are fixed
+static OpenCVProcessor::FrameTransform g_recordingTransform;
+
+// Output buffers exposed to Java as direct ByteBuffers (see nativeCreateOutputBuffers)
+static OutputBufferPool g_outputPool;
+
+// Orientation / crop applied to camera frames (set from the UI thread)
+static std::mutex g_transformMutex;
+static OpenCVProcessor::FrameTransform g_transform;
+
+static OpenCVProcessor::FrameTransform currentTransform() {
+    std::lock_guard<std::mutex> lock(g_transformMutex);
+    return g_transform;
+}
+
+// Bytes one processed frame occupies with a transform (size and format)
+static size_t outputFrameBytes(const OpenCVProcessor::FrameTransform& transform) {
+    cv::Size size = g_processor->getOutputSize(transform);
+    return static_cast<size_t>(size.area()) *
+           OpenCVProcessor::bytesPerPixel(transform.outputFormat);
+}
+
+/**
+ * Refuse a transform that would change recorded frames
+ * The file holds bare frames of one size and format; frames of another would
+ * all be dropped, so the change has to wait until the recording stops.
+ * @return true if the change must be rejected
+ */
+static bool recordingBlocks(const OpenCVProcessor::FrameTransform& transform) {
+    if (!g_recorder || g_processor == nullptr) {
+        return false;
+    }
+
+    if (transform.outputFormat == g_recordingTransform.outputFormat &&
+        g_processor->getOutputSize(transform) ==
+        g_processor->getOutputSize(g_recordingTransform)) {
+        return false;
+    }
+
+    LOGE("Cannot change output size or format while recording");
+    return true;
+}
+
+// Output size of a transform as [width, height]
+static jintArray outputSizeArray(JNIEnv* env, const OpenCVProcessor::FrameTransform& transform) {
+    cv::Size size = g_processor->getOutputSize(transform);
+    jint values[] = {size.width, size.height};
+    jintArray result = env->NewIntArray(2);
+    if (result != nullptr) {
+        env->SetIntArrayRegion(result, 0, 2, values);
+    }
+    return result;
+}
+
 extern "C" {
 
 /**
@@ -23,24 +85,27 @@ Java_com_edgedetection_viewer_FrameProcessor_nativeInit(
 
     LOGI("nativeInit called: %dx%d", width, height);
 
-    // Clean up existing processor
-    if (g_processor != nullptr) {
-        delete g_processor;
-        g_processor = nullptr;
+    // Recorded frames keep their size; a new camera size has to wait
+    if (g_recorder && g_processor != nullptr &&
+        (width != g_processor->getWidth() || height != g_processor->getHeight())) {
+        LOGE("Cannot change frame size while recording");
+        return JNI_FALSE;
     }
 
-    // Create new processor
-    g_processor = new OpenCVProcessor();
-    if (!g_processor) {
-        LOGE("Failed to create OpenCVProcessor");
-        return JNI_FALSE;
+    // Reconfigure the existing processor in place; settings and buffers survive
+    bool created = false;
+    if (g_processor == nullptr) {
+        g_processor = new OpenCVProcessor();
+        created = true;
     }
 
     // Initialize processor
     if (!g_processor->init(width, height)) {
         LOGE("Failed to initialize processor");
-        delete g_processor;
-        g_processor = nullptr;
+        if (created) {
+            delete g_processor;
+            g_processor = nullptr;
+        }
         return JNI_FALSE;
     }
 
@@ -54,7 +119,7 @@ Java_com_edgedetection_viewer_FrameProcessor_nativeInit(
  * @param output RGBA output buffer
  * @param width Frame width
  * @param height Frame height
- * @param mode Processing mode (0=raw, 1=grayscale, 2=canny)
+ * @param mode Processing mode (0=raw, 1=grayscale, 2=canny, 3=sobel, 4=scharr, 5=LoG)
  * @return true if successful
  */
 JNIEXPORT jboolean JNICALL
@@ -88,8 +153,9 @@ Java_com_edgedetection_viewer_FrameProcessor_nativeProcessFrame(
     jsize outputSize = env->GetArrayLength(output);
 
     // Validate sizes
-    jsize expectedInputSize = width * height * 3 / 2; // YUV_420_888
-    jsize expectedOutputSize = width * height * 4;    // RGBA
+    OpenCVProcessor::FrameTransform transform = currentTransform();
+    jsize expectedInputSize = width * height * 3 / 2;                           // YUV_420_888
+    jsize expectedOutputSize = static_cast<jsize>(outputFrameBytes(transform));  // RGBA / RGB565
 
     if (inputSize < expectedInputSize) {
         LOGE("Input size mismatch: expected %d, got %d", expectedInputSize, inputSize);
@@ -113,7 +179,8 @@ Java_com_edgedetection_viewer_FrameProcessor_nativeProcessFrame(
             reinterpret_cast<const uint8_t*>(inputBytes),
             inputSize,
             reinterpret_cast<uint8_t*>(outputBytes),
-            processingMode
+            processingMode,
+            transform
     );
 
     // Release arrays
@@ -128,6 +195,359 @@ Java_com_edgedetection_viewer_FrameProcessor_nativeProcessFrame(
     return JNI_TRUE;
 }
 
+/**
+ * Allocate the native output buffer pool for the current frame and output size
+ * Each buffer is wrapped in a direct ByteBuffer once, here; afterwards
+ * frames are exchanged by index. Must not be called while a buffer is held.
+ * @param count Number of buffers (3: one on screen, one queued, one filling)
+ * @return ByteBuffers indexed like the pool, or null on failure
+ */
+JNIEXPORT jobjectArray JNICALL
+Java_com_edgedetection_viewer_FrameProcessor_nativeCreateOutputBuffers(
+        JNIEnv* env, jobject /* this */, jint count) {
+
+    if (g_processor == nullptr) {
+        LOGE("Processor not initialized");
+        return nullptr;
+    }
+
+    // Large enough for unscaled frames too, so clearing the output size needs no new pool
+    size_t bufferBytes = std::max(static_cast<size_t>(g_processor->getWidth()) *
+                                  g_processor->getHeight() * 4,
+                                  outputFrameBytes(currentTransform()));
+    if (!g_outputPool.allocate(count, bufferBytes)) {
+        return nullptr;
+    }
+
+    jclass bufferClass = env->FindClass("java/nio/ByteBuffer");
+    if (bufferClass == nullptr) {
+        return nullptr;
+    }
+    jobjectArray result = env->NewObjectArray(count, bufferClass, nullptr);
+    if (result == nullptr) {
+        return nullptr;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        jobject buffer = env->NewDirectByteBuffer(g_outputPool.data(i),
+                                                  static_cast<jlong>(bufferBytes));
+        if (buffer == nullptr) {
+            return nullptr;
+        }
+        env->SetObjectArrayElement(result, i, buffer);
+        env->DeleteLocalRef(buffer);
+    }
+
+    LOGI("Created %d output buffers of %zu bytes", count, bufferBytes);
+    return result;
+}
+
+/**
+ * Take a free output buffer for the next frame
+ * @return Buffer index, or -1 if all are held (drop the frame)
+ */
+JNIEXPORT jint JNICALL
+Java_com_edgedetection_viewer_FrameProcessor_nativeAcquireOutputBuffer(
+        JNIEnv* env, jobject /* this */) {
+
+    return g_outputPool.acquire();
+}
+
+/**
+ * Hand a buffer back once it has been uploaded or skipped
+ * @param index Index returned by nativeAcquireOutputBuffer
+ */
+JNIEXPORT void JNICALL
+Java_com_edgedetection_viewer_FrameProcessor_nativeReleaseOutputBuffer(
+        JNIEnv* env, jobject /* this */, jint index) {
+
+    if (!g_outputPool.release(index)) {
+        LOGE("Output buffer %d was not held", index);
+    }
+}
+
+/**
+ * Process a frame straight into a pool buffer (no Java array, no copy back)
+ * @param input YUV frame data
+ * @param index Held buffer from nativeAcquireOutputBuffer
+ * @param width Frame width
+ * @param height Frame height
+ * @param mode Processing mode (0=raw, 1=grayscale, 2=canny, 3=sobel, 4=scharr, 5=LoG)
+ * @return true if successful
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_edgedetection_viewer_FrameProcessor_nativeProcessFrameToBuffer(
+        JNIEnv* env, jobject /* this */,
+        jbyteArray input, jint index,
+        jint width, jint height, jint mode) {
+
+    if (g_processor == nullptr) {
+        LOGE("Processor not initialized");
+        return JNI_FALSE;
+    }
+
+    if (!g_outputPool.isHeld(index)) {
+        LOGE("Output buffer %d is not held", index);
+        return JNI_FALSE;
+    }
+
+    OpenCVProcessor::FrameTransform transform = currentTransform();
+    size_t expectedOutputSize = outputFrameBytes(transform);
+    if (g_outputPool.bufferSize() < expectedOutputSize) {
+        LOGE("Output buffers hold %zu bytes, frame needs %zu; recreate them after "
+             "nativeInit / nativeSetOutputSize",
+             g_outputPool.bufferSize(), expectedOutputSize);
+        return JNI_FALSE;
+    }
+
+    jsize inputSize = env->GetArrayLength(input);
+    jsize expectedInputSize = width * height * 3 / 2; // YUV_420_888
+    if (inputSize < expectedInputSize) {
+        LOGE("Input size mismatch: expected %d, got %d", expectedInputSize, inputSize);
+        return JNI_FALSE;
+    }
+
+    jbyte* inputBytes = env->GetByteArrayElements(input, nullptr);
+    if (!inputBytes) {
+        LOGE("Failed to get input bytes");
+        return JNI_FALSE;
+    }
+
+    bool success = g_processor->processFrame(
+            reinterpret_cast<const uint8_t*>(inputBytes),
+            inputSize,
+            g_outputPool.data(index),
+            static_cast<OpenCVProcessor::ProcessingMode>(mode),
+            transform
+    );
+
+    env->ReleaseByteArrayElements(input, inputBytes, JNI_ABORT);
+
+    if (!success) {
+        LOGE("Frame processing failed");
+        return JNI_FALSE;
+    }
+
+    return JNI_TRUE;
+}
+
+/**
+ * Process a batch of recorded frames in one call (offline analysis)
+ * Frames are independent and are processed in parallel on the processor's
+ * worker threads. Both buffers must be direct ByteBuffers so no copy or
+ * array pinning is needed.
+ * @param input Direct buffer with frameCount contiguous NV21 frames
+ * @param output Direct buffer for frameCount contiguous RGBA frames
+ * @param frameCount Number of frames in the batch
+ * @param width Frame width (must match nativeInit)
+ * @param height Frame height (must match nativeInit)
+ * @param mode Processing mode (0=raw, 1=grayscale, 2=canny, 3=sobel, 4=scharr, 5=LoG)
+ * @param status Optional int array receiving 1 (ok) or 0 (failed) per frame
+ * @return Number of frames processed successfully
+ */
+JNIEXPORT jint JNICALL
+Java_com_edgedetection_viewer_FrameProcessor_nativeProcessBatch(
+        JNIEnv* env, jobject /* this */,
+        jobject input, jobject output, jint frameCount,
+        jint width, jint height, jint mode, jintArray status) {
+
+    if (g_processor == nullptr) {
+        LOGE("Processor not initialized");
+        return 0;
+    }
+
+    if (width != g_processor->getWidth() || height != g_processor->getHeight()) {
+        LOGE("Batch size %dx%d does not match processor %dx%d",
+             width, height, g_processor->getWidth(), g_processor->getHeight());
+        return 0;
+    }
+
+    uint8_t* inputBytes = static_cast<uint8_t*>(env->GetDirectBufferAddress(input));
+    uint8_t* outputBytes = static_cast<uint8_t*>(env->GetDirectBufferAddress(output));
+    if (!inputBytes || !outputBytes) {
+        LOGE("Batch buffers must be direct ByteBuffers");
+        return 0;
+    }
+
+    jlong inputSize = env->GetDirectBufferCapacity(input);
+    jlong outputSize = env->GetDirectBufferCapacity(output);
+
+    if (status != nullptr && env->GetArrayLength(status) < frameCount) {
+        LOGE("Status array shorter than %d frames", frameCount);
+        return 0;
+    }
+
+    std::vector<uint8_t> frameStatus(frameCount > 0 ? frameCount : 0);
+
+    int processed = g_processor->processBatch(
+            inputBytes, static_cast<size_t>(inputSize),
+            outputBytes, static_cast<size_t>(outputSize),
+            frameCount,
+            static_cast<OpenCVProcessor::ProcessingMode>(mode),
+            frameStatus.data());
+
+    if (status != nullptr && frameCount > 0) {
+        std::vector<jint> values(frameStatus.begin(), frameStatus.end());
+        env->SetIntArrayRegion(status, 0, frameCount, values.data());
+    }
+
+    if (processed < frameCount) {
+        LOGE("Batch: %d of %d frames failed", frameCount - processed, frameCount);
+    }
+
+    return processed;
+}
+
+/**
+ * Orient and crop camera frames while they are converted
+ * Output frames are cropWidth x cropHeight (swapped for 90 / 270) instead of
+ * the sensor size; the ROI refers to the oriented output.
+ * @param rotation Clockwise degrees: 0, 90, 180 or 270 (sensor orientation)
+ * @param mirror Flip horizontally after rotating (front camera)
+ * @param cropX Crop left edge in sensor pixels
+ * @param cropY Crop top edge in sensor pixels
+ * @param cropWidth Crop width; <= 0 uses the full frame
+ * @param cropHeight Crop height; <= 0 uses the full frame
+ * @return Output size as [width, height], or null if the rotation is invalid
+ */
+JNIEXPORT jintArray JNICALL
+Java_com_edgedetection_viewer_FrameProcessor_nativeSetTransform(
+        JNIEnv* env, jobject /* this */, jint rotation, jboolean mirror,
+        jint cropX, jint cropY, jint cropWidth, jint cropHeight) {
+
+    if (rotation % 90 != 0) {
+        LOGE("Unsupported rotation: %d", rotation);
+        return nullptr;
+    }
+
+    // Output size, format and input layout are set separately and kept
+    OpenCVProcessor::FrameTransform transform = currentTransform();
+    transform.rotation = rotation;
+    transform.mirror = mirror == JNI_TRUE;
+    transform.cropX = cropX;
+    transform.cropY = cropY;
+    transform.cropWidth = cropWidth;
+    transform.cropHeight = cropHeight;
+    if (recordingBlocks(transform)) {
+        return nullptr;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_transformMutex);
+        g_transform = transform;
+    }
+    LOGI("Transform set: %d degrees%s, crop %d,%d %dx%d", rotation,
+         transform.mirror ? " mirrored" : "", cropX, cropY, cropWidth, cropHeight);
+
+    if (g_processor == nullptr) {
+        return nullptr;
+    }
+    return outputSizeArray(env, transform);
+}
+
+/**
+ * Render frames at the viewport size instead of the oriented crop size
+ * The final RGBA expansion resamples straight into the output buffer, so
+ * the GL side can upload the frame 1:1 without another scaling pass.
+ * Processing (blur, Canny, ROI) still runs at camera resolution. Output
+ * buffers must be recreated if frames get larger than they are.
+ * @param width Output width in pixels; <= 0 returns to the unscaled size
+ * @param height Output height in pixels; <= 0 returns to the unscaled size
+ * @return Output size as [width, height], or null before nativeInit
+ */
+JNIEXPORT jintArray JNICALL
+Java_com_edgedetection_viewer_FrameProcessor_nativeSetOutputSize(
+        JNIEnv* env, jobject /* this */, jint width, jint height) {
+
+    if (width <= 0 || height <= 0) {
+        width = height = 0;
+    }
+
+    OpenCVProcessor::FrameTransform transform = currentTransform();
+    transform.outputWidth = width;
+    transform.outputHeight = height;
+    if (recordingBlocks(transform)) {
+        return nullptr;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_transformMutex);
+        g_transform.outputWidth = width;
+        g_transform.outputHeight = height;
+        transform = g_transform;
+    }
+    LOGI("Output size set: %dx%d", width, height);
+
+    if (g_processor == nullptr) {
+        return nullptr;
+    }
+    return outputSizeArray(env, transform);
+}
+
+/**
+ * Choose the pixel format frames are written in
+ * RGB565 halves output memory and the upload bandwidth; upload it with
+ * GL_RGB / GL_UNSIGNED_SHORT_5_6_5. GRAY8 writes one byte per pixel (luma,
+ * or the edge mask itself) for GL_LUMINANCE or further processing. Output
+ * buffers sized for RGBA frames fit the smaller formats as well.
+ * @param format 0 = RGBA8888, 1 = RGB565, 2 = GRAY8
+ * @return Bytes per output frame, or 0 if the format is unknown
+ */
+JNIEXPORT jint JNICALL
+Java_com_edgedetection_viewer_FrameProcessor_nativeSetOutputFormat(
+        JNIEnv* env, jobject /* this */, jint format) {
+
+    OpenCVProcessor::OutputFormat outputFormat =
+            static_cast<OpenCVProcessor::OutputFormat>(format);
+    if (OpenCVProcessor::bytesPerPixel(outputFormat) == 0) {
+        LOGE("Unsupported output format: %d", format);
+        return 0;
+    }
+
+    OpenCVProcessor::FrameTransform transform = currentTransform();
+    transform.outputFormat = outputFormat;
+    if (recordingBlocks(transform)) {
+        return 0;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_transformMutex);
+        g_transform.outputFormat = outputFormat;
+        transform = g_transform;
+    }
+    LOGI("Output format set: %d (%d bytes per pixel)", format,
+         OpenCVProcessor::bytesPerPixel(outputFormat));
+
+    if (g_processor == nullptr) {
+        return 0;
+    }
+    return static_cast<jint>(outputFrameBytes(transform));
+}
+
+/**
+ * Describe how camera frames are laid out
+ * All layouts are 4:2:0 with the same frame size, so buffer checks do not
+ * change; each layout has its own conversion kernels.
+ * @param layout 0 = NV21, 1 = NV12, 2 = I420
+ * @return true if the layout is supported
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_edgedetection_viewer_FrameProcessor_nativeSetInputLayout(
+        JNIEnv* env, jobject /* this */, jint layout) {
+
+    if (layout < OpenCVProcessor::INPUT_NV21 || layout > OpenCVProcessor::INPUT_I420) {
+        LOGE("Unsupported input layout: %d", layout);
+        return JNI_FALSE;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_transformMutex);
+        g_transform.inputLayout = static_cast<OpenCVProcessor::InputLayout>(layout);
+    }
+    LOGI("Input layout set: %d", layout);
+    return JNI_TRUE;
+}
+
 /**
  * Set Canny edge detection thresholds
  * @param lowThreshold Low threshold (e.g., 50)
@@ -144,6 +564,442 @@ LOGE("Cannot set thresholds: processor not initialized");
 }
 }
 
+/**
+ * Set the Gaussian blur applied before Canny
+ * @param kernelSize Odd kernel size >= 3, or 0 to derive it from sigma
+ * @param sigma Standard deviation
+ */
+JNIEXPORT void JNICALL
+Java_com_edgedetection_viewer_FrameProcessor_nativeSetBlur(
+        JNIEnv* env, jobject /* this */, jint kernelSize, jdouble sigma) {
+
+    if (g_processor == nullptr) {
+        LOGE("Cannot set blur: processor not initialized");
+        return;
+    }
+
+    g_processor->setBlur(kernelSize, sigma);
+}
+
+/**
+ * Pick the blur engine
+ * @param method 0 = auto, 1 = separable, 2 = box cascade, 3 = recursive (IIR)
+ */
+JNIEXPORT void JNICALL
+Java_com_edgedetection_viewer_FrameProcessor_nativeSetBlurMethod(
+        JNIEnv* env, jobject /* this */, jint method) {
+
+    if (g_processor == nullptr) {
+        LOGE("Cannot set blur method: processor not initialized");
+        return;
+    }
+
+    g_processor->setBlurMethod(static_cast<BlurMethod>(method));
+}
+
+/**
+ * Set the threshold of the Sobel, Scharr and LoG modes
+ * @param threshold Edge threshold (Sobel magnitude units); 0 draws edge strength
+ */
+JNIEXPORT void JNICALL
+Java_com_edgedetection_viewer_FrameProcessor_nativeSetGradientThreshold(
+        JNIEnv* env, jobject /* this */, jdouble threshold) {
+
+    if (g_processor == nullptr) {
+        LOGE("Cannot set gradient threshold: processor not initialized");
+        return;
+    }
+
+    g_processor->setGradientThreshold(threshold);
+}
+
+/**
+ * Extract line segments from Canny frames
+ * @param minLength Shortest segment reported, in output pixels; 0 turns extraction off
+ */
+JNIEXPORT void JNICALL
+Java_com_edgedetection_viewer_FrameProcessor_nativeSetLineSegments(
+        JNIEnv* env, jobject /* this */, jint minLength) {
+
+    if (g_processor == nullptr) {
+        LOGE("Cannot set line segments: processor not initialized");
+        return;
+    }
+
+    g_processor->setLineSegments(minLength);
+}
+
+/**
+ * Line segments of the last processed frame
+ * @return [x1, y1, x2, y2, strength] per segment, flattened, or null
+ */
+JNIEXPORT jfloatArray JNICALL
+Java_com_edgedetection_viewer_FrameProcessor_nativeGetLineSegments(
+        JNIEnv* env, jobject /* this */) {
+
+    if (g_processor == nullptr) {
+        return nullptr;
+    }
+
+    std::vector<LineSegment> segments = g_processor->getLineSegments();
+    std::vector<jfloat> values;
+    values.reserve(segments.size() * kLineSegmentFloats);
+    for (const LineSegment& s : segments) {
+        values.insert(values.end(), {s.x1, s.y1, s.x2, s.y2, s.strength});
+    }
+
+    jsize count = static_cast<jsize>(values.size());
+    jfloatArray result = env->NewFloatArray(count);
+    if (result != nullptr) {
+        env->SetFloatArrayRegion(result, 0, count, values.data());
+    }
+    return result;
+}
+
+/**
+ * Trace Canny frames into simplified polylines
+ * @param tolerance Douglas-Peucker tolerance in output pixels
+ * @param maxVertices Vertex capacity per frame; 0 turns tracing off
+ */
+JNIEXPORT void JNICALL
+Java_com_edgedetection_viewer_FrameProcessor_nativeSetPolylines(
+        JNIEnv* env, jobject /* this */, jdouble tolerance, jint maxVertices) {
+
+    if (g_processor == nullptr) {
+        LOGE("Cannot set polylines: processor not initialized");
+        return;
+    }
+
+    g_processor->setPolylines(tolerance, maxVertices);
+}
+
+/**
+ * Copy the polylines of the last processed frame into preallocated arrays
+ * Polyline i is vertices[2 * offsets[i]] .. vertices[2 * offsets[i + 1] - 1]
+ * as x, y pairs. Polylines that do not fit are left out.
+ * @param vertices Receives x, y pairs
+ * @param offsets Receives the first vertex of each polyline, then the vertex count
+ * @return Number of polylines copied, or -1 on error
+ */
+JNIEXPORT jint JNICALL
+Java_com_edgedetection_viewer_FrameProcessor_nativeGetPolylines(
+        JNIEnv* env, jobject /* this */, jfloatArray vertices, jintArray offsets) {
+
+    if (g_processor == nullptr || vertices == nullptr || offsets == nullptr) {
+        return -1;
+    }
+
+    PolylineSet polylines;
+    g_processor->getPolylines(polylines);
+
+    // Whole polylines only, as many as both arrays hold
+    jsize vertexFloats = env->GetArrayLength(vertices);
+    jsize offsetCount = env->GetArrayLength(offsets);
+    int count = std::min(polylines.count(), std::max(0, offsetCount - 1));
+    while (count > 0 && 2 * polylines.offsets[count] > vertexFloats) {
+        --count;
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    env->SetFloatArrayRegion(vertices, 0, 2 * polylines.offsets[count],
+                             polylines.vertices.data());
+    env->SetIntArrayRegion(offsets, 0, count + 1,
+                           reinterpret_cast<const jint*>(polylines.offsets.data()));
+    return count;
+}
+
+/**
+ * Detect FAST corners on Canny frames
+ * @param threshold Contrast against the center (1..254)
+ * @param arc Contiguous circle pixels required: 9 or 12
+ * @param maxKeypoints Strongest corners kept per frame; 0 turns detection off
+ */
+JNIEXPORT void JNICALL
+Java_com_edgedetection_viewer_FrameProcessor_nativeSetKeypoints(
+        JNIEnv* env, jobject /* this */, jint threshold, jint arc, jint maxKeypoints) {
+
+    if (g_processor == nullptr) {
+        LOGE("Cannot set keypoints: processor not initialized");
+        return;
+    }
+
+    g_processor->setKeypoints(threshold, static_cast<FastArc>(arc), maxKeypoints);
+}
+
+/**
+ * Keypoints of the last processed frame, strongest first
+ * @return [x, y, score] per keypoint, flattened, or null
+ */
+JNIEXPORT jfloatArray JNICALL
+Java_com_edgedetection_viewer_FrameProcessor_nativeGetKeypoints(
+        JNIEnv* env, jobject /* this */) {
+
+    if (g_processor == nullptr) {
+        return nullptr;
+    }
+
+    std::vector<Keypoint> keypoints = g_processor->getKeypoints();
+    std::vector<jfloat> values;
+    values.reserve(keypoints.size() * kKeypointFloats);
+    for (const Keypoint& k : keypoints) {
+        values.insert(values.end(), {k.x, k.y, k.score});
+    }
+
+    jsize count = static_cast<jsize>(values.size());
+    jfloatArray result = env->NewFloatArray(count);
+    if (result != nullptr) {
+        env->SetFloatArrayRegion(result, 0, count, values.data());
+    }
+    return result;
+}
+
+/**
+ * Set the colors Canny frames are drawn in
+ * @param edgeColor Edge color as an android.graphics.Color int (ARGB)
+ * @param backgroundColor Background color (ARGB)
+ */
+JNIEXPORT void JNICALL
+Java_com_edgedetection_viewer_FrameProcessor_nativeSetMaskColors(
+        JNIEnv* env, jobject /* this */, jint edgeColor, jint backgroundColor) {
+
+    if (g_processor == nullptr) {
+        LOGE("Cannot set mask colors: processor not initialized");
+        return;
+    }
+
+    g_processor->setMaskColors(static_cast<uint32_t>(edgeColor),
+                               static_cast<uint32_t>(backgroundColor));
+}
+
+/**
+ * Restrict processing to a region of interest
+ * @param x Left edge in pixels
+ * @param y Top edge in pixels
+ * @param width ROI width (<= 0 clears the ROI)
+ * @param height ROI height (<= 0 clears the ROI)
+ * @param fillOutside true to fill pixels outside the ROI with the raw camera image
+ */
+JNIEXPORT void JNICALL
+Java_com_edgedetection_viewer_FrameProcessor_nativeSetRoi(
+        JNIEnv* env, jobject /* this */,
+        jint x, jint y, jint width, jint height, jboolean fillOutside) {
+
+    if (g_processor == nullptr) {
+        LOGE("Cannot set ROI: processor not initialized");
+        return;
+    }
+
+    g_processor->setRoi(x, y, width, height,
+                        fillOutside ? OpenCVProcessor::ROI_OUTSIDE_RAW
+                                    : OpenCVProcessor::ROI_OUTSIDE_UNTOUCHED);
+}
+
+/**
+ * Configure the processor's worker threads
+ * @param threadCount Worker threads (0 = one per CPU, minus the caller; < 0 = none)
+ * @param affinityMasks CPU masks, one for all workers or one per worker (may be null)
+ * @param niceness Niceness values, same layout as affinityMasks (may be null)
+ */
+JNIEXPORT void JNICALL
+Java_com_edgedetection_viewer_FrameProcessor_nativeConfigureThreads(
+        JNIEnv* env, jobject /* this */,
+        jint threadCount, jlongArray affinityMasks, jintArray niceness) {
+
+    if (g_processor == nullptr) {
+        LOGE("Cannot configure threads: processor not initialized");
+        return;
+    }
+
+    ThreadPoolConfig config;
+    config.threadCount = threadCount;
+
+    if (affinityMasks != nullptr) {
+        jsize count = env->GetArrayLength(affinityMasks);
+        std::vector<jlong> masks(count);
+        env->GetLongArrayRegion(affinityMasks, 0, count, masks.data());
+        config.affinityMasks.assign(masks.begin(), masks.end());
+    }
+
+    if (niceness != nullptr) {
+        jsize count = env->GetArrayLength(niceness);
+        config.niceness.resize(count);
+        env->GetIntArrayRegion(niceness, 0, count, config.niceness.data());
+    }
+
+    g_processor->configureThreads(config);
+}
+
+/**
+ * CPU mask of the performance cores (big.LITTLE), for use with nativeConfigureThreads
+ * @return Affinity mask, or 0 if the CPU topology is unknown
+ */
+JNIEXPORT jlong JNICALL
+Java_com_edgedetection_viewer_FrameProcessor_nativeGetPerformanceCoreMask(
+        JNIEnv* env, jobject /* this */) {
+    return static_cast<jlong>(ThreadPool::performanceCoreMask());
+}
+
+/**
+ * Set the processing time budget for the adaptive quality governor
+ * @param targetMs Target frame time in milliseconds (<= 0 disables the governor)
+ */
+JNIEXPORT void JNICALL
+Java_com_edgedetection_viewer_FrameProcessor_nativeSetFrameBudget(
+        JNIEnv* env, jobject /* this */, jdouble targetMs) {
+
+    if (g_processor == nullptr) {
+        LOGE("Cannot set frame budget: processor not initialized");
+        return;
+    }
+
+    g_processor->setFrameBudget(targetMs);
+}
+
+/**
+ * Get processing statistics
+ * @return [framesProcessed, lastFrameMs, averageFrameMs, qualityLevel,
+ *          nativeBytes, peakNativeBytes], or null
+ */
+JNIEXPORT jdoubleArray JNICALL
+Java_com_edgedetection_viewer_FrameProcessor_nativeGetStats(
+        JNIEnv* env, jobject /* this */) {
+
+    if (g_processor == nullptr) {
+        return nullptr;
+    }
+
+    ProcessorStats stats = g_processor->getStats();
+    jdouble values[] = {
+            static_cast<jdouble>(stats.framesProcessed),
+            stats.lastFrameMs,
+            stats.averageFrameMs,
+            static_cast<jdouble>(stats.qualityLevel),
+            static_cast<jdouble>(stats.nativeBytes),
+            static_cast<jdouble>(stats.peakNativeBytes)
+    };
+
+    jsize count = sizeof(values) / sizeof(values[0]);
+    jdoubleArray result = env->NewDoubleArray(count);
+    if (result != nullptr) {
+        env->SetDoubleArrayRegion(result, 0, count, values);
+    }
+    return result;
+}
+
+/**
+ * Start recording processed frames to a raw frame sequence file
+ * Frames are stored in the current output size and format, which cannot
+ * change until the recording stops. They are queued without blocking
+ * processing and written in large batches on a background thread; frames
+ * that do not fit are dropped.
+ * @param path Output file
+ * @param queueFrames Frames buffered while the writer is busy
+ * @return true if recording started
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_edgedetection_viewer_FrameProcessor_nativeStartRecording(
+        JNIEnv* env, jobject /* this */, jstring path, jint queueFrames) {
+
+    if (g_processor == nullptr || path == nullptr) {
+        LOGE("Cannot record: processor not initialized");
+        return JNI_FALSE;
+    }
+
+    if (g_recorder) {
+        LOGE("Recording already running");
+        return JNI_FALSE;
+    }
+
+    const char* pathChars = env->GetStringUTFChars(path, nullptr);
+    if (!pathChars) {
+        return JNI_FALSE;
+    }
+    std::string filePath(pathChars);
+    env->ReleaseStringUTFChars(path, pathChars);
+
+    // Frames are recorded as processFrame writes them: output size and format
+    OpenCVProcessor::FrameTransform transform = currentTransform();
+    std::shared_ptr<FrameRecorder> recorder =
+            std::make_shared<FrameRecorder>(outputFrameBytes(transform), queueFrames);
+    if (!recorder->start(filePath)) {
+        return JNI_FALSE;
+    }
+
+    g_recordingTransform = transform;
+    g_recorder = recorder;
+    g_processor->setRecorder(recorder);
+    return JNI_TRUE;
+}
+
+/**
+ * Stop recording and flush the file
+ * @return true if every accepted frame was written
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_edgedetection_viewer_FrameProcessor_nativeStopRecording(
+        JNIEnv* env, jobject /* this */) {
+
+    if (!g_recorder) {
+        return JNI_FALSE;
+    }
+
+    if (g_processor != nullptr) {
+        g_processor->setRecorder(nullptr);
+    }
+
+    bool ok = g_recorder->stop();
+    g_recorder.reset();
+    return ok ? JNI_TRUE : JNI_FALSE;
+}
+
+/**
+ * Recording counters
+ * @return [submitted, written, dropped, bytesWritten, directIo, failed], or null
+ */
+JNIEXPORT jlongArray JNICALL
+Java_com_edgedetection_viewer_FrameProcessor_nativeGetRecordingStats(
+        JNIEnv* env, jobject /* this */) {
+
+    if (!g_recorder) {
+        return nullptr;
+    }
+
+    RecorderStats stats = g_recorder->getStats();
+    jlong values[] = {
+            static_cast<jlong>(stats.framesSubmitted),
+            static_cast<jlong>(stats.framesWritten),
+            static_cast<jlong>(stats.framesDropped),
+            static_cast<jlong>(stats.bytesWritten),
+            stats.directIo ? 1 : 0,
+            stats.failed ? 1 : 0
+    };
+
+    jsize count = sizeof(values) / sizeof(values[0]);
+    jlongArray result = env->NewLongArray(count);
+    if (result != nullptr) {
+        env->SetLongArrayRegion(result, 0, count, values);
+    }
+    return result;
+}
+
+/**
+ * Release native memory under memory pressure (call from onTrimMemory)
+ * Released buffers are re-created on the next frame.
+ * @param level ComponentCallbacks2.TRIM_MEMORY_* level
+ */
+JNIEXPORT void JNICALL
+Java_com_edgedetection_viewer_FrameProcessor_nativeTrimMemory(
+        JNIEnv* env, jobject /* this */, jint level) {
+
+    LOGI("nativeTrimMemory called: level %d", level);
+
+    if (g_processor != nullptr) {
+        g_processor->trimMemory(level);
+    }
+}
+
 /**
  * Release native resources
  */
@@ -153,6 +1009,14 @@ Java_com_edgedetection_viewer_FrameProcessor_nativeRelease(
 
 LOGI("nativeRelease called");
 
+if (g_recorder) {
+g_recorder->stop();
+g_recorder.reset();
+}
+
+// Java must have dropped its ByteBuffers by now; held buffers are kept (and leaked)
+g_outputPool.free();
+
 if (g_processor != nullptr) {
 g_processor->release();
 delete g_processor;
@@ -0,0 +1,340 @@
+#include "line_segments.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+
+#include "thread_pool.h"
+
+namespace {
+
+// Tile edge for region growing; a tile's visited map stays in L1
+const int kTile = 64;
+
+// Tiles per task
+const int kTileGrain = 4;
+
+// Orientation tolerance of 22.5 degrees, compared on doubled angles: cos(45)
+const double kAlignedCos = 0.70710678;
+
+// Largest perpendicular standard deviation (pixels) of a straight region
+const double kMaxSpread = 1.0;
+
+// Regions with fewer pixels are dropped before joining
+const int kMinPiecePixels = 4;
+
+// Joining pieces: directions within ~8 degrees, nearest endpoints at most
+// kJoinGap apart (bridges fragments dropped at tile corners and pixels taken
+// by a crossing line) and kJoinOffset off the other's line
+const double kJoinCos = 0.99;
+const double kJoinGap = 6.0;
+const double kJoinOffset = 1.5;
+
+/**
+ * Pixel moments of a region; joined pieces are refitted from their sum
+ */
+struct Moments {
+    double n = 0.0;
+    double sx = 0.0, sy = 0.0;
+    double sxx = 0.0, syy = 0.0, sxy = 0.0;
+    double magnitude = 0.0;
+
+    void add(double x, double y, double m) {
+        n += 1.0;
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        syy += y * y;
+        sxy += x * y;
+        magnitude += m;
+    }
+
+    void add(const Moments& other) {
+        n += other.n;
+        sx += other.sx;
+        sy += other.sy;
+        sxx += other.sxx;
+        syy += other.syy;
+        sxy += other.sxy;
+        magnitude += other.magnitude;
+    }
+};
+
+/**
+ * Least-squares line: centroid, unit direction, variance across the line
+ */
+struct LineFit {
+    double cx, cy;
+    double ux, uy;
+    double spread;
+};
+
+LineFit fitLine(const Moments& m) {
+    LineFit fit;
+    fit.cx = m.sx / m.n;
+    fit.cy = m.sy / m.n;
+    double vxx = m.sxx / m.n - fit.cx * fit.cx;
+    double vyy = m.syy / m.n - fit.cy * fit.cy;
+    double vxy = m.sxy / m.n - fit.cx * fit.cy;
+
+    // Principal axis, and the smaller eigenvalue of the covariance
+    double angle = 0.5 * std::atan2(2.0 * vxy, vxx - vyy);
+    fit.ux = std::cos(angle);
+    fit.uy = std::sin(angle);
+    double half = 0.5 * (vxx + vyy);
+    double radius = std::sqrt(0.25 * (vxx - vyy) * (vxx - vyy) + vxy * vxy);
+    fit.spread = half - radius;
+    return fit;
+}
+
+inline double along(const LineFit& fit, double x, double y) {
+    return (x - fit.cx) * fit.ux + (y - fit.cy) * fit.uy;
+}
+
+inline double across(const LineFit& fit, double x, double y) {
+    return std::fabs((y - fit.cy) * fit.ux - (x - fit.cx) * fit.uy);
+}
+
+/**
+ * A straight region found in one tile
+ */
+struct Piece {
+    Moments moments;
+    LineFit fit;
+    double t0, t1;  // Extent along the direction, relative to the centroid
+
+    double x(double t) const { return fit.cx + t * fit.ux; }
+    double y(double t) const { return fit.cy + t * fit.uy; }
+};
+
+void parallelRange(int count, int grain, const std::function<void(int, int)>& body) {
+    ThreadPool* pool = ThreadPool::current();
+    if (pool) {
+        pool->parallelFor(0, count, grain, body);
+    } else {
+        body(0, count);
+    }
+}
+
+/**
+ * Grow aligned regions inside one tile
+ */
+void growTile(const cv::Mat& edges, const cv::Mat& dx, const cv::Mat& dy,
+              const cv::Rect& bounds, std::vector<Piece>& pieces) {
+    std::vector<uint8_t> visited(static_cast<size_t>(bounds.area()), 0);
+    std::vector<cv::Point> stack;
+    std::vector<cv::Point> region;
+
+    // Gradient orientation as a doubled-angle unit vector (lines are undirected)
+    auto orientation = [&](int x, int y, double& c2, double& s2) {
+        int gx = dx.ptr<int16_t>(y)[x];
+        int gy = dy.ptr<int16_t>(y)[x];
+        double m2 = static_cast<double>(gx) * gx + static_cast<double>(gy) * gy;
+        if (m2 == 0.0) {
+            return false;
+        }
+        c2 = (static_cast<double>(gx) * gx - static_cast<double>(gy) * gy) / m2;
+        s2 = 2.0 * gx * gy / m2;
+        return true;
+    };
+    auto seen = [&](int x, int y) -> uint8_t& {
+        return visited[static_cast<size_t>(y - bounds.y) * bounds.width + (x - bounds.x)];
+    };
+
+    for (int y = bounds.y; y < bounds.y + bounds.height; ++y) {
+        const uint8_t* row = edges.ptr<uint8_t>(y);
+        for (int x = bounds.x; x < bounds.x + bounds.width; ++x) {
+            double c2;
+            double s2;
+            if (!row[x] || seen(x, y)) {
+                continue;
+            }
+            seen(x, y) = 1;
+            if (!orientation(x, y, c2, s2)) {
+                continue;
+            }
+
+            // Region sum of orientations; a neighbour joins while it is
+            // within the tolerance of the mean. Rejected pixels stay free
+            // to seed regions of their own.
+            double sumC = c2;
+            double sumS = s2;
+            Moments moments;
+            region.clear();
+            stack.assign(1, cv::Point(x, y));
+            while (!stack.empty()) {
+                cv::Point p = stack.back();
+                stack.pop_back();
+                region.push_back(p);
+                moments.add(p.x, p.y, std::abs(dx.ptr<int16_t>(p.y)[p.x])
+                                      + std::abs(dy.ptr<int16_t>(p.y)[p.x]));
+
+                for (int ny = std::max(p.y - 1, bounds.y);
+                     ny <= std::min(p.y + 1, bounds.y + bounds.height - 1); ++ny) {
+                    const uint8_t* neighbours = edges.ptr<uint8_t>(ny);
+                    for (int nx = std::max(p.x - 1, bounds.x);
+                         nx <= std::min(p.x + 1, bounds.x + bounds.width - 1); ++nx) {
+                        if (!neighbours[nx] || seen(nx, ny) || !orientation(nx, ny, c2, s2)) {
+                            continue;
+                        }
+                        if (c2 * sumC + s2 * sumS < kAlignedCos * std::hypot(sumC, sumS)) {
+                            continue;
+                        }
+                        seen(nx, ny) = 1;
+                        sumC += c2;
+                        sumS += s2;
+                        stack.push_back(cv::Point(nx, ny));
+                    }
+                }
+            }
+
+            if (static_cast<int>(region.size()) < kMinPiecePixels) {
+                continue;
+            }
+            Piece piece;
+            piece.moments = moments;
+            piece.fit = fitLine(moments);
+            if (piece.fit.spread > kMaxSpread * kMaxSpread) {
+                continue;  // Curve or blob
+            }
+            piece.t0 = piece.t1 = 0.0;
+            for (const cv::Point& p : region) {
+                double t = along(piece.fit, p.x, p.y);
+                piece.t0 = std::min(piece.t0, t);
+                piece.t1 = std::max(piece.t1, t);
+            }
+            pieces.push_back(piece);
+        }
+    }
+}
+
+bool canJoin(const Piece& a, const Piece& b) {
+    if (std::fabs(a.fit.ux * b.fit.ux + a.fit.uy * b.fit.uy) < kJoinCos) {
+        return false;
+    }
+
+    double gap = kJoinGap * kJoinGap + 1.0;
+    for (double ta : {a.t0, a.t1}) {
+        for (double tb : {b.t0, b.t1}) {
+            double ex = a.x(ta) - b.x(tb);
+            double ey = a.y(ta) - b.y(tb);
+            gap = std::min(gap, ex * ex + ey * ey);
+        }
+    }
+    if (gap > kJoinGap * kJoinGap) {
+        return false;
+    }
+
+    return across(a.fit, b.x(b.t0), b.y(b.t0)) <= kJoinOffset &&
+           across(a.fit, b.x(b.t1), b.y(b.t1)) <= kJoinOffset;
+}
+
+int findRoot(std::vector<int>& parent, int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+void emit(const Piece& piece, int minLength, std::vector<LineSegment>& segments) {
+    if (piece.t1 - piece.t0 + 1.0 < minLength) {
+        return;
+    }
+    LineSegment segment;
+    segment.x1 = static_cast<float>(piece.x(piece.t0));
+    segment.y1 = static_cast<float>(piece.y(piece.t0));
+    segment.x2 = static_cast<float>(piece.x(piece.t1));
+    segment.y2 = static_cast<float>(piece.y(piece.t1));
+    segment.strength = static_cast<float>(piece.moments.magnitude / piece.moments.n);
+    segments.push_back(segment);
+}
+
+} // namespace
+
+void extractLineSegments(const cv::Mat& edges, const cv::Mat& dx, const cv::Mat& dy,
+                         int minLength, std::vector<LineSegment>& segments) {
+    CV_Assert(edges.type() == CV_8UC1 && dx.type() == CV_16SC1 && dy.type() == CV_16SC1);
+    CV_Assert(dx.rows == edges.rows && dx.cols == edges.cols);
+    CV_Assert(dy.rows == edges.rows && dy.cols == edges.cols);
+    segments.clear();
+
+    int tilesX = (edges.cols + kTile - 1) / kTile;
+    int tilesY = (edges.rows + kTile - 1) / kTile;
+    std::vector<std::vector<Piece>> tiles(static_cast<size_t>(tilesX) * tilesY);
+    parallelRange(static_cast<int>(tiles.size()), kTileGrain, [&](int begin, int end) {
+        for (int t = begin; t < end; ++t) {
+            cv::Rect bounds((t % tilesX) * kTile, (t / tilesX) * kTile, kTile, kTile);
+            growTile(edges, dx, dy, bounds & cv::Rect(0, 0, edges.cols, edges.rows), tiles[t]);
+        }
+    });
+
+    // Flatten, remembering where each tile's pieces start
+    std::vector<Piece> pieces;
+    std::vector<int> first(tiles.size() + 1, 0);
+    for (size_t t = 0; t < tiles.size(); ++t) {
+        first[t] = static_cast<int>(pieces.size());
+        pieces.insert(pieces.end(), tiles[t].begin(), tiles[t].end());
+    }
+    first[tiles.size()] = static_cast<int>(pieces.size());
+
+    // Link pieces of the same or a neighbouring tile that continue each other
+    std::vector<int> parent(pieces.size());
+    std::iota(parent.begin(), parent.end(), 0);
+    const int neighbours[][2] = {{0, 0}, {1, 0}, {-1, 1}, {0, 1}, {1, 1}};
+    for (int ty = 0; ty < tilesY; ++ty) {
+        for (int tx = 0; tx < tilesX; ++tx) {
+            int t = ty * tilesX + tx;
+            for (const auto& offset : neighbours) {
+                int nx = tx + offset[0];
+                int ny = ty + offset[1];
+                if (nx < 0 || nx >= tilesX || ny >= tilesY) {
+                    continue;
+                }
+                int n = ny * tilesX + nx;
+                for (int a = first[t]; a < first[t + 1]; ++a) {
+                    for (int b = n == t ? a + 1 : first[n]; b < first[n + 1]; ++b) {
+                        if (canJoin(pieces[a], pieces[b])) {
+                            parent[findRoot(parent, b)] = findRoot(parent, a);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // One segment per group, refitted over all of its pixels; a group that
+    // is not straight as a whole keeps its pieces
+    std::vector<std::vector<int>> groups(pieces.size());
+    for (int i = 0; i < static_cast<int>(pieces.size()); ++i) {
+        groups[findRoot(parent, i)].push_back(i);
+    }
+    for (const std::vector<int>& group : groups) {
+        if (group.size() == 1) {
+            emit(pieces[group[0]], minLength, segments);
+        } else if (!group.empty()) {
+            Piece joined;
+            for (int i : group) {
+                joined.moments.add(pieces[i].moments);
+            }
+            joined.fit = fitLine(joined.moments);
+            if (joined.fit.spread > kMaxSpread * kMaxSpread) {
+                for (int i : group) {
+                    emit(pieces[i], minLength, segments);
+                }
+                continue;
+            }
+            joined.t0 = joined.t1 = 0.0;
+            for (int i : group) {
+                for (double t : {pieces[i].t0, pieces[i].t1}) {
+                    double s = along(joined.fit, pieces[i].x(t), pieces[i].y(t));
+                    joined.t0 = std::min(joined.t0, s);
+                    joined.t1 = std::max(joined.t1, s);
+                }
+            }
+            emit(joined, minLength, segments);
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef LINE_SEGMENTS_H
+#define LINE_SEGMENTS_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+/**
+ * Line segment extraction from a Canny edge map
+ *
+ * LSD-style: edge pixels are grown into regions whose gradient orientations
+ * agree (doubled-angle comparison, no atan2 per pixel), and every region
+ * that is thin enough becomes a segment fitted through its pixel moments.
+ * Regions are grown per tile, with tiles spread over the thread pool bound
+ * to the calling thread, if any. Pieces meeting collinearly at tile borders
+ * are then joined and refitted from their combined moments.
+ */
+
+/**
+ * One segment, endpoints at pixel centers
+ */
+struct LineSegment {
+    float x1, y1;
+    float x2, y2;
+    float strength;  // Mean L1 gradient magnitude along the segment
+};
+
+// Floats per segment in flat arrays (x1, y1, x2, y2, strength)
+const int kLineSegmentFloats = 5;
+
+/**
+ * Extract line segments
+ * @param edges CV_8UC1 edge mask (non-zero = edge)
+ * @param dx CV_16SC1 horizontal derivative the mask was computed from
+ * @param dy CV_16SC1 vertical derivative
+ * @param minLength Shortest segment kept, in pixels
+ * @param segments Receives the segments in the mask's pixel coordinates
+ */
+void extractLineSegments(const cv::Mat& edges, const cv::Mat& dx, const cv::Mat& dy,
+                         int minLength, std::vector<LineSegment>& segments);
+
+#endif // LINE_SEGMENTS_H
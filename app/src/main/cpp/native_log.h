@@ -0,0 +1,45 @@
+#ifndef NATIVE_LOG_H
+#define NATIVE_LOG_H
+
+/**
+ * Logging macros shared by the native sources
+ *
+ * Define LOG_TAG before including. On Android messages go to logcat,
+ * on host builds (benchmarks, CLI tools) they go to stderr.
+ */
+#ifdef __ANDROID__
+
+#include <android/log.h>
+
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGW(...) __android_log_print(ANDROID_LOG_WARN, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+#else
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+
+inline void nativeLogPrint(const char* level, const char* tag, const char* fmt, ...) {
+    // Info messages are noisy in tools; enable them with EDGE_LOG_VERBOSE=1
+    static const bool verbose = std::getenv("EDGE_LOG_VERBOSE") != nullptr;
+    if (level[0] == 'I' && !verbose) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, fmt);
+    std::fprintf(stderr, "%s/%s: ", level, tag);
+    std::vfprintf(stderr, fmt, args);
+    std::fputc('\n', stderr);
+    va_end(args);
+}
+
+#define LOGI(...) nativeLogPrint("I", LOG_TAG, __VA_ARGS__)
+#define LOGW(...) nativeLogPrint("W", LOG_TAG, __VA_ARGS__)
+#define LOGE(...) nativeLogPrint("E", LOG_TAG, __VA_ARGS__)
+
+#endif
+
+#endif // NATIVE_LOG_H
@@ -1,16 +1,363 @@
 #include "opencv_processor.h"
-#include <android/log.h>
+
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && \
+    (CV_VERSION_MINOR > 5 || (CV_VERSION_MINOR == 5 && CV_VERSION_REVISION >= 2)))
+#include <opencv2/core/parallel/parallel_backend.hpp>
+#define HAVE_CV_PARALLEL_BACKEND 1
+#endif
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <type_traits>
+
+#include "frame_recorder.h"
+#include "pixel_store.h"
+#include "resample.h"
 
 #define LOG_TAG "OpenCVProcessor"
-#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#include "native_log.h"
+
+// Pixels read around the ROI on top of the blur radius: Sobel (1) + NMS (1);
+// enough for exact gradients inside the ROI, not for hysteresis connectivity
+static const int kEdgeHalo = 2;
+
+// Canny mask colors that need no lookup table
+static const uint32_t kPlainEdgeColor = 0xFFFFFFFF;
+static const uint32_t kPlainBackgroundColor = 0xFF000000;
+
+// Parameters a new processor starts with
+static const OpenCVProcessor::Params kDefaultParams = {
+        50.0, 150.0,                           // Canny thresholds
+        5, 1.5, BLUR_AUTO,                     // Gaussian blur
+        0, 0, 0, 0,                            // ROI (full frame)
+        OpenCVProcessor::ROI_OUTSIDE_UNTOUCHED,
+        kPlainEdgeColor, kPlainBackgroundColor, // White edges on black
+        0.0,                                   // Gradient modes draw edge strength
+        0,                                     // No line segments
+        1.0, 0,                                // No polylines
+        20, FAST_9, 0                          // No keypoints
+};
+
+// Weight of the newest frame in the average frame time
+static const double kStatsAverageWeight = 0.1;
+
+// Output tile edge for oriented reads: a 90/270 degree tile reads this many
+// sensor rows, which stay in L1 while the tile is written
+static const int kOrientTile = 32;
+
+// YUV -> RGB, BT.601 video range in 20-bit fixed point (OpenCV's coefficients)
+static const int kYuvShift = 20;
+static const int kYuvRound = 1 << (kYuvShift - 1);
+static const int kYuvCY = 1220542;    //  1.164
+static const int kYuvCVR = 1673527;   //  1.596
+static const int kYuvCVG = -852492;   // -0.813
+static const int kYuvCUG = -409993;   // -0.391
+static const int kYuvCUB = 2116026;   //  2.018
+
+// Output rows per task for row-wise expansion
+static const int kExpandRowGrain = 16;
+
+static inline uint8_t clampByte(int value) {
+    return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+// One YUV sample to RGB
+static inline void yuvPixel(int y, int v, int u, int& r, int& g, int& b) {
+    int luma = std::max(0, y - 16) * kYuvCY;
+    v -= 128;
+    u -= 128;
+    r = clampByte((luma + kYuvCVR * v + kYuvRound) >> kYuvShift);
+    g = clampByte((luma + kYuvCVG * v + kYuvCUG * u + kYuvRound) >> kYuvShift);
+    b = clampByte((luma + kYuvCUB * u + kYuvRound) >> kYuvShift);
+}
+
+/**
+ * Video-range luma (16..235) stretched to full range: the gray level
+ * yuvPixel gives a pixel without chroma
+ * Grayscale output and the edge detectors' input go through it, so they see
+ * the same levels as a frame converted to RGB and back to gray.
+ */
+struct FullRangeLuma {
+    uint8_t gray[256];
+    uint32_t rgba[kExpandLutSize];   // The same levels as an expansion table
+
+    FullRangeLuma() {
+        for (int y = 0; y < 256; ++y) {
+            gray[y] = clampByte((std::max(0, y - 16) * kYuvCY + kYuvRound) >> kYuvShift);
+            rgba[y] = RgbaStore::gray(gray[y]);
+        }
+    }
+};
+
+static const FullRangeLuma kFullRangeLuma;
+
+/**
+ * Call row(y) for every row of a region; rows run in parallel on the
+ * current pool
+ */
+template <typename Row>
+static void forEachRow(const cv::Rect& region, const Row& row) {
+    auto body = [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            row(region.y + y);
+        }
+    };
+
+    ThreadPool* pool = ThreadPool::current();
+    if (pool) {
+        pool->parallelFor(0, region.height, kExpandRowGrain, body);
+    } else {
+        body(0, region.height);
+    }
+}
+
+/**
+ * Map a rectangle of the oriented image onto the resampled output
+ * Corners are scaled independently, so adjacent rectangles stay adjacent.
+ */
+static cv::Rect scaleRect(const cv::Rect& rect, const cv::Size& from, const cv::Size& to) {
+    int x0 = static_cast<int>(static_cast<int64_t>(rect.x) * to.width / from.width);
+    int y0 = static_cast<int>(static_cast<int64_t>(rect.y) * to.height / from.height);
+    int x1 = static_cast<int>(static_cast<int64_t>(rect.x + rect.width) * to.width / from.width);
+    int y1 = static_cast<int>(static_cast<int64_t>(rect.y + rect.height) * to.height
+                              / from.height);
+    return cv::Rect(x0, y0, x1 - x0, y1 - y0);
+}
+
+/**
+ * Visit an output region tile by tile, calling segment(y, xBegin, xEnd) for
+ * every tile row; tile rows run in parallel on the current pool
+ */
+template <typename Segment>
+static void forEachOrientedTile(const cv::Rect& region, const Segment& segment) {
+    int tileRows = (region.height + kOrientTile - 1) / kOrientTile;
+    auto body = [&](int begin, int end) {
+        for (int t = begin; t < end; ++t) {
+            int yBegin = region.y + t * kOrientTile;
+            int yEnd = std::min(yBegin + kOrientTile, region.y + region.height);
+            for (int xBegin = region.x; xBegin < region.x + region.width;
+                 xBegin += kOrientTile) {
+                int xEnd = std::min(xBegin + kOrientTile, region.x + region.width);
+                for (int y = yBegin; y < yEnd; ++y) {
+                    segment(y, xBegin, xEnd);
+                }
+            }
+        }
+    };
+
+    ThreadPool* pool = ThreadPool::current();
+    if (pool) {
+        pool->parallelFor(0, tileRows, 1, body);
+    } else {
+        body(0, tileRows);
+    }
+}
+
+/**
+ * Output kernels for one input layout and output format
+ *
+ * Every kernel is a template on the chroma step (interleaved NV21 / NV12 or
+ * planar I420) and the output store policy (pixel_store.h). All combinations
+ * are instantiated at compile time into a table; inputView() picks the entry
+ * once per frame, so inner loops carry no per-pixel layout or format checks.
+ * The processing mode only decides which of the kernels a frame runs.
+ */
+struct OpenCVProcessor::Kernels {
+    // Convert a YUV region into the output, oriented, without resampling
+    void (*convert)(const InputView& input, const cv::Rect& region, cv::Mat& output);
+
+    // Write the luma of a region into the output (grayscale mode)
+    void (*gray)(const InputView& input, const cv::Rect& region, cv::Mat& output);
+
+    // Write an 8-bit image (e.g. an edge mask) into an output region, plain
+    // or through a color table
+    void (*expand)(const cv::Mat& source, const cv::Rect& region, const uint32_t* lut,
+                   cv::Mat& output);
+
+    static const Kernels& select(InputLayout layout, OutputFormat format);
+
+private:
+    template <int ChromaStep, typename Store>
+    static Kernels make() {
+        return {&convertYuv<ChromaStep, Store>, &convertGray<Store>, &expandRows<Store>};
+    }
+
+    template <int ChromaStep, typename Store>
+    static void convertYuv(const InputView& input, const cv::Rect& region, cv::Mat& output) {
+        if constexpr (ChromaStep == 2 && std::is_same<Store, RgbaStore>::value) {
+            if (input.direct) {
+                // Unrotated interleaved chroma: OpenCV's vectorized converter
+                cv::Mat dst = output(region);
+                cv::Rect source(region.x + input.crop.x, region.y + input.crop.y,
+                                region.width, region.height);
+                cv::Rect chroma(source.x / 2, source.y / 2, source.width / 2, source.height / 2);
+                cv::cvtColorTwoPlane(input.yPlane(source), input.chromaPlane(chroma), dst,
+                                     input.layout == INPUT_NV12 ? cv::COLOR_YUV2RGBA_NV12
+                                                                : cv::COLOR_YUV2RGBA_NV21);
+                return;
+            }
+        }
+
+        if constexpr (std::is_same<Store, Rgb565Store>::value) {
+            if (input.direct) {
+                // Unrotated: whole rows through the vectorized converter
+                forEachRow(region, [&](int y) {
+                    int sx = region.x + input.crop.x;
+                    int sy = y + input.crop.y;
+                    size_t c = (sy >> 1) * input.chromaStride + (sx >> 1) * ChromaStep;
+                    yuvToRgb565Row(input.yPlane.ptr<uint8_t>(sy) + sx, input.uData + c,
+                                   input.vData + c, ChromaStep,
+                                   output.ptr<uint16_t>(y) + region.x, region.width);
+                });
+                return;
+            }
+        }
+
+        // Read, orient and convert in one pass
+        const uint8_t* yData = input.yPlane.data;
+        size_t yStride = input.yPlane.step;
+
+        forEachOrientedTile(region, [&](int y, int xBegin, int xEnd) {
+            int sx = input.x0 + xBegin * input.xdx + y * input.xdy;
+            int sy = input.y0 + xBegin * input.ydx + y * input.ydy;
+            uint8_t* out = output.ptr<uint8_t>(y);
+
+            for (int x = xBegin; x < xEnd; ++x, sx += input.xdx, sy += input.ydx) {
+                int luma = yData[sy * yStride + sx];
+                if constexpr (Store::kColor) {
+                    size_t c = (sy >> 1) * input.chromaStride + (sx >> 1) * ChromaStep;
+                    int r, g, b;
+                    yuvPixel(luma, input.vData[c], input.uData[c], r, g, b);
+                    storePixel<Store>(out, x, Store::rgb(r, g, b));
+                } else {
+                    storePixel<Store>(out, x, Store::gray(luma));
+                }
+            }
+        });
+    }
+
+    template <typename Store>
+    static void convertGray(const InputView& input, const cv::Rect& region, cv::Mat& output) {
+        if (input.direct) {
+            // The Y plane already is the grayscale image - expand it row by row
+            cv::Rect source(region.x + input.crop.x, region.y + input.crop.y,
+                            region.width, region.height);
+            expandRows<Store>(input.yPlane(source), region, kFullRangeLuma.rgba, output);
+            return;
+        }
+
+        // Read, orient and expand in one pass
+        const uint8_t* yData = input.yPlane.data;
+        size_t yStride = input.yPlane.step;
+        ptrdiff_t step = input.xdx + input.ydx * static_cast<ptrdiff_t>(yStride);
+
+        forEachOrientedTile(region, [&](int y, int xBegin, int xEnd) {
+            const uint8_t* src = yData + (input.y0 + xBegin * input.ydx + y * input.ydy) * yStride
+                                 + input.x0 + xBegin * input.xdx + y * input.xdy;
+            uint8_t* out = output.ptr<uint8_t>(y);
+            for (int x = xBegin; x < xEnd; ++x, src += step) {
+                storePixel<Store>(out, x, Store::gray(kFullRangeLuma.gray[*src]));
+            }
+        });
+    }
+
+    template <typename Store>
+    static void expandRows(const cv::Mat& source, const cv::Rect& region, const uint32_t* lut,
+                           cv::Mat& output) {
+        size_t offset = region.x * sizeof(typename Store::Pixel);
+        forEachRow(region, [&](int y) {
+            const uint8_t* src = source.ptr<uint8_t>(y - region.y);
+            uint8_t* out = output.ptr<uint8_t>(y) + offset;
+            if (lut) {
+                lutRow<Store>(src, out, region.width, lut);
+            } else {
+                Store::expandRow(src, out, region.width);
+            }
+        });
+    }
+};
+
+const OpenCVProcessor::Kernels& OpenCVProcessor::Kernels::select(InputLayout layout,
+                                                                 OutputFormat format) {
+    // [layout][format]; NV21 and NV12 differ only in where inputView() points U and V
+    static const Kernels table[3][3] = {
+            {make<2, RgbaStore>(), make<2, Rgb565Store>(), make<2, Gray8Store>()},
+            {make<2, RgbaStore>(), make<2, Rgb565Store>(), make<2, Gray8Store>()},
+            {make<1, RgbaStore>(), make<1, Rgb565Store>(), make<1, Gray8Store>()}
+    };
+    return table[layout][format];
+}
+
+#ifdef HAVE_CV_PARALLEL_BACKEND
+/**
+ * OpenCV parallel backend that runs cv::parallel_for_ on the pool bound to
+ * the calling thread (see ThreadPool::Scope). Loops started on threads
+ * without a pool, e.g. inside a pool worker, run serially.
+ */
+class PoolParallelBackend : public cv::parallel::ParallelForAPI {
+public:
+    int getThreadNum() const override {
+        return ThreadPool::currentWorkerIndex();
+    }
+
+    int getNumThreads() const override {
+        ThreadPool* pool = ThreadPool::current();
+        return pool ? pool->concurrency() : 1;
+    }
+
+    int setNumThreads(int /* nThreads */) override {
+        // Thread count is owned by OpenCVProcessor::configureThreads()
+        return getNumThreads();
+    }
+
+    void parallel_for(int tasks, FN_parallel_for_body_cb_t bodyCallback,
+                      void* callbackData) override {
+        ThreadPool* pool = ThreadPool::current();
+        if (!pool) {
+            bodyCallback(0, tasks, callbackData);
+            return;
+        }
+
+        pool->parallelFor(0, tasks, 1, [&](int begin, int end) {
+            bodyCallback(begin, end, callbackData);
+        });
+    }
+
+    const char* getName() const override {
+        return "edge_detection_pool";
+    }
+};
+#endif
+
+static void installParallelBackend() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+#ifdef HAVE_CV_PARALLEL_BACKEND
+        cv::parallel::setParallelForBackend(std::make_shared<PoolParallelBackend>(), false);
+        LOGI("OpenCV parallel loops routed to processor thread pool");
+#else
+        LOGW("OpenCV %s has no pluggable parallel backend; using its own threads",
+             CV_VERSION);
+#endif
+    });
+}
 
 OpenCVProcessor::OpenCVProcessor()
         : frameWidth(0)
         , frameHeight(0)
-        , cannyLowThreshold(50.0)
-        , cannyHighThreshold(150.0)
-        , initialized(false) {
+        , params(kDefaultParams)
+        , initialized(false)
+        , pendingTrimLevel(0)
+        , threadConfigDirty(false)
+        , frameBudgetMs(0.0)
+        , appliedFrameBudgetMs(0.0)
+        , statFrames(0)
+        , statLastFrameMs(0.0)
+        , statAverageFrameMs(0.0)
+        , statQualityLevel(-1) {
+    installParallelBackend();
     LOGI("OpenCVProcessor created");
 }
 
@@ -24,15 +371,17 @@ bool OpenCVProcessor::init(int width, int height) {
         return false;
     }
 
+    std::lock_guard<std::mutex> lock(frameMutex);
+    if (initialized && width == frameWidth && height == frameHeight) {
+        return true;
+    }
+
+    // Buffers keep their capacity; smaller frames reuse them as they are
     frameWidth = width;
     frameHeight = height;
-
-    // Pre-allocate matrices
-    yuvMat = cv::Mat(height + height / 2, width, CV_8UC1);
-    rgbaMat = cv::Mat(height, width, CV_8UC4);
-    grayMat = cv::Mat(height, width, CV_8UC1);
-    edgesMat = cv::Mat(height, width, CV_8UC1);
-    tempMat = cv::Mat(height, width, CV_8UC4);
+    for (auto& ws : workspaces) {
+        ws->resetHighWater();
+    }
 
     initialized = true;
     LOGI("Initialized with dimensions: %dx%d", width, height);
@@ -41,35 +390,220 @@ bool OpenCVProcessor::init(int width, int height) {
 
 bool OpenCVProcessor::processFrame(const uint8_t* yuvData, size_t yuvSize,
                                    uint8_t* outputRgba, ProcessingMode mode) {
+    return processFrame(yuvData, yuvSize, outputRgba, mode, FrameTransform());
+}
+
+bool OpenCVProcessor::processFrame(const uint8_t* yuvData, size_t yuvSize,
+                                   uint8_t* outputRgba, ProcessingMode mode,
+                                   const FrameTransform& transform) {
+    if (!yuvData || !outputRgba) {
+        LOGE("Null input/output pointers");
+        return false;
+    }
+
+    if (transform.rotation % 90 != 0) {
+        LOGE("Unsupported rotation: %d", transform.rotation);
+        return false;
+    }
+
+    if (bytesPerPixel(transform.outputFormat) == 0) {
+        LOGE("Unsupported output format: %d", transform.outputFormat);
+        return false;
+    }
+
+    if (transform.inputLayout < INPUT_NV21 || transform.inputLayout > INPUT_I420) {
+        LOGE("Unsupported input layout: %d", transform.inputLayout);
+        return false;
+    }
+
+    // Dimensions are checked under the lock so init() cannot change them mid-frame
+    std::lock_guard<std::mutex> frameLock(frameMutex);
     if (!initialized) {
         LOGE("Processor not initialized");
         return false;
     }
 
-    if (!yuvData || !outputRgba) {
-        LOGE("Null input/output pointers");
+    if (yuvSize < yuvFrameBytes()) {
+        LOGE("YUV buffer too small: %zu bytes", yuvSize);
         return false;
     }
 
+    ThreadPool::Scope poolScope(&acquireThreadPool());
+
+    double budget = frameBudgetMs.load(std::memory_order_relaxed);
+    if (budget != appliedFrameBudgetMs) {
+        governor.setTarget(budget);
+        appliedFrameBudgetMs = budget;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    // One consistent view of the runtime parameters for the whole frame
+    const Params frameParams = params.load();
+
+    bool success = false;
     try {
-        // Convert YUV to RGBA
-        yuvToRgba(yuvData, rgbaMat);
+        // The workspace and the geometry copies allocate outside renderFrame()
+        Workspace& ws = workspaceAt(0);
+        success = renderFrame(yuvData, outputRgba, mode, frameParams,
+                              frameQuality(frameParams, true), ws, transform);
+        if (success) {
+            std::lock_guard<std::mutex> lock(geometryMutex);
+            lastSegments = ws.segments;
+            lastPolylines = ws.polylines;
+            lastKeypoints = ws.keypoints;
+        }
+    } catch (const std::exception& e) {
+        LOGE("Exception: %s", e.what());
+        success = false;
+    }
+
+    if (success) {
+        std::chrono::duration<double, std::milli> elapsed =
+                std::chrono::steady_clock::now() - startTime;
+        recordFrames(elapsed.count(), 1, mode == MODE_CANNY);
+
+        if (recorder) {
+            // Recorded as written: output size times the output format's
+            // pixel size; frames of another transform than the recorder was
+            // sized for do not match its frame size and are dropped
+            cv::Size outputSize = getOutputSize(transform);
+            recorder->submit(outputRgba, static_cast<size_t>(outputSize.area()) *
+                                         bytesPerPixel(transform.outputFormat));
+        }
+    }
+
+    applyPendingTrim();
+    return success;
+}
+
+int OpenCVProcessor::processBatch(const uint8_t* yuvFrames, size_t yuvSize,
+                                  uint8_t* outputRgba, size_t outputSize,
+                                  int frameCount, ProcessingMode mode,
+                                  uint8_t* frameStatus) {
+    if (!yuvFrames || !outputRgba || frameCount <= 0) {
+        LOGE("Invalid batch: %d frames", frameCount);
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> frameLock(frameMutex);
+    if (!initialized) {
+        LOGE("Processor not initialized");
+        return 0;
+    }
+
+    size_t inputBytes = yuvFrameBytes();
+    size_t outputBytes = static_cast<size_t>(frameWidth) * frameHeight * 4;
+    if (yuvSize < inputBytes * frameCount || outputSize < outputBytes * frameCount) {
+        LOGE("Batch buffers too small for %d frames: %zu / %zu bytes",
+             frameCount, yuvSize, outputSize);
+        return 0;
+    }
+
+    ThreadPool& pool = acquireThreadPool();
+    ThreadPool::Scope poolScope(&pool);
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    // Frames are independent: same snapshot for all, no governor (no deadline)
+    const Params frameParams = params.load();
+    const QualityLevel quality = frameQuality(frameParams, false);
+
+    std::atomic<int> succeeded(0);
+    if (frameStatus) {
+        std::memset(frameStatus, 0, frameCount);
+    }
+    try {
+        // One workspace per thread; index 0 is the calling thread
+        for (int i = 0; i < pool.concurrency(); ++i) {
+            workspaceAt(i);
+        }
+
+        pool.parallelFor(0, frameCount, 1, [&](int begin, int end) {
+            Workspace& ws = *workspaces[ThreadPool::currentWorkerIndex()];
+            for (int i = begin; i < end; ++i) {
+                // A throwing frame fails alone instead of ending the batch
+                bool ok = false;
+                try {
+                    ok = renderFrame(yuvFrames + inputBytes * i, outputRgba + outputBytes * i,
+                                     mode, frameParams, quality, ws, FrameTransform());
+                } catch (const std::exception& e) {
+                    LOGE("Exception in batch frame %d: %s", i, e.what());
+                }
+                if (frameStatus) {
+                    frameStatus[i] = ok ? 1 : 0;
+                }
+                if (ok) {
+                    succeeded.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+    } catch (const std::exception& e) {
+        LOGE("Batch failed: %s", e.what());
+    }
+
+    int done = succeeded.load();
+    if (done > 0) {
+        std::chrono::duration<double, std::milli> elapsed =
+                std::chrono::steady_clock::now() - startTime;
+        recordFrames(elapsed.count(), done, false);
+    }
+
+    applyPendingTrim();
+    return done;
+}
+
+bool OpenCVProcessor::renderFrame(const uint8_t* yuvData, uint8_t* outputRgba,
+                                  ProcessingMode mode, const Params& frameParams,
+                                  const QualityLevel& quality, Workspace& ws,
+                                  const FrameTransform& transform) {
+    ws.segments.clear();
+    ws.polylines.vertices.clear();
+    ws.polylines.offsets.clear();
+    ws.polylines.truncated = false;
+    ws.keypoints.clear();
+    try {
+        // Wrap the NV21 planes and the output buffer without copying
+        InputView input = inputView(yuvData, transform);
+        int outputType = CV_MAKETYPE(CV_8U, bytesPerPixel(transform.outputFormat));
+        cv::Mat output(input.outputSize.height, input.outputSize.width, outputType, outputRgba);
+
+        cv::Rect roi = activeRoi(frameParams, input.size);
 
         // Apply processing based on mode
         switch (mode) {
             case MODE_RAW:
-                // Pass-through - just copy RGBA data
-                memcpy(outputRgba, rgbaMat.data, frameWidth * frameHeight * 4);
+                // Pass-through - convert straight into the output
+                convertYuv(input, roi, ws, output);
                 break;
 
             case MODE_GRAYSCALE:
-                applyGrayscale(rgbaMat, tempMat);
-                memcpy(outputRgba, tempMat.data, frameWidth * frameHeight * 4);
+                applyGrayscale(input, roi, ws, output);
                 break;
 
             case MODE_CANNY:
-                applyCanny(rgbaMat, tempMat);
-                memcpy(outputRgba, tempMat.data, frameWidth * frameHeight * 4);
+                if (quality.roiFraction < 1.0) {
+                    // Keep a centered part of the ROI, still even-aligned
+                    cv::Rect requested = roi;
+                    int w = static_cast<int>(roi.width * quality.roiFraction) & ~1;
+                    int h = static_cast<int>(roi.height * quality.roiFraction) & ~1;
+                    roi = cv::Rect((roi.x + (roi.width - w) / 2) & ~1,
+                                   (roi.y + (roi.height - h) / 2) & ~1,
+                                   std::max(w, 2), std::max(h, 2));
+
+                    // The dropped band is background, not whatever the pooled
+                    // buffer held; under ROI_OUTSIDE_RAW the fill below covers it
+                    if (frameParams.roiOutsidePolicy != ROI_OUTSIDE_RAW) {
+                        clearRoiBand(input, requested, roi, frameParams, ws, output);
+                    }
+                }
+                applyCanny(input, roi, frameParams, quality, ws, output);
+                break;
+
+            case MODE_SOBEL:
+            case MODE_SCHARR:
+            case MODE_LOG:
+                applyGradient(input, roi, mode, frameParams, quality, ws, output);
                 break;
 
             default:
@@ -77,57 +611,789 @@ bool OpenCVProcessor::processFrame(const uint8_t* yuvData, size_t yuvSize,
                 return false;
         }
 
+        if (frameParams.roiOutsidePolicy == ROI_OUTSIDE_RAW) {
+            fillOutsideRoi(input, roi, ws, output);
+        }
+
         return true;
 
     } catch (const cv::Exception& e) {
         LOGE("OpenCV exception: %s", e.what());
         return false;
+    } catch (const std::exception& e) {
+        // E.g. bad_alloc from the geometry vectors; must not reach the JNI caller
+        LOGE("Exception: %s", e.what());
+        return false;
+    }
+}
+
+QualityLevel OpenCVProcessor::frameQuality(const Params& frameParams, bool adaptive) const {
+    if (adaptive && governor.enabled()) {
+        return governor.settings();
+    }
+
+    QualityLevel quality = QualityGovernor::defaults();
+    quality.blurKernel = frameParams.blurKernel;
+    quality.blurSigma = frameParams.blurSigma;
+    return quality;
+}
+
+size_t OpenCVProcessor::yuvFrameBytes() const {
+    return static_cast<size_t>(frameWidth) * frameHeight * 3 / 2;
+}
+
+ThreadPool& OpenCVProcessor::acquireThreadPool() {
+    if (!threadPool || threadConfigDirty.load(std::memory_order_acquire)) {
+        applyThreadConfig();
+    }
+    return *threadPool;
+}
+
+OpenCVProcessor::Workspace& OpenCVProcessor::workspaceAt(int index) {
+    while (static_cast<int>(workspaces.size()) <= index) {
+        workspaces.emplace_back(new Workspace(&memoryTracker));
+    }
+    return *workspaces[index];
+}
+
+void OpenCVProcessor::applyPendingTrim() {
+    int trimLevel = pendingTrimLevel.exchange(0, std::memory_order_acq_rel);
+    if (trimLevel > 0) {
+        applyTrim(trimLevel);
+    }
+}
+
+OpenCVProcessor::InputView OpenCVProcessor::inputView(const uint8_t* yuvData,
+                                                      const FrameTransform& transform) const {
+    InputView input;
+    if (yuvData) {
+        uint8_t* yuv = const_cast<uint8_t*>(yuvData);
+        uint8_t* chroma = yuv + frameWidth * frameHeight;
+        input.yPlane = cv::Mat(frameHeight, frameWidth, CV_8UC1, yuv);
+
+        switch (transform.inputLayout) {
+            case INPUT_I420:
+                input.uData = chroma;
+                input.vData = chroma + (frameWidth / 2) * (frameHeight / 2);
+                input.chromaStride = frameWidth / 2;
+                input.chromaStep = 1;
+                break;
+            case INPUT_NV12:
+            case INPUT_NV21:
+                input.chromaPlane = cv::Mat(frameHeight / 2, frameWidth / 2, CV_8UC2, chroma);
+                input.uData = transform.inputLayout == INPUT_NV12 ? chroma : chroma + 1;
+                input.vData = transform.inputLayout == INPUT_NV12 ? chroma + 1 : chroma;
+                input.chromaStride = input.chromaPlane.step;
+                input.chromaStep = 2;
+                break;
+        }
+        input.kernels = &Kernels::select(transform.inputLayout, transform.outputFormat);
+    }
+    input.layout = transform.inputLayout;
+
+    // Crop snapped outwards to even coordinates, like the ROI
+    cv::Rect frame(0, 0, frameWidth, frameHeight);
+    int x0 = transform.cropX & ~1;
+    int y0 = transform.cropY & ~1;
+    int x1 = (transform.cropX + transform.cropWidth + 1) & ~1;
+    int y1 = (transform.cropY + transform.cropHeight + 1) & ~1;
+    input.crop = transform.cropWidth > 0 && transform.cropHeight > 0
+                 ? cv::Rect(x0, y0, x1 - x0, y1 - y0) & frame
+                 : frame;
+    if (input.crop.empty()) {
+        input.crop = frame;
+    }
+
+    // Sensor position of output pixel (x, y) before mirroring; then mirror
+    // by reading the output row backwards
+    int cw = input.crop.width;
+    int ch = input.crop.height;
+    int rotation = ((transform.rotation % 360) + 360) % 360;
+    switch (rotation) {
+        case 90:
+            input.size = cv::Size(ch, cw);
+            input.x0 = 0;      input.xdx = 0;  input.xdy = 1;
+            input.y0 = ch - 1; input.ydx = -1; input.ydy = 0;
+            break;
+        case 180:
+            input.size = cv::Size(cw, ch);
+            input.x0 = cw - 1; input.xdx = -1; input.xdy = 0;
+            input.y0 = ch - 1; input.ydx = 0;  input.ydy = -1;
+            break;
+        case 270:
+            input.size = cv::Size(ch, cw);
+            input.x0 = cw - 1; input.xdx = 0;  input.xdy = -1;
+            input.y0 = 0;      input.ydx = 1;  input.ydy = 0;
+            break;
+        default:
+            input.size = cv::Size(cw, ch);
+            input.x0 = 0;      input.xdx = 1;  input.xdy = 0;
+            input.y0 = 0;      input.ydx = 0;  input.ydy = 1;
+            break;
+    }
+
+    if (transform.mirror) {
+        input.x0 += input.xdx * (input.size.width - 1);
+        input.y0 += input.ydx * (input.size.width - 1);
+        input.xdx = -input.xdx;
+        input.ydx = -input.ydx;
     }
+
+    input.x0 += input.crop.x;
+    input.y0 += input.crop.y;
+    input.direct = rotation == 0 && !transform.mirror;
+    input.outputSize = transform.outputWidth > 0 && transform.outputHeight > 0
+                       ? cv::Size(transform.outputWidth, transform.outputHeight)
+                       : input.size;
+    return input;
 }
 
-void OpenCVProcessor::yuvToRgba(const uint8_t* yuvData, cv::Mat& output) {
-    // Copy YUV data to matrix
-    memcpy(yuvMat.data, yuvData, frameWidth * frameHeight * 3 / 2);
+cv::Size OpenCVProcessor::getOutputSize(const FrameTransform& transform) const {
+    // Only the geometry is needed; no planes are wrapped
+    return inputView(nullptr, transform).outputSize;
+}
 
-    // Convert YUV_NV21 to RGBA
-    cv::cvtColor(yuvMat, output, cv::COLOR_YUV2RGBA_NV21);
+int OpenCVProcessor::bytesPerPixel(OutputFormat format) {
+    switch (format) {
+        case OUTPUT_RGBA8888:
+            return 4;
+        case OUTPUT_RGB565:
+            return 2;
+        case OUTPUT_GRAY8:
+            return 1;
+    }
+    return 0;
 }
 
-void OpenCVProcessor::applyGrayscale(const cv::Mat& input, cv::Mat& output) {
-    // Convert to grayscale
-    cv::cvtColor(input, grayMat, cv::COLOR_RGBA2GRAY);
+cv::Rect OpenCVProcessor::activeRoi(const Params& frameParams, const cv::Size& frameSize) const {
+    cv::Rect frame(0, 0, frameSize.width, frameSize.height);
+    cv::Rect roiRequest(frameParams.roiX, frameParams.roiY,
+                        frameParams.roiWidth, frameParams.roiHeight);
+    if (roiRequest.empty()) {
+        return frame;
+    }
+
+    // Snap outwards to even coordinates so chroma rows/columns line up
+    int x0 = roiRequest.x & ~1;
+    int y0 = roiRequest.y & ~1;
+    int x1 = (roiRequest.x + roiRequest.width + 1) & ~1;
+    int y1 = (roiRequest.y + roiRequest.height + 1) & ~1;
 
-    // Convert back to RGBA for rendering
-    cv::cvtColor(grayMat, output, cv::COLOR_GRAY2RGBA);
+    cv::Rect roi = cv::Rect(x0, y0, x1 - x0, y1 - y0) & frame;
+    return roi.empty() ? frame : roi;
 }
 
-void OpenCVProcessor::applyCanny(const cv::Mat& input, cv::Mat& output) {
-    // Convert to grayscale first
-    cv::cvtColor(input, grayMat, cv::COLOR_RGBA2GRAY);
+cv::Mat OpenCVProcessor::orientedLuma(const InputView& input, const cv::Rect& region,
+                                      Workspace& ws) {
+    if (input.direct) {
+        return input.yPlane(input.crop);
+    }
 
-    // Apply Gaussian blur to reduce noise
-    cv::GaussianBlur(grayMat, grayMat, cv::Size(5, 5), 1.5);
+    // Only the region is filled; callers read nothing else
+    cv::Mat luma = ws.oriented.get(input.size.height, input.size.width, CV_8UC1);
+    const uint8_t* yData = input.yPlane.data;
+    size_t yStride = input.yPlane.step;
+    ptrdiff_t step = input.xdx + input.ydx * static_cast<ptrdiff_t>(yStride);
 
-    // Apply Canny edge detection
-    cv::Canny(grayMat, edgesMat, cannyLowThreshold, cannyHighThreshold, 3);
+    forEachOrientedTile(region, [&](int y, int xBegin, int xEnd) {
+        const uint8_t* src = yData + (input.y0 + xBegin * input.ydx + y * input.ydy) * yStride
+                             + input.x0 + xBegin * input.xdx + y * input.xdy;
+        uint8_t* dst = luma.ptr<uint8_t>(y);
+        for (int x = xBegin; x < xEnd; ++x, src += step) {
+            dst[x] = *src;
+        }
+    });
+    return luma;
+}
 
-    // Convert edges to RGBA (edges are white on black background)
-    cv::cvtColor(edgesMat, output, cv::COLOR_GRAY2RGBA);
+/**
+ * Map luma through kFullRangeLuma (destination may be the source)
+ */
+static void toFullRange(const cv::Mat& source, cv::Mat& destination) {
+    forEachRow(cv::Rect(0, 0, source.cols, source.rows), [&](int y) {
+        const uint8_t* src = source.ptr<uint8_t>(y);
+        uint8_t* dst = destination.ptr<uint8_t>(y);
+        for (int x = 0; x < source.cols; ++x) {
+            dst[x] = kFullRangeLuma.gray[src[x]];
+        }
+    });
+}
+
+void OpenCVProcessor::convertYuv(const InputView& input, const cv::Rect& region, Workspace& ws,
+                                 cv::Mat& output) {
+    if (input.outputSize == input.size) {
+        input.kernels->convert(input, region, output);
+        return;
+    }
+
+    // Chroma interpolation is not separable from the resample here, so a
+    // scaled output is converted at the oriented size first
+    cv::Mat rgba = ws.rgba.get(input.size.height, input.size.width, CV_8UC4);
+    Kernels::select(input.layout, OUTPUT_RGBA8888).convert(input, region, rgba);
+
+    cv::Mat dst = output(scaleRect(region, input.size, input.outputSize));
+    resampleRgba(rgba(region), dst);
+}
+
+/**
+ * Split outer minus inner (inner lies within outer) into four rectangles
+ * Top and bottom bands span the full width, left and right bands the inner rows.
+ */
+static void roiBands(const cv::Rect& outer, const cv::Rect& inner, cv::Rect bands[4]) {
+    int right = outer.x + outer.width;
+    int bottom = outer.y + outer.height;
+    bands[0] = cv::Rect(outer.x, outer.y, outer.width, inner.y - outer.y);
+    bands[1] = cv::Rect(outer.x, inner.y + inner.height, outer.width,
+                        bottom - inner.y - inner.height);
+    bands[2] = cv::Rect(outer.x, inner.y, inner.x - outer.x, inner.height);
+    bands[3] = cv::Rect(inner.x + inner.width, inner.y, right - inner.x - inner.width,
+                        inner.height);
+}
+
+void OpenCVProcessor::fillOutsideRoi(const InputView& input, const cv::Rect& roi,
+                                     Workspace& ws, cv::Mat& output) {
+    cv::Rect bands[4];
+    roiBands(cv::Rect(0, 0, input.size.width, input.size.height), roi, bands);
+    for (const cv::Rect& band : bands) {
+        if (!band.empty()) {
+            convertYuv(input, band, ws, output);
+        }
+    }
+}
+
+void OpenCVProcessor::clearRoiBand(const InputView& input, const cv::Rect& outer,
+                                   const cv::Rect& inner, const Params& frameParams,
+                                   Workspace& ws, cv::Mat& output) {
+    // An empty mask drawn like Canny output gives the background in any
+    // output format and size
+    cv::Rect bands[4];
+    roiBands(outer, inner, bands);
+    for (const cv::Rect& band : bands) {
+        if (band.empty()) {
+            continue;
+        }
+        cv::Mat mask = ws.edges.get(band.height, band.width, CV_8UC1);
+        for (int y = 0; y < mask.rows; ++y) {
+            std::memset(mask.ptr<uint8_t>(y), 0, mask.cols);
+        }
+        cannyExpand(input, mask, band, band, frameParams, output);
+    }
+}
+
+void OpenCVProcessor::applyGrayscale(const InputView& input, const cv::Rect& roi,
+                                     Workspace& ws, cv::Mat& output) {
+    if (input.outputSize != input.size) {
+        // Resample the luma and expand it in the same pass
+        cv::Mat luma = orientedLuma(input, roi, ws);
+        cv::Mat dst = output(scaleRect(roi, input.size, input.outputSize));
+        resampleGray(luma(roi), dst, kFullRangeLuma.rgba);
+        return;
+    }
+
+    input.kernels->gray(input, roi, output);
+}
+
+// Coordinate in another pixel grid: origin offset plus scale, keeping pixel
+// centers on pixel centers
+static inline float mapCoordinate(float v, double offset, double scale) {
+    return static_cast<float>(offset + (v + 0.5) * scale - 0.5);
+}
+
+static void mapSegments(std::vector<LineSegment>& segments, double offsetX, double offsetY,
+                        double scaleX, double scaleY) {
+    for (LineSegment& s : segments) {
+        s.x1 = mapCoordinate(s.x1, offsetX, scaleX);
+        s.y1 = mapCoordinate(s.y1, offsetY, scaleY);
+        s.x2 = mapCoordinate(s.x2, offsetX, scaleX);
+        s.y2 = mapCoordinate(s.y2, offsetY, scaleY);
+    }
+}
+
+static void mapKeypoints(std::vector<Keypoint>& keypoints, double offsetX, double offsetY,
+                         double scaleX, double scaleY) {
+    for (Keypoint& k : keypoints) {
+        k.x = mapCoordinate(k.x, offsetX, scaleX);
+        k.y = mapCoordinate(k.y, offsetY, scaleY);
+    }
+}
+
+static void mapPolylines(PolylineSet& polylines, double offsetX, double offsetY,
+                         double scaleX, double scaleY) {
+    for (size_t i = 0; i < polylines.vertices.size(); i += 2) {
+        polylines.vertices[i] = mapCoordinate(polylines.vertices[i], offsetX, scaleX);
+        polylines.vertices[i + 1] = mapCoordinate(polylines.vertices[i + 1], offsetY, scaleY);
+    }
+}
+
+void OpenCVProcessor::applyCanny(const InputView& input, const cv::Rect& roi,
+                                 const Params& frameParams, const QualityLevel& quality,
+                                 Workspace& ws, cv::Mat& output) {
+    cv::Rect work = cannyWorkRect(roi, frameParams, quality, input.size);
+    cv::Mat luma = orientedLuma(input, work, ws);
+    cv::Mat source = cannyPrepare(luma, work, quality, ws);
+    cv::Mat gray = cannySmooth(source, frameParams, quality, ws);
+    cv::Mat edges = cannyEdges(gray, work, frameParams, quality, ws);
+    cannyExpand(input, edges, roi, work, frameParams, output);
+
+    if (input.outputSize != input.size) {
+        double scaleX = static_cast<double>(input.outputSize.width) / input.size.width;
+        double scaleY = static_cast<double>(input.outputSize.height) / input.size.height;
+        mapSegments(ws.segments, 0.0, 0.0, scaleX, scaleY);
+        mapPolylines(ws.polylines, 0.0, 0.0, scaleX, scaleY);
+        mapKeypoints(ws.keypoints, 0.0, 0.0, scaleX, scaleY);
+    }
+}
+
+// The ROI plus the halo filters read at a processing scale (in full-resolution
+// pixels, rounded to even), clamped to the frame
+static cv::Rect haloRect(const cv::Rect& roi, int filterHalo, double scale,
+                         const cv::Size& frame) {
+    int halo = (static_cast<int>(std::ceil(filterHalo / scale)) + 1) & ~1;
+    return cv::Rect(roi.x - halo, roi.y - halo, roi.width + 2 * halo, roi.height + 2 * halo)
+           & cv::Rect(0, 0, frame.width, frame.height);
+}
+
+void OpenCVProcessor::applyGradient(const InputView& input, const cv::Rect& roi,
+                                    ProcessingMode mode, const Params& frameParams,
+                                    const QualityLevel& quality, Workspace& ws,
+                                    cv::Mat& output) {
+    // Full resolution, straight from the luma plane; 3x3 operators read one
+    // pixel around the ROI. LoG reads two on top of its blur radius: a
+    // crossing compares the Laplacian with the next one, which reads a pixel
+    // further
+    int halo = mode == MODE_LOG ? gaussianBlurRadius(frameParams.blurMethod, quality.blurKernel,
+                                                     quality.blurSigma) + 2 : 1;
+    cv::Rect work = haloRect(roi, halo, 1.0, input.size);
+    cv::Mat gray = ws.smooth.get(work.height, work.width, CV_8UC1);
+    toFullRange(orientedLuma(input, work, ws)(work), gray);
+    cv::Mat edges = ws.edges.get(work.height, work.width, CV_8UC1);
+    int threshold = static_cast<int>(std::lround(frameParams.gradientThreshold));
+
+    if (mode == MODE_LOG) {
+        gaussianBlur(gray, gray, quality.blurKernel, quality.blurSigma,
+                     frameParams.blurMethod, ws.blur);
+        laplacianZeroCrossings(gray, edges, threshold);
+    } else {
+        gradientMagnitude(gray, edges, mode == MODE_SCHARR ? GRADIENT_SCHARR : GRADIENT_SOBEL,
+                          threshold);
+    }
+
+    // Same output stage as Canny: mask colors, output size and format
+    cannyExpand(input, edges, roi, work, frameParams, output);
+}
+
+cv::Rect OpenCVProcessor::cannyWorkRect(const cv::Rect& roi, const Params& frameParams,
+                                        const QualityLevel& quality,
+                                        const cv::Size& frame) const {
+    int blurRadius = gaussianBlurRadius(frameParams.blurMethod, quality.blurKernel,
+                                        quality.blurSigma);
+    return haloRect(roi, blurRadius + kEdgeHalo, quality.scale, frame);
+}
+
+cv::Mat OpenCVProcessor::cannyPrepare(const cv::Mat& luma, const cv::Rect& work,
+                                      const QualityLevel& quality, Workspace& ws) {
+    // Full-range luma in the smooth buffer, which the blur then works in place
+    cv::Mat source = luma(work);
+    if (quality.scale >= 1.0) {
+        cv::Mat full = ws.smooth.get(work.height, work.width, CV_8UC1);
+        toFullRange(source, full);
+        return full;
+    }
+
+    // Detect edges at reduced resolution; fewer pixels to stretch after the resize
+    cv::Size size(std::max(1, static_cast<int>(work.width * quality.scale)),
+                  std::max(1, static_cast<int>(work.height * quality.scale)));
+    cv::Mat small = ws.smooth.get(size.height, size.width, CV_8UC1);
+    cv::resize(source, small, size, 0, 0, cv::INTER_AREA);
+    toFullRange(small, small);
+    return small;
+}
+
+cv::Mat OpenCVProcessor::cannySmooth(const cv::Mat& source, const Params& frameParams,
+                                     const QualityLevel& quality, Workspace& ws) {
+    // Apply Gaussian blur to reduce noise (in place when source is the smooth buffer)
+    cv::Mat gray = ws.smooth.get(source.rows, source.cols, CV_8UC1);
+    gaussianBlur(source, gray, quality.blurKernel, quality.blurSigma, frameParams.blurMethod,
+                 ws.blur);
+    return gray;
+}
+
+cv::Mat OpenCVProcessor::cannyEdges(const cv::Mat& gray, const cv::Rect& work,
+                                    const Params& frameParams, const QualityLevel& quality,
+                                    Workspace& ws) {
+    cv::Mat edges = ws.edges.get(gray.rows, gray.cols, CV_8UC1);
+
+    if (frameParams.keypointMaxCount > 0) {
+        // Corners on the blurred luma Canny reads next; the blur intermediate
+        // is free and holds the scores
+        cv::Mat scores = ws.blur.get(gray.rows, gray.cols, CV_16UC1);
+        detectFastCorners(gray, scores, frameParams.keypointThreshold, frameParams.keypointArc,
+                          frameParams.keypointMaxCount, ws.keypoints);
+        mapKeypoints(ws.keypoints, work.x, work.y,
+                     static_cast<double>(work.width) / gray.cols,
+                     static_cast<double>(work.height) / gray.rows);
+    }
+
+    if (frameParams.segmentMinLength > 0) {
+        // Derivatives computed once: Canny takes them as they are (its own
+        // 3x3 Sobel uses the same border) and the segment extractor reuses them
+        cv::Mat dx = ws.dx.get(gray.rows, gray.cols, CV_16SC1);
+        cv::Mat dy = ws.dy.get(gray.rows, gray.cols, CV_16SC1);
+        cv::Sobel(gray, dx, CV_16S, 1, 0, 3, 1, 0, cv::BORDER_REPLICATE);
+        cv::Sobel(gray, dy, CV_16S, 0, 1, 3, 1, 0, cv::BORDER_REPLICATE);
+        cv::Canny(dx, dy, edges, frameParams.cannyLowThreshold,
+                  frameParams.cannyHighThreshold, quality.l2Gradient);
+
+        // Segments at processing resolution, then in oriented frame pixels
+        int minLength = std::max(2, static_cast<int>(
+                std::lround(frameParams.segmentMinLength * quality.scale)));
+        extractLineSegments(edges, dx, dy, minLength, ws.segments);
+        mapSegments(ws.segments, work.x, work.y,
+                    static_cast<double>(work.width) / gray.cols,
+                    static_cast<double>(work.height) / gray.rows);
+    } else {
+        // Apply Canny edge detection
+        cv::Canny(gray, edges, frameParams.cannyLowThreshold, frameParams.cannyHighThreshold,
+                  3, quality.l2Gradient);
+    }
+
+    if (frameParams.polylineMaxVertices > 0) {
+        // Traced at processing resolution; the blur intermediate is free again
+        // and holds the visited marks
+        cv::Mat visited = ws.blur.get(edges.rows, edges.cols, CV_8UC1);
+        traceEdgePolylines(edges, visited, frameParams.polylineTolerance * quality.scale,
+                           frameParams.polylineMaxVertices, ws.polylineScratch, ws.polylines);
+        mapPolylines(ws.polylines, work.x, work.y,
+                     static_cast<double>(work.width) / gray.cols,
+                     static_cast<double>(work.height) / gray.rows);
+    }
+
+    if (quality.scale < 1.0) {
+        // Back to full resolution; the gray buffer is free again
+        cv::Mat full = ws.smooth.get(work.height, work.width, CV_8UC1);
+        cv::resize(edges, full, work.size(), 0, 0, cv::INTER_NEAREST);
+        edges = full;
+    }
+    return edges;
+}
+
+void OpenCVProcessor::cannyExpand(const InputView& input, const cv::Mat& edges,
+                                  const cv::Rect& roi, const cv::Rect& work,
+                                  const Params& frameParams, cv::Mat& output) {
+    // Edges are white on black unless other mask colors are set
+    uint32_t lut[kExpandLutSize];
+    const uint32_t* colors = nullptr;
+    if (frameParams.edgeColor != kPlainEdgeColor ||
+        frameParams.backgroundColor != kPlainBackgroundColor) {
+        buildBlendLut(frameParams.backgroundColor, frameParams.edgeColor, lut);
+        colors = lut;
+    }
+
+    cv::Rect inner(roi.x - work.x, roi.y - work.y, roi.width, roi.height);
+    cv::Mat mask = edges(inner);
+    if (input.outputSize != input.size) {
+        cv::Mat dst = output(scaleRect(roi, input.size, input.outputSize));
+        resampleGray(mask, dst, colors);
+        return;
+    }
+
+    input.kernels->expand(mask, roi, colors, output);
 }
 
 void OpenCVProcessor::setCannyThresholds(double low, double high) {
-    cannyLowThreshold = low;
-    cannyHighThreshold = high;
+    // Both thresholds change in one publication - a frame never sees a torn pair
+    params.update([low, high](Params& p) {
+        p.cannyLowThreshold = low;
+        p.cannyHighThreshold = high;
+    });
     LOGI("Canny thresholds updated: %.1f / %.1f", low, high);
 }
 
+void OpenCVProcessor::setRoi(int x, int y, int width, int height) {
+    if (width <= 0 || height <= 0) {
+        x = y = width = height = 0;
+    }
+
+    // Policy untouched, so a concurrent setRoiOutsidePolicy() is not overwritten
+    params.update([=](Params& p) {
+        p.roiX = x;
+        p.roiY = y;
+        p.roiWidth = width;
+        p.roiHeight = height;
+    });
+    LOGI("ROI set: %d,%d %dx%d", x, y, width, height);
+}
+
+void OpenCVProcessor::setRoi(int x, int y, int width, int height, RoiOutsidePolicy policy) {
+    if (width <= 0 || height <= 0) {
+        x = y = width = height = 0;
+    }
+
+    params.update([=](Params& p) {
+        p.roiX = x;
+        p.roiY = y;
+        p.roiWidth = width;
+        p.roiHeight = height;
+        p.roiOutsidePolicy = policy;
+    });
+    LOGI("ROI set: %d,%d %dx%d", x, y, width, height);
+}
+
+void OpenCVProcessor::clearRoi() {
+    params.update([](Params& p) {
+        p.roiX = p.roiY = p.roiWidth = p.roiHeight = 0;
+    });
+    LOGI("ROI cleared");
+}
+
+void OpenCVProcessor::setRoiOutsidePolicy(RoiOutsidePolicy policy) {
+    params.update([policy](Params& p) { p.roiOutsidePolicy = policy; });
+}
+
+void OpenCVProcessor::setMaskColors(uint32_t edgeArgb, uint32_t backgroundArgb) {
+    params.update([edgeArgb, backgroundArgb](Params& p) {
+        p.edgeColor = edgeArgb;
+        p.backgroundColor = backgroundArgb;
+    });
+    LOGI("Mask colors updated: %08x on %08x", edgeArgb, backgroundArgb);
+}
+
+void OpenCVProcessor::setBlur(int kernelSize, double sigma) {
+    bool fromSigma = kernelSize == 0;
+    if ((!fromSigma && (kernelSize < 3 || kernelSize % 2 == 0)) || sigma <= 0.0) {
+        LOGE("Invalid blur: kernel %d, sigma %.2f", kernelSize, sigma);
+        return;
+    }
+
+    params.update([kernelSize, sigma](Params& p) {
+        p.blurKernel = kernelSize;
+        p.blurSigma = sigma;
+    });
+    LOGI("Blur updated: %dx%d, sigma %.2f", kernelSize, kernelSize, sigma);
+}
+
+void OpenCVProcessor::setGradientThreshold(double threshold) {
+    if (threshold < 0.0) {
+        LOGE("Invalid gradient threshold: %.1f", threshold);
+        return;
+    }
+
+    params.update([threshold](Params& p) { p.gradientThreshold = threshold; });
+    LOGI("Gradient threshold updated: %.1f", threshold);
+}
+
+void OpenCVProcessor::setLineSegments(int minLength) {
+    if (minLength < 0) {
+        LOGE("Invalid line segment length: %d", minLength);
+        return;
+    }
+
+    params.update([minLength](Params& p) { p.segmentMinLength = minLength; });
+    LOGI("Line segments %s: min length %d", minLength > 0 ? "enabled" : "disabled", minLength);
+}
+
+std::vector<LineSegment> OpenCVProcessor::getLineSegments() const {
+    std::lock_guard<std::mutex> lock(geometryMutex);
+    return lastSegments;
+}
+
+void OpenCVProcessor::setPolylines(double tolerance, int maxVertices) {
+    if (tolerance < 0.0 || maxVertices < 0 || maxVertices == 1) {
+        LOGE("Invalid polylines: tolerance %.2f, %d vertices", tolerance, maxVertices);
+        return;
+    }
+
+    params.update([tolerance, maxVertices](Params& p) {
+        p.polylineTolerance = tolerance;
+        p.polylineMaxVertices = maxVertices;
+    });
+    LOGI("Polylines updated: tolerance %.2f, up to %d vertices", tolerance, maxVertices);
+}
+
+void OpenCVProcessor::setKeypoints(int threshold, FastArc arc, int maxKeypoints) {
+    if (threshold < 1 || threshold > 254 || (arc != FAST_9 && arc != FAST_12) ||
+        maxKeypoints < 0) {
+        LOGE("Invalid keypoints: threshold %d, FAST-%d, %d keypoints", threshold, arc,
+             maxKeypoints);
+        return;
+    }
+
+    params.update([threshold, arc, maxKeypoints](Params& p) {
+        p.keypointThreshold = threshold;
+        p.keypointArc = arc;
+        p.keypointMaxCount = maxKeypoints;
+    });
+    LOGI("Keypoints updated: FAST-%d, threshold %d, up to %d", arc, threshold, maxKeypoints);
+}
+
+std::vector<Keypoint> OpenCVProcessor::getKeypoints() const {
+    std::lock_guard<std::mutex> lock(geometryMutex);
+    return lastKeypoints;
+}
+
+void OpenCVProcessor::getPolylines(PolylineSet& polylines) const {
+    std::lock_guard<std::mutex> lock(geometryMutex);
+    polylines.vertices.assign(lastPolylines.vertices.begin(), lastPolylines.vertices.end());
+    polylines.offsets.assign(lastPolylines.offsets.begin(), lastPolylines.offsets.end());
+    polylines.truncated = lastPolylines.truncated;
+}
+
+void OpenCVProcessor::setBlurMethod(BlurMethod method) {
+    if (method < BLUR_AUTO || method > BLUR_RECURSIVE) {
+        LOGE("Invalid blur method: %d", method);
+        return;
+    }
+
+    params.update([method](Params& p) {
+        p.blurMethod = method;
+    });
+    LOGI("Blur method updated: %d", method);
+}
+
+void OpenCVProcessor::configureThreads(const ThreadPoolConfig& config) {
+    std::lock_guard<std::mutex> lock(threadConfigMutex);
+    pendingThreadConfig = config;
+    threadConfigDirty.store(true, std::memory_order_release);
+    LOGI("Thread pool reconfiguration requested: %d threads", config.threadCount);
+}
+
+void OpenCVProcessor::applyThreadConfig() {
+    ThreadPoolConfig config;
+    {
+        std::lock_guard<std::mutex> lock(threadConfigMutex);
+        config = pendingThreadConfig;
+        threadConfigDirty.store(false, std::memory_order_relaxed);
+    }
+
+    // Join the old workers before starting new ones so pinned cores are not oversubscribed
+    threadPool.reset();
+    threadPool.reset(new ThreadPool(config));
+
+#ifndef HAVE_CV_PARALLEL_BACKEND
+    cv::setNumThreads(threadPool->concurrency());
+#endif
+}
+
+void OpenCVProcessor::setFrameBudget(double targetMs) {
+    frameBudgetMs.store(targetMs > 0.0 ? targetMs : 0.0, std::memory_order_relaxed);
+    LOGI("Frame budget requested: %.2f ms", targetMs);
+}
+
+void OpenCVProcessor::recordFrames(double elapsedMs, int frames, bool feedGovernor) {
+    double frameMs = elapsedMs / frames;
+    if (feedGovernor) {
+        governor.onFrame(frameMs);
+    }
+
+    double average = statAverageFrameMs.load(std::memory_order_relaxed);
+    average = average > 0.0 ? average + kStatsAverageWeight * (frameMs - average) : frameMs;
+
+    statLastFrameMs.store(frameMs, std::memory_order_relaxed);
+    statAverageFrameMs.store(average, std::memory_order_relaxed);
+    statQualityLevel.store(governor.enabled() ? governor.level() : -1,
+                           std::memory_order_relaxed);
+    statFrames.fetch_add(frames, std::memory_order_release);
+}
+
+ProcessorStats OpenCVProcessor::getStats() const {
+    ProcessorStats stats;
+    stats.framesProcessed = statFrames.load(std::memory_order_acquire);
+    stats.lastFrameMs = statLastFrameMs.load(std::memory_order_relaxed);
+    stats.averageFrameMs = statAverageFrameMs.load(std::memory_order_relaxed);
+    stats.qualityLevel = statQualityLevel.load(std::memory_order_relaxed);
+    stats.nativeBytes = memoryTracker.current();
+    stats.peakNativeBytes = memoryTracker.peak();
+    return stats;
+}
+
+OpenCVProcessor::Workspace::Workspace(MemoryTracker* tracker)
+        : oriented(tracker)
+        , rgba(tracker)
+        , smooth(tracker)
+        , blur(tracker)
+        , edges(tracker)
+        , dx(tracker)
+        , dy(tracker) {
+}
+
+void OpenCVProcessor::Workspace::resetHighWater() {
+    oriented.resetHighWater();
+    rgba.resetHighWater();
+    smooth.resetHighWater();
+    blur.resetHighWater();
+    edges.resetHighWater();
+    dx.resetHighWater();
+    dy.resetHighWater();
+}
+
+void OpenCVProcessor::Workspace::shrink() {
+    oriented.shrink();
+    rgba.shrink();
+    smooth.shrink();
+    blur.shrink();
+    edges.shrink();
+    dx.shrink();
+    dy.shrink();
+}
+
+void OpenCVProcessor::Workspace::release() {
+    oriented.release();
+    rgba.release();
+    smooth.release();
+    blur.release();
+    edges.release();
+    dx.release();
+    dy.release();
+    std::vector<LineSegment>().swap(segments);
+    polylines = PolylineSet();
+    polylineScratch = PolylineScratch();
+    std::vector<Keypoint>().swap(keypoints);
+}
+
+void OpenCVProcessor::trimMemory(int level) {
+    std::unique_lock<std::mutex> lock(frameMutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        // A frame is in flight - let processFrame() apply the strongest request
+        int pending = pendingTrimLevel.load(std::memory_order_relaxed);
+        while (level > pending &&
+               !pendingTrimLevel.compare_exchange_weak(pending, level,
+                                                       std::memory_order_acq_rel)) {
+        }
+        return;
+    }
+
+    applyTrim(level);
+}
+
+void OpenCVProcessor::applyTrim(int level) {
+    size_t before = memoryTracker.current();
+
+    if (level >= TRIM_RUNNING_LOW) {
+        // Batch workspaces go entirely; the frame workspace is re-created empty
+        workspaces.clear();
+    } else if (level >= TRIM_RUNNING_MODERATE) {
+        for (auto& ws : workspaces) {
+            ws->shrink();
+        }
+    }
+
+    if (level >= TRIM_BACKGROUND && threadPool) {
+        // Worker stacks go too; processFrame() rebuilds the pool from the last config
+        threadPool.reset();
+    }
+
+    LOGI("Trim level %d: %zu -> %zu bytes", level, before, memoryTracker.current());
+}
+
+void OpenCVProcessor::setRecorder(std::shared_ptr<FrameRecorder> frameRecorder) {
+    std::lock_guard<std::mutex> lock(frameMutex);
+    recorder = std::move(frameRecorder);
+}
+
 void OpenCVProcessor::release() {
+    std::lock_guard<std::mutex> lock(frameMutex);
     if (initialized) {
-        yuvMat.release();
-        rgbaMat.release();
-        grayMat.release();
-        edgesMat.release();
-        tempMat.release();
+        workspaces.clear();
         initialized = false;
         LOGI("Resources released");
     }
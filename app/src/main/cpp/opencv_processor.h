@@ -2,20 +2,120 @@
 #define OPENCV_PROCESSOR_H
 
 #include <opencv2/opencv.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <vector>
 
+#include "gaussian_blur.h"
+#include "edge_polylines.h"
+#include "fast_corners.h"
+#include "gradient_edges.h"
+#include "line_segments.h"
+#include "quality_governor.h"
+#include "scratch_buffer.h"
+#include "seqlock.h"
+#include "thread_pool.h"
+
+class FrameRecorder;
+
+/**
+ * Processor statistics snapshot (see OpenCVProcessor::getStats)
+ */
+struct ProcessorStats {
+    uint64_t framesProcessed;  // Frames processed successfully
+    double lastFrameMs;        // Processing time of the most recent frame
+    double averageFrameMs;     // Moving average of the processing time
+    int qualityLevel;          // Governor level (0 = best), -1 when the governor is off
+    size_t nativeBytes;        // Scratch memory currently held by the processor
+    size_t peakNativeBytes;    // Highest nativeBytes seen since creation
+};
+
 /**
  * OpenCV Image Processor
  *
  * Provides high-performance image processing operations using OpenCV C++
- * Supports multiple processing modes: raw, grayscale, and Canny edge detection
+ * Supports multiple processing modes: raw, grayscale, Canny edge detection and
+ * the single-pass Sobel, Scharr and Laplacian of Gaussian edge modes
  */
 class OpenCVProcessor {
 public:
     enum ProcessingMode {
         MODE_RAW = 0,        // Pass-through, no processing
         MODE_GRAYSCALE = 1,  // Grayscale conversion
-        MODE_CANNY = 2       // Canny edge detection
+        MODE_CANNY = 2,      // Canny edge detection
+        MODE_SOBEL = 3,      // Sobel gradient magnitude (fast preview, see gradient_edges.h)
+        MODE_SCHARR = 4,     // Scharr gradient magnitude
+        MODE_LOG = 5         // Zero crossings of the Laplacian of Gaussian
+    };
+
+    enum InputLayout {
+        INPUT_NV21 = 0,  // Y plane, then interleaved V/U
+        INPUT_NV12 = 1,  // Y plane, then interleaved U/V
+        INPUT_I420 = 2   // Y plane, then the U plane, then the V plane
+    };
+
+    enum OutputFormat {
+        OUTPUT_RGBA8888 = 0,  // 4 bytes per pixel
+        OUTPUT_RGB565 = 1,    // 2 bytes per pixel, native-endian 5-6-5 (see rgb565.h)
+        OUTPUT_GRAY8 = 2      // 1 byte per pixel: luma, or the edge mask itself
+    };
+
+    // Memory trim levels (values match android.content.ComponentCallbacks2)
+    enum TrimLevel {
+        TRIM_RUNNING_MODERATE = 5,   // Drop spare buffer capacity
+        TRIM_RUNNING_LOW = 10,       // Free all scratch buffers
+        TRIM_UI_HIDDEN = 20,
+        TRIM_BACKGROUND = 40,        // Also stop the worker threads
+        TRIM_COMPLETE = 80
+    };
+
+    enum RoiOutsidePolicy {
+        ROI_OUTSIDE_UNTOUCHED = 0,  // Leave output pixels outside the ROI as they are
+        ROI_OUTSIDE_RAW = 1         // Fill them with a plain YUV -> RGBA conversion
+    };
+
+    /**
+     * Runtime parameters, published as one block
+     * Setters may run on any thread; processFrame() takes one consistent
+     * snapshot per frame without locking.
+     */
+    struct Params {
+        double cannyLowThreshold;
+        double cannyHighThreshold;
+        int blurKernel;                     // Odd Gaussian kernel size; 0 = from sigma
+        double blurSigma;
+        BlurMethod blurMethod;              // Blur engine (see gaussian_blur.h)
+        int roiX, roiY, roiWidth, roiHeight;  // Requested ROI; empty = full frame
+        RoiOutsidePolicy roiOutsidePolicy;
+        uint32_t edgeColor;                 // Canny mask colors, 0xAARRGGBB
+        uint32_t backgroundColor;
+        double gradientThreshold;           // Sobel / Scharr / LoG mask; 0 = edge strength
+        int segmentMinLength;               // Line segments from Canny frames; 0 = off
+        double polylineTolerance;           // Douglas-Peucker tolerance in frame pixels
+        int polylineMaxVertices;            // Polylines from Canny frames; 0 = off
+        int keypointThreshold;              // FAST contrast threshold
+        FastArc keypointArc;
+        int keypointMaxCount;               // Keypoints from Canny frames; 0 = off
+    };
+
+    /**
+     * Layout, orientation, crop and output size applied while the frame is read
+     * The crop is taken in sensor coordinates (snapped to even values and
+     * clamped to the frame), then rotated clockwise and optionally mirrored.
+     * The ROI refers to this oriented image. With an output size the final
+     * RGBA expansion resamples straight to it (area when shrinking, bilinear
+     * when enlarging); the output is getOutputSize() pixels either way. The
+     * same final pass writes the output format; every layout / format pair
+     * has its own compile-time instantiated kernels.
+     */
+    struct FrameTransform {
+        int rotation = 0;       // Clockwise degrees: 0, 90, 180 or 270
+        bool mirror = false;    // Flip horizontally after rotating (front camera)
+        int cropX = 0, cropY = 0, cropWidth = 0, cropHeight = 0;  // Empty = full frame
+        int outputWidth = 0, outputHeight = 0;  // Empty = oriented crop size
+        OutputFormat outputFormat = OUTPUT_RGBA8888;
+        InputLayout inputLayout = INPUT_NV21;
     };
 
     OpenCVProcessor();
@@ -23,6 +123,9 @@ public:
 
     /**
      * Initialize processor with frame dimensions
+     * May be called again to reconfigure in place: settings, threads and
+     * already allocated buffers are kept. Buffers are allocated lazily by
+     * the first frame whose mode needs them.
      * @param width Frame width in pixels
      * @param height Frame height in pixels
      * @return true if initialization successful
@@ -34,12 +137,52 @@ public:
      * @param yuvData Input YUV_420_888 data
      * @param yuvSize Size of YUV data
      * @param outputRgba Output RGBA buffer (must be pre-allocated: width * height * 4)
-     * @param mode Processing mode (RAW, GRAYSCALE, CANNY)
+     * @param mode Processing mode (RAW, GRAYSCALE, CANNY, SOBEL, SCHARR, LOG)
      * @return true if processing successful
      */
     bool processFrame(const uint8_t* yuvData, size_t yuvSize,
                       uint8_t* outputRgba, ProcessingMode mode);
 
+    /**
+     * Process YUV frame data with rotation, mirroring and crop
+     * The transform is applied by the pass that reads the NV21 data, so no
+     * separate full-frame rotate / flip / crop is needed.
+     * @param outputRgba Output buffer of getOutputSize(transform) pixels in
+     *                   transform.outputFormat
+     * @param transform Orientation, crop, output size and format (see FrameTransform)
+     */
+    bool processFrame(const uint8_t* yuvData, size_t yuvSize,
+                      uint8_t* outputRgba, ProcessingMode mode,
+                      const FrameTransform& transform);
+
+    /**
+     * Output dimensions for a transform at the current frame size
+     */
+    cv::Size getOutputSize(const FrameTransform& transform) const;
+
+    /**
+     * Bytes per output pixel of a format (0 if the format is unknown)
+     */
+    static int bytesPerPixel(OutputFormat format);
+
+    /**
+     * Process a batch of independent frames (offline throughput mode)
+     * Frames are spread across the worker threads, one frame per task, each
+     * thread with its own scratch buffers. All frames use one parameter
+     * snapshot; the quality governor is not involved.
+     * @param yuvFrames frameCount contiguous NV21 frames
+     * @param yuvSize Size of yuvFrames in bytes
+     * @param outputRgba frameCount contiguous RGBA outputs
+     * @param outputSize Size of outputRgba in bytes
+     * @param frameCount Number of frames
+     * @param mode Processing mode
+     * @param frameStatus Optional per-frame result (1 = ok, 0 = failed)
+     * @return Number of frames processed successfully
+     */
+    int processBatch(const uint8_t* yuvFrames, size_t yuvSize,
+                     uint8_t* outputRgba, size_t outputSize,
+                     int frameCount, ProcessingMode mode, uint8_t* frameStatus);
+
     /**
      * Set Canny edge detection thresholds
      * @param low Low threshold (default: 50)
@@ -47,34 +190,369 @@ public:
      */
     void setCannyThresholds(double low, double high);
 
+    /**
+     * Set the Gaussian blur applied before Canny
+     * Ignored while the quality governor is active (it picks the blur).
+     * @param kernelSize Odd kernel size >= 3, or 0 to derive it from sigma (default: 5)
+     * @param sigma Standard deviation (default: 1.5)
+     */
+    void setBlur(int kernelSize, double sigma);
+
+    /**
+     * Pick the engine the blur runs on
+     * BLUR_AUTO (the default) takes fixed-point separable kernels for sizes up
+     * to 9, a box cascade for medium sigma and a recursive filter beyond, so
+     * the cost stays nearly flat as sigma grows.
+     */
+    void setBlurMethod(BlurMethod method);
+
+    /**
+     * Set the threshold of the Sobel, Scharr and LoG modes
+     * Pixels at or above it become edges, like Canny's high threshold (Sobel
+     * L1 magnitude units; the jump across the crossing for LoG). 0 (the
+     * default) draws the edge strength instead of a mask.
+     */
+    void setGradientThreshold(double threshold);
+
+    /**
+     * Extract line segments from the Canny edge map
+     * Canny then runs on Sobel derivatives computed once and shared with the
+     * segment extractor (see line_segments.h). Only MODE_CANNY frames from
+     * processFrame() publish segments; pipeline and batch frames do not.
+     * @param minLength Shortest segment reported, in frame pixels; 0 (the
+     *                  default) turns extraction off
+     */
+    void setLineSegments(int minLength);
+
+    /**
+     * Segments of the last processFrame() call (safe to call from any thread)
+     * Coordinates are output pixels of that frame (after transform and
+     * output size); empty when extraction is off or the mode is not Canny.
+     */
+    std::vector<LineSegment> getLineSegments() const;
+
+    /**
+     * Trace the Canny edge map into simplified polylines
+     * Edge chains are followed at processing resolution and reduced with
+     * Douglas-Peucker (see edge_polylines.h), a few kilobytes per frame
+     * instead of an RGBA image. Like line segments, only MODE_CANNY frames
+     * from processFrame() publish them.
+     * @param tolerance Largest deviation from the edge chain, in frame pixels
+     *                  (default: 1)
+     * @param maxVertices Vertex capacity per frame; chains beyond it are
+     *                    dropped. 0 (the default) turns tracing off
+     */
+    void setPolylines(double tolerance, int maxVertices);
+
+    /**
+     * Polylines of the last processFrame() call (safe to call from any thread)
+     * Coordinates are output pixels of that frame, like getLineSegments().
+     * @param polylines Receives a copy; its capacity is reused
+     */
+    void getPolylines(PolylineSet& polylines) const;
+
+    /**
+     * Detect FAST corners alongside the Canny edges
+     * The detector reads the blurred luma Canny is about to use, so the
+     * keypoints cost only the detector itself (see fast_corners.h). Like
+     * line segments, only MODE_CANNY frames from processFrame() publish them.
+     * @param threshold Contrast against the center, 1..254 (default: 20)
+     * @param arc FAST_9 (default) or FAST_12
+     * @param maxKeypoints Strongest corners kept per frame; 0 (the default)
+     *                     turns detection off
+     */
+    void setKeypoints(int threshold, FastArc arc, int maxKeypoints);
+
+    /**
+     * Keypoints of the last processFrame() call, strongest first (safe to
+     * call from any thread); coordinates like getLineSegments()
+     */
+    std::vector<Keypoint> getKeypoints() const;
+
+    /**
+     * Restrict processing to a region of interest
+     * The rectangle is clamped to the frame and snapped to even coordinates
+     * (NV21 chroma is subsampled 2x2). Blur and Canny read a small halo
+     * around it, so at full processing resolution the blur, gradients and
+     * non-maximum suppression inside the ROI equal a full-frame run. The
+     * mask itself may still differ near edges: hysteresis only follows
+     * weak edges within the halo, so one kept in a full-frame run by a
+     * strong edge farther out is dropped. Downscaled quality levels
+     * resample on a grid anchored at the halo, not the frame, so their
+     * masks can differ along any edge.
+     * @param x Left edge in pixels
+     * @param y Top edge in pixels
+     * @param width ROI width; <= 0 clears the ROI
+     * @param height ROI height; <= 0 clears the ROI
+     */
+    void setRoi(int x, int y, int width, int height);
+
+    /**
+     * Set the ROI and the outside policy in one update
+     */
+    void setRoi(int x, int y, int width, int height, RoiOutsidePolicy policy);
+
+    /**
+     * Process the full frame again
+     */
+    void clearRoi();
+
+    /**
+     * Choose what happens to output pixels outside the ROI
+     * @param policy ROI_OUTSIDE_UNTOUCHED (default) or ROI_OUTSIDE_RAW
+     */
+    void setRoiOutsidePolicy(RoiOutsidePolicy policy);
+
+    /**
+     * Colors Canny frames are drawn in
+     * Edge masks are expanded through a lookup table built from the two
+     * colors; the default white on opaque black uses the plain expansion.
+     * @param edgeArgb Edge color, 0xAARRGGBB (android.graphics.Color)
+     * @param backgroundArgb Background color, 0xAARRGGBB
+     */
+    void setMaskColors(uint32_t edgeArgb, uint32_t backgroundArgb);
+
+    /**
+     * Current runtime parameters (consistent snapshot)
+     */
+    Params getParams() const { return params.load(); }
+
+    /**
+     * Frame dimensions from the last init()
+     */
+    int getWidth() const { return frameWidth; }
+    int getHeight() const { return frameHeight; }
+
+    /**
+     * Configure the worker threads used by all parallel kernels
+     * OpenCV's own parallel loops are routed onto this pool as well. The new
+     * configuration is applied on the processing thread at the start of the
+     * next processFrame() call, so it never races a frame in flight.
+     * @param config Thread count plus optional affinity masks / niceness
+     */
+    void configureThreads(const ThreadPoolConfig& config);
+
+    /**
+     * Set a processing time budget for the adaptive quality governor
+     * When enabled, Canny steps between quality levels (processing scale,
+     * blur kernel, L1/L2 gradient, ROI size) to stay within the budget.
+     * @param targetMs Target frame time in milliseconds; <= 0 disables the governor
+     */
+    void setFrameBudget(double targetMs);
+
+    /**
+     * Get processing statistics (safe to call from any thread)
+     */
+    ProcessorStats getStats() const;
+
+    /**
+     * Give native memory back under memory pressure
+     * Higher levels are more aggressive (see TrimLevel). Everything released
+     * is re-created by the next processFrame(). If a frame is in flight the
+     * trim is applied as soon as it finishes.
+     * @param level Android trim level (ComponentCallbacks2.TRIM_MEMORY_*)
+     */
+    void trimMemory(int level);
+
+    /**
+     * Hand every frame processed by processFrame() to a recorder
+     * The recorder copies frames without blocking and drops them when its
+     * queue is full. Waits for a frame in flight, so after the call the
+     * previous recorder receives no more frames.
+     * Frames are submitted as written: getOutputSize(transform) pixels of
+     * bytesPerPixel(transform.outputFormat) bytes each.
+     * @param frameRecorder Recorder sized for the transform frames are
+     *                      processed with, or nullptr to stop recording
+     */
+    void setRecorder(std::shared_ptr<FrameRecorder> frameRecorder);
+
     /**
      * Release resources
      */
     void release();
 
 private:
-    int frameWidth;
-    int frameHeight;
-    double cannyLowThreshold;
-    double cannyHighThreshold;
+    // Runs the frame steps below as pipeline stages on its own threads
+    friend class FramePipeline;
+
+    // Written by init() under frameMutex; atomic so getters and the pipeline may read them
+    std::atomic<int> frameWidth;
+    std::atomic<int> frameHeight;
+
+    // Runtime parameters shared with the UI thread
+    SeqLock<Params> params;
+
+    // Bytes held by the scratch buffers
+    MemoryTracker memoryTracker;
+
+    /**
+     * Scratch buffers for one frame in flight
+     * Shared by every mode that needs them; RAW and GRAYSCALE need none.
+     */
+    struct Workspace {
+        explicit Workspace(MemoryTracker* tracker);
+
+        ScratchBuffer oriented;  // Rotated / mirrored luma (only with a transform)
+        ScratchBuffer rgba;      // Unscaled RGBA conversion (RAW with an output size)
+        ScratchBuffer smooth;    // Full-range (downscaled, blurred) luma, later the upsampled mask
+        ScratchBuffer blur;      // Blur intermediate (horizontal pass output)
+        ScratchBuffer edges;     // Edge mask at processing resolution
+        ScratchBuffer dx;        // Sobel derivatives (only with line segments)
+        ScratchBuffer dy;
+
+        std::vector<LineSegment> segments;  // Line segments of the last frame
+        PolylineSet polylines;              // Polylines of the last frame
+        PolylineScratch polylineScratch;
+        std::vector<Keypoint> keypoints;    // Corners of the last frame
+
+        void resetHighWater();
+        void shrink();
+        void release();
+    };
+
+    // Index 0 serves processFrame(); batch mode adds one per worker thread
+    std::vector<std::unique_ptr<Workspace>> workspaces;
+
+    std::atomic<bool> initialized;
+
+    // Held while frames are processed; guards the workspaces and thread pool
+    std::mutex frameMutex;
+
+    // Trim requested while a frame was in flight (0 = none)
+    std::atomic<int> pendingTrimLevel;
+
+    // Worker threads; created lazily by processFrame()
+    std::unique_ptr<ThreadPool> threadPool;
+
+    // Receives processed frames (guarded by frameMutex)
+    std::shared_ptr<FrameRecorder> recorder;
+
+    // Line segments, polylines and keypoints published by processFrame()
+    mutable std::mutex geometryMutex;
+    std::vector<LineSegment> lastSegments;
+    PolylineSet lastPolylines;
+    std::vector<Keypoint> lastKeypoints;
+
+    // Configuration handed over from other threads
+    std::mutex threadConfigMutex;
+    ThreadPoolConfig pendingThreadConfig;
+    std::atomic<bool> threadConfigDirty;
+
+    // (Re)create the pool from the pending configuration
+    void applyThreadConfig();
+
+    // Current pool, applying a pending configuration first
+    ThreadPool& acquireThreadPool();
+
+    // Workspace for a thread index, created on demand
+    Workspace& workspaceAt(int index);
+
+    // Apply a trim that arrived while frames were in flight
+    void applyPendingTrim();
 
-    // OpenCV matrices (reused for performance)
-    cv::Mat yuvMat;
-    cv::Mat rgbaMat;
-    cv::Mat grayMat;
-    cv::Mat edgesMat;
-    cv::Mat tempMat;
+    // Release memory for a trim level; frameMutex must be held
+    void applyTrim(int level);
 
-    bool initialized;
+    // Adaptive quality; only touched on the processing thread
+    QualityGovernor governor;
+    std::atomic<double> frameBudgetMs;
+    double appliedFrameBudgetMs;
 
-    // Convert YUV_420_888 to RGBA
-    void yuvToRgba(const uint8_t* yuvData, cv::Mat& output);
+    // Statistics published for other threads
+    std::atomic<uint64_t> statFrames;
+    std::atomic<double> statLastFrameMs;
+    std::atomic<double> statAverageFrameMs;
+    std::atomic<int> statQualityLevel;
+
+    // Update statistics (and optionally the governor) after frames completed
+    void recordFrames(double elapsedMs, int frames, bool feedGovernor);
+
+    // Bytes of one 4:2:0 input frame (the same for every layout)
+    size_t yuvFrameBytes() const;
+
+    // Quality settings for a frame: the governor's level or the plain parameters
+    QualityLevel frameQuality(const Params& frameParams, bool adaptive) const;
+
+    // Output kernels for one input layout and output format (opencv_processor.cpp)
+    struct Kernels;
+
+    /**
+     * YUV frame as seen through a FrameTransform
+     * Output pixel (x, y) reads sensor pixel (x0 + x * xdx + y * xdy,
+     * y0 + x * ydx + y * ydy); steps are -1, 0 or 1. Chroma sample (cx, cy)
+     * is at uData / vData + cy * chromaStride + cx * chromaStep.
+     */
+    struct InputView {
+        cv::Mat yPlane;       // Full sensor luma plane
+        cv::Mat chromaPlane;  // Interleaved chroma plane (NV21 / NV12 only)
+        const uint8_t* uData;
+        const uint8_t* vData;
+        size_t chromaStride;
+        int chromaStep;       // 2 for interleaved chroma, 1 for planar
+        InputLayout layout;
+        const Kernels* kernels;  // Picked for the layout and output format
+        cv::Rect crop;        // Sensor region read (even-aligned)
+        cv::Size size;        // Oriented size (before resampling)
+        cv::Size outputSize;  // Size written to the output buffer
+        bool direct;          // No rotation or mirror: output = crop as is
+        int x0, xdx, xdy;
+        int y0, ydx, ydy;
+    };
+
+    // Wrap a frame's planes and resolve the transform for the current frame size
+    InputView inputView(const uint8_t* yuvData, const FrameTransform& transform) const;
+
+    // Process one frame into the output using the given scratch buffers
+    bool renderFrame(const uint8_t* yuvData, uint8_t* outputRgba, ProcessingMode mode,
+                     const Params& frameParams, const QualityLevel& quality,
+                     Workspace& ws, const FrameTransform& transform);
+
+    // Effective ROI for an output size (even-aligned, never empty)
+    cv::Rect activeRoi(const Params& frameParams, const cv::Size& frame) const;
+
+    // Oriented luma covering region: a view of the Y plane, or a rotated
+    // copy in ws.oriented
+    cv::Mat orientedLuma(const InputView& input, const cv::Rect& region, Workspace& ws);
+
+    // Convert a YUV region straight into the matching output region
+    // (through ws.rgba and a resample when the output is scaled)
+    void convertYuv(const InputView& input, const cv::Rect& region, Workspace& ws,
+                    cv::Mat& output);
+
+    // Fill output pixels outside the ROI with a raw conversion
+    void fillOutsideRoi(const InputView& input, const cv::Rect& roi, Workspace& ws,
+                        cv::Mat& output);
+
+    // Draw the mask background between outer and the inner rectangle within it
+    void clearRoiBand(const InputView& input, const cv::Rect& outer, const cv::Rect& inner,
+                      const Params& frameParams, Workspace& ws, cv::Mat& output);
 
     // Apply grayscale filter
-    void applyGrayscale(const cv::Mat& input, cv::Mat& output);
+    void applyGrayscale(const InputView& input, const cv::Rect& roi, Workspace& ws,
+                        cv::Mat& output);
 
     // Apply Canny edge detection
-    void applyCanny(const cv::Mat& input, cv::Mat& output);
+    void applyCanny(const InputView& input, const cv::Rect& roi, const Params& frameParams,
+                    const QualityLevel& quality, Workspace& ws, cv::Mat& output);
+
+    // Apply a single-pass edge mode (Sobel, Scharr or LoG), drawn like Canny masks
+    void applyGradient(const InputView& input, const cv::Rect& roi, ProcessingMode mode,
+                       const Params& frameParams, const QualityLevel& quality, Workspace& ws,
+                       cv::Mat& output);
+
+    // Canny steps, run back to back by applyCanny() or as FramePipeline stages:
+    // region with filter halo, optional downscale and full-range luma, blur,
+    // edges (+ upscale), output
+    cv::Rect cannyWorkRect(const cv::Rect& roi, const Params& frameParams,
+                           const QualityLevel& quality, const cv::Size& frame) const;
+    cv::Mat cannyPrepare(const cv::Mat& luma, const cv::Rect& work,
+                         const QualityLevel& quality, Workspace& ws);
+    cv::Mat cannySmooth(const cv::Mat& source, const Params& frameParams,
+                        const QualityLevel& quality, Workspace& ws);
+    cv::Mat cannyEdges(const cv::Mat& gray, const cv::Rect& work, const Params& frameParams,
+                       const QualityLevel& quality, Workspace& ws);
+    void cannyExpand(const InputView& input, const cv::Mat& edges, const cv::Rect& roi,
+                     const cv::Rect& work, const Params& frameParams, cv::Mat& output);
 };
 
 #endif // OPENCV_PROCESSOR_H
@@ -0,0 +1,104 @@
+#include "output_buffer_pool.h"
+
+#include <cstdlib>
+
+#define LOG_TAG "OutputBufferPool"
+#include "native_log.h"
+
+namespace {
+
+// Cache-line aligned rows for the vectorized output expansion
+const size_t kAlignment = 64;
+
+} // namespace
+
+void OutputBufferPool::AlignedDeleter::operator()(uint8_t* data) const {
+    std::free(data);
+}
+
+OutputBufferPool::OutputBufferPool()
+        : bytes(0) {
+}
+
+OutputBufferPool::~OutputBufferPool() {
+    if (anyHeld()) {
+        LOGE("Destroying pool with buffers still held");
+    }
+}
+
+bool OutputBufferPool::allocate(int count, size_t bufferBytes) {
+    if (count <= 0 || bufferBytes == 0) {
+        return false;
+    }
+    if (!free()) {
+        return false;
+    }
+
+    std::vector<AlignedBuffer> created;
+    created.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        void* memory = nullptr;
+        if (posix_memalign(&memory, kAlignment, bufferBytes) != 0) {
+            LOGE("Cannot allocate output buffer %d (%zu bytes)", i, bufferBytes);
+            return false;
+        }
+        created.emplace_back(static_cast<uint8_t*>(memory));
+    }
+
+    held.reset(new std::atomic<bool>[count]);
+    for (int i = 0; i < count; ++i) {
+        held[i].store(false, std::memory_order_relaxed);
+    }
+    buffers.swap(created);
+    bytes = bufferBytes;
+
+    LOGI("Output pool: %d x %zu bytes", count, bufferBytes);
+    return true;
+}
+
+bool OutputBufferPool::free() {
+    if (anyHeld()) {
+        LOGE("Cannot free the output pool while buffers are held");
+        return false;
+    }
+    buffers.clear();
+    held.reset();
+    bytes = 0;
+    return true;
+}
+
+int OutputBufferPool::acquire() {
+    for (int i = 0; i < count(); ++i) {
+        bool expected = false;
+        if (!held[i].load(std::memory_order_relaxed) &&
+            held[i].compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool OutputBufferPool::release(int index) {
+    if (index < 0 || index >= count()) {
+        return false;
+    }
+    // Release ordering: the next owner sees everything written to the buffer
+    return held[index].exchange(false, std::memory_order_release);
+}
+
+bool OutputBufferPool::isHeld(int index) const {
+    return index >= 0 && index < count() && held[index].load(std::memory_order_acquire);
+}
+
+uint8_t* OutputBufferPool::data(int index) const {
+    return index >= 0 && index < count() ? buffers[index].get() : nullptr;
+}
+
+bool OutputBufferPool::anyHeld() const {
+    for (int i = 0; i < count(); ++i) {
+        if (held[i].load(std::memory_order_acquire)) {
+            return true;
+        }
+    }
+    return false;
+}
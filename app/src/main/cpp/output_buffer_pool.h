@@ -0,0 +1,80 @@
+#ifndef OUTPUT_BUFFER_POOL_H
+#define OUTPUT_BUFFER_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * Fixed pool of native output buffers shared with the Java side
+ *
+ * The buffers are allocated once and exposed to Java once each (as direct
+ * ByteBuffers wrapping the same memory), so the frame path neither allocates
+ * a Java array nor copies the output: the camera thread acquires a buffer,
+ * the processor renders into it, the GL thread uploads it and releases it.
+ * With three buffers one can be on screen, one waiting for the next draw
+ * and one being filled. acquire() and release() are lock-free and may be
+ * called from any thread; allocate() and free() must only run while no
+ * buffer is held, since they invalidate the memory behind every buffer.
+ */
+class OutputBufferPool {
+public:
+    OutputBufferPool();
+    ~OutputBufferPool();
+
+    OutputBufferPool(const OutputBufferPool&) = delete;
+    OutputBufferPool& operator=(const OutputBufferPool&) = delete;
+
+    /**
+     * (Re)allocate the pool; all buffers start out free
+     * @param count Number of buffers
+     * @param bufferBytes Size of each buffer
+     * @return false if a buffer is still held or allocation failed
+     */
+    bool allocate(int count, size_t bufferBytes);
+
+    /**
+     * Free all buffers
+     * @return false (and nothing freed) if a buffer is still held
+     */
+    bool free();
+
+    /**
+     * Take a free buffer
+     * @return Buffer index, or -1 if all are held
+     */
+    int acquire();
+
+    /**
+     * Return a buffer taken with acquire()
+     * @return false if the index is invalid or the buffer was not held
+     */
+    bool release(int index);
+
+    /**
+     * True if index refers to a buffer currently held
+     */
+    bool isHeld(int index) const;
+
+    uint8_t* data(int index) const;
+
+    int count() const { return static_cast<int>(buffers.size()); }
+
+    size_t bufferSize() const { return bytes; }
+
+private:
+    struct AlignedDeleter {
+        void operator()(uint8_t* data) const;
+    };
+    typedef std::unique_ptr<uint8_t[], AlignedDeleter> AlignedBuffer;
+
+    std::vector<AlignedBuffer> buffers;
+    std::unique_ptr<std::atomic<bool>[]> held;
+    size_t bytes;
+
+    bool anyHeld() const;
+};
+
+#endif // OUTPUT_BUFFER_POOL_H
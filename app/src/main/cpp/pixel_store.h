@@ -0,0 +1,102 @@
+#ifndef PIXEL_STORE_H
+#define PIXEL_STORE_H
+
+#include <cstdint>
+#include <cstring>
+
+#include "gray_expand.h"
+#include "rgb565.h"
+
+/**
+ * Output pixel formats as compile-time store policies
+ *
+ * Output kernels are templates on one of these, so the format is fixed when
+ * a kernel is instantiated and inner loops carry no per-pixel format checks.
+ * Each policy turns a gray value, an RGB triple or an RGBA table entry (see
+ * gray_expand.h) into its Pixel type, and expands rows of plain gray values
+ * with the fastest kernel available for the format.
+ */
+
+/**
+ * 4 bytes per pixel, R, G, B, A memory order
+ */
+struct RgbaStore {
+    typedef uint32_t Pixel;
+    static constexpr bool kColor = true;
+
+    static Pixel gray(int v) { return static_cast<uint32_t>(v) * 0x010101u | 0xFF000000u; }
+    static Pixel rgb(int r, int g, int b) {
+        return static_cast<uint32_t>(r | g << 8 | b << 16) | 0xFF000000u;
+    }
+    static Pixel rgba(uint32_t color) { return color; }
+
+    static void expandRow(const uint8_t* source, uint8_t* destination, int count) {
+        expandGrayRow(source, destination, count, 255);
+    }
+};
+
+/**
+ * 2 bytes per pixel, native-endian 5-6-5 (see rgb565.h)
+ */
+struct Rgb565Store {
+    typedef uint16_t Pixel;
+    static constexpr bool kColor = true;
+
+    static Pixel gray(int v) { return grayToRgb565(v); }
+    static Pixel rgb(int r, int g, int b) { return packRgb565(r, g, b); }
+    static Pixel rgba(uint32_t color) {
+        return packRgb565(color & 0xFF, (color >> 8) & 0xFF, (color >> 16) & 0xFF);
+    }
+
+    static void expandRow(const uint8_t* source, uint8_t* destination, int count) {
+        grayToRgb565Row(source, reinterpret_cast<uint16_t*>(destination), count);
+    }
+};
+
+/**
+ * 1 byte per pixel: luma, or the edge mask itself
+ * Needs no chroma, so YUV kernels skip reading it.
+ */
+struct Gray8Store {
+    typedef uint8_t Pixel;
+    static constexpr bool kColor = false;
+
+    static Pixel gray(int v) { return static_cast<uint8_t>(v); }
+    static Pixel rgb(int r, int g, int b) {
+        // BT.601 luma weights in 8-bit fixed point
+        return static_cast<uint8_t>((77 * r + 150 * g + 29 * b + 128) >> 8);
+    }
+    static Pixel rgba(uint32_t color) {
+        return rgb(color & 0xFF, (color >> 8) & 0xFF, (color >> 16) & 0xFF);
+    }
+
+    static void expandRow(const uint8_t* source, uint8_t* destination, int count) {
+        std::memcpy(destination, source, count);
+    }
+};
+
+/**
+ * Write pixel x of an output row
+ */
+template <typename Store>
+inline void storePixel(uint8_t* row, int x, typename Store::Pixel pixel) {
+    std::memcpy(row + x * sizeof(pixel), &pixel, sizeof(pixel));
+}
+
+/**
+ * Map a row of values through an RGBA color table
+ */
+template <typename Store>
+inline void lutRow(const uint8_t* source, uint8_t* destination, int count, const uint32_t* lut) {
+    for (int x = 0; x < count; ++x) {
+        storePixel<Store>(destination, x, Store::rgba(lut[source[x]]));
+    }
+}
+
+template <>
+inline void lutRow<RgbaStore>(const uint8_t* source, uint8_t* destination, int count,
+                              const uint32_t* lut) {
+    expandLutRow(source, destination, count, lut);
+}
+
+#endif // PIXEL_STORE_H
@@ -0,0 +1,114 @@
+#include "quality_governor.h"
+
+#include <algorithm>
+
+#define LOG_TAG "QualityGovernor"
+#include "native_log.h"
+
+namespace {
+
+// Ordered from best quality to cheapest
+const QualityLevel kLevels[] = {
+        {1.0,  5, 1.5, true,  1.0},
+        {1.0,  5, 1.5, false, 1.0},   // Processor defaults
+        {1.0,  3, 0.8, false, 1.0},
+        {0.75, 3, 0.8, false, 1.0},
+        {0.5,  3, 0.8, false, 1.0},
+        {0.5,  3, 0.8, false, 0.75},
+        {0.5,  3, 0.8, false, 0.5},
+};
+
+const int kLevelCount = sizeof(kLevels) / sizeof(kLevels[0]);
+const int kDefaultLevel = 1;
+
+const double kAverageWeight = 0.2;     // EWMA weight of the newest frame
+const double kUpgradeHeadroom = 0.75;  // Upgrade only below 75% of the budget
+const int kDowngradeFrames = 3;        // Consecutive slow frames before stepping down
+const int kCooldownFrames = 5;         // Frames ignored after a change (EWMA settles)
+const int kBaseUpgradeHold = 30;       // Consecutive fast frames before stepping up
+const int kMaxUpgradeHold = 480;
+const int kRevertWindow = 60;          // Downgrade within this many frames = failed upgrade
+
+} // namespace
+
+QualityGovernor::QualityGovernor()
+        : targetMs(0.0)
+        , averageMs(0.0)
+        , currentLevel(kDefaultLevel)
+        , overBudgetFrames(0)
+        , underBudgetFrames(0)
+        , cooldownFrames(0)
+        , upgradeHoldFrames(kBaseUpgradeHold)
+        , framesSinceUpgrade(kRevertWindow) {
+}
+
+void QualityGovernor::setTarget(double target) {
+    targetMs = target;
+    upgradeHoldFrames = kBaseUpgradeHold;
+    framesSinceUpgrade = kRevertWindow;
+    changeLevel(kDefaultLevel);
+    LOGI("Frame budget: %.2f ms%s", target, enabled() ? "" : " (governor off)");
+}
+
+void QualityGovernor::onFrame(double frameMs) {
+    if (!enabled()) {
+        return;
+    }
+
+    averageMs = averageMs > 0.0 ? averageMs + kAverageWeight * (frameMs - averageMs) : frameMs;
+
+    if (framesSinceUpgrade < kRevertWindow && ++framesSinceUpgrade == kRevertWindow) {
+        // The last upgrade held - become a little more willing to try again
+        upgradeHoldFrames = std::max(kBaseUpgradeHold, upgradeHoldFrames / 2);
+    }
+
+    if (cooldownFrames > 0) {
+        --cooldownFrames;
+        return;
+    }
+
+    if (averageMs > targetMs) {
+        underBudgetFrames = 0;
+        if (++overBudgetFrames >= kDowngradeFrames && currentLevel < kLevelCount - 1) {
+            if (framesSinceUpgrade < kRevertWindow) {
+                upgradeHoldFrames = std::min(kMaxUpgradeHold, upgradeHoldFrames * 2);
+            }
+            changeLevel(currentLevel + 1);
+        }
+    } else if (averageMs < targetMs * kUpgradeHeadroom) {
+        overBudgetFrames = 0;
+        if (++underBudgetFrames >= upgradeHoldFrames && currentLevel > 0) {
+            changeLevel(currentLevel - 1);
+            framesSinceUpgrade = 0;
+        }
+    } else {
+        // Dead band between the two thresholds: hold the level
+        overBudgetFrames = 0;
+        underBudgetFrames = 0;
+    }
+}
+
+const QualityLevel& QualityGovernor::settings() const {
+    return enabled() ? kLevels[currentLevel] : defaults();
+}
+
+int QualityGovernor::levelCount() {
+    return kLevelCount;
+}
+
+const QualityLevel& QualityGovernor::defaults() {
+    return kLevels[kDefaultLevel];
+}
+
+void QualityGovernor::changeLevel(int newLevel) {
+    if (newLevel != currentLevel) {
+        LOGI("Quality level %d -> %d (avg %.2f ms, budget %.2f ms)",
+             currentLevel, newLevel, averageMs, targetMs);
+    }
+
+    currentLevel = newLevel;
+    averageMs = 0.0;
+    overBudgetFrames = 0;
+    underBudgetFrames = 0;
+    cooldownFrames = kCooldownFrames;
+}
@@ -0,0 +1,74 @@
+#ifndef QUALITY_GOVERNOR_H
+#define QUALITY_GOVERNOR_H
+
+/**
+ * Processing quality settings the governor can trade for speed
+ */
+struct QualityLevel {
+    double scale;        // Processing resolution relative to the frame
+    int blurKernel;      // Gaussian kernel size (odd)
+    double blurSigma;    // Gaussian sigma
+    bool l2Gradient;     // Canny L2 (true) or L1 gradient magnitude
+    double roiFraction;  // Fraction of the ROI width/height kept (centered)
+};
+
+/**
+ * Deadline-aware quality governor
+ *
+ * Watches per-frame processing times against a target frame time and moves
+ * between quality levels (0 = best). It steps down quickly when frames run
+ * over budget and up slowly when there is clear headroom. An upgrade that is
+ * reverted soon after doubles the wait before the next upgrade attempt, so
+ * the level settles instead of oscillating at a boundary.
+ */
+class QualityGovernor {
+public:
+    QualityGovernor();
+
+    /**
+     * Set the target frame time
+     * @param targetMs Budget in milliseconds; <= 0 disables the governor
+     */
+    void setTarget(double targetMs);
+
+    bool enabled() const { return targetMs > 0.0; }
+
+    /**
+     * Feed the processing time of the frame just finished
+     */
+    void onFrame(double frameMs);
+
+    /**
+     * Current level index (0 = best quality)
+     */
+    int level() const { return currentLevel; }
+
+    /**
+     * Settings for the current level
+     */
+    const QualityLevel& settings() const;
+
+    /**
+     * Number of levels in the table
+     */
+    static int levelCount();
+
+    /**
+     * Settings used when the governor is disabled (the processor defaults)
+     */
+    static const QualityLevel& defaults();
+
+private:
+    double targetMs;
+    double averageMs;
+    int currentLevel;
+    int overBudgetFrames;
+    int underBudgetFrames;
+    int cooldownFrames;
+    int upgradeHoldFrames;
+    int framesSinceUpgrade;
+
+    void changeLevel(int newLevel);
+};
+
+#endif // QUALITY_GOVERNOR_H
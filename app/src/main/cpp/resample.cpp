@@ -0,0 +1,210 @@
+#include "resample.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "pixel_store.h"
+#include "thread_pool.h"
+
+namespace {
+
+// Weight precision per pass: 255 * 2^11 * 2^11 still fits an int32 accumulator
+const int kWeightBits = 11;
+const int kWeightOne = 1 << kWeightBits;
+const int kOutputShift = 2 * kWeightBits;
+const int kOutputRound = 1 << (kOutputShift - 1);
+
+// Output rows per task
+const int kRowGrain = 16;
+
+/**
+ * Taps of a 1-D resampling: output i reads source[start[i] .. + taps)
+ */
+struct Taps {
+    int taps;
+    std::vector<int> start;
+    std::vector<int32_t> weights;  // taps per output, summing to kWeightOne
+};
+
+Taps buildTaps(int sourceLength, int targetLength) {
+    Taps result;
+    double scale = static_cast<double>(sourceLength) / targetLength;
+    result.taps = scale > 1.0 ? static_cast<int>(std::ceil(scale)) + 1 : 2;
+    result.taps = std::min(result.taps, sourceLength);
+    result.start.resize(targetLength);
+    result.weights.assign(static_cast<size_t>(targetLength) * result.taps, 0);
+
+    std::vector<double> weights(result.taps);
+    for (int i = 0; i < targetLength; ++i) {
+        std::fill(weights.begin(), weights.end(), 0.0);
+        int first;
+
+        if (scale > 1.0) {
+            // Area: coverage of [i * scale, (i + 1) * scale) by each source pixel
+            double begin = i * scale;
+            double end = std::min((i + 1) * scale, static_cast<double>(sourceLength));
+            first = std::min(static_cast<int>(begin), sourceLength - result.taps);
+            for (int k = 0; k < result.taps; ++k) {
+                double overlap = std::min(end, first + k + 1.0) - std::max(begin, first + k + 0.0);
+                weights[k] = std::max(overlap, 0.0) / scale;
+            }
+        } else {
+            // Bilinear between the two nearest source pixels (centers aligned)
+            double center = std::max((i + 0.5) * scale - 0.5, 0.0);
+            int left = std::min(static_cast<int>(center), sourceLength - 1);
+            double t = std::min(center - left, 1.0);
+            first = std::min(left, sourceLength - result.taps);
+            weights[left - first] += 1.0 - t;
+            if (left + 1 < sourceLength) {
+                weights[left + 1 - first] += t;
+            } else {
+                weights[left - first] += t;
+            }
+        }
+
+        // Fixed point; the largest tap absorbs the rounding so weights sum to one
+        int32_t* out = &result.weights[static_cast<size_t>(i) * result.taps];
+        int sum = 0;
+        int largest = 0;
+        for (int k = 0; k < result.taps; ++k) {
+            out[k] = static_cast<int32_t>(std::lround(weights[k] * kWeightOne));
+            sum += out[k];
+            if (out[k] > out[largest]) {
+                largest = k;
+            }
+        }
+        out[largest] += kWeightOne - sum;
+        result.start[i] = first;
+    }
+    return result;
+}
+
+/**
+ * Horizontal pass of one source row into row (channels values per output pixel)
+ */
+template <int Channels>
+void filterRow(const uint8_t* source, const Taps& taps, int32_t* row) {
+    int width = static_cast<int>(taps.start.size());
+    for (int x = 0; x < width; ++x) {
+        const uint8_t* s = source + taps.start[x] * Channels;
+        const int32_t* w = &taps.weights[static_cast<size_t>(x) * taps.taps];
+        for (int c = 0; c < Channels; ++c) {
+            int32_t sum = 0;
+            for (int k = 0; k < taps.taps; ++k) {
+                sum += s[k * Channels + c] * w[k];
+            }
+            row[x * Channels + c] = sum;
+        }
+    }
+}
+
+/**
+ * How filtered values become output pixels
+ */
+struct GrayValues {
+    static constexpr int kChannels = 1;
+
+    template <typename Store>
+    static typename Store::Pixel pixel(const int32_t* acc, int x, const uint32_t* /* lut */) {
+        return Store::gray((acc[x] + kOutputRound) >> kOutputShift);
+    }
+};
+
+struct LutValues {
+    static constexpr int kChannels = 1;
+
+    template <typename Store>
+    static typename Store::Pixel pixel(const int32_t* acc, int x, const uint32_t* lut) {
+        return Store::rgba(lut[(acc[x] + kOutputRound) >> kOutputShift]);
+    }
+};
+
+struct RgbaValues {
+    static constexpr int kChannels = 4;
+
+    template <typename Store>
+    static typename Store::Pixel pixel(const int32_t* acc, int x, const uint32_t* /* lut */) {
+        return Store::rgb((acc[x * 4] + kOutputRound) >> kOutputShift,
+                          (acc[x * 4 + 1] + kOutputRound) >> kOutputShift,
+                          (acc[x * 4 + 2] + kOutputRound) >> kOutputShift);
+    }
+};
+
+template <typename Values, typename Store>
+void resample(const cv::Mat& source, cv::Mat& destination, const uint32_t* lut) {
+    constexpr int kChannels = Values::kChannels;
+    Taps horizontal = buildTaps(source.cols, destination.cols);
+    Taps vertical = buildTaps(source.rows, destination.rows);
+    int width = destination.cols;
+    int values = width * kChannels;
+
+    auto body = [&](int begin, int end) {
+        std::vector<int32_t> row(values);
+        std::vector<int32_t> accumulator(values);
+
+        for (int y = begin; y < end; ++y) {
+            std::fill(accumulator.begin(), accumulator.end(), 0);
+            const int32_t* wy = &vertical.weights[static_cast<size_t>(y) * vertical.taps];
+            for (int k = 0; k < vertical.taps; ++k) {
+                if (wy[k] == 0) {
+                    continue;
+                }
+                filterRow<kChannels>(source.ptr<uint8_t>(vertical.start[y] + k), horizontal,
+                                     row.data());
+                int32_t weight = wy[k];
+                for (int i = 0; i < values; ++i) {
+                    accumulator[i] += row[i] * weight;
+                }
+            }
+
+            // Expansion / packing to the output format happens in the store
+            uint8_t* out = destination.ptr<uint8_t>(y);
+            for (int x = 0; x < width; ++x) {
+                storePixel<Store>(out, x,
+                                  Values::template pixel<Store>(accumulator.data(), x, lut));
+            }
+        }
+    };
+
+    ThreadPool* pool = ThreadPool::current();
+    if (pool) {
+        pool->parallelFor(0, destination.rows, kRowGrain, body);
+    } else {
+        body(0, destination.rows);
+    }
+}
+
+// Instantiation for the destination's format, picked once per call
+template <typename Values>
+void resampleTo(const cv::Mat& source, cv::Mat& destination, const uint32_t* lut) {
+    if (source.empty() || destination.empty()) {
+        return;
+    }
+    int type = destination.type();
+    if (type == CV_8UC4) {
+        resample<Values, RgbaStore>(source, destination, lut);
+    } else if (type == CV_8UC2) {
+        resample<Values, Rgb565Store>(source, destination, lut);
+    } else {
+        CV_Assert(type == CV_8UC1);
+        resample<Values, Gray8Store>(source, destination, lut);
+    }
+}
+
+} // namespace
+
+void resampleGray(const cv::Mat& source, cv::Mat& destination, const uint32_t* lut) {
+    CV_Assert(source.type() == CV_8UC1);
+    if (lut) {
+        resampleTo<LutValues>(source, destination, lut);
+    } else {
+        resampleTo<GrayValues>(source, destination, nullptr);
+    }
+}
+
+void resampleRgba(const cv::Mat& source, cv::Mat& destination) {
+    CV_Assert(source.type() == CV_8UC4);
+    resampleTo<RgbaValues>(source, destination, nullptr);
+}
@@ -0,0 +1,34 @@
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include <opencv2/opencv.hpp>
+
+/**
+ * Output-stage resampling fused with the output format conversion
+ *
+ * Separable fixed-point filter: area averaging when shrinking (thin edge
+ * lines fade instead of disappearing), bilinear when enlarging. Tap tables
+ * are built once per call; the inner loops are plain multiply-adds over
+ * contiguous rows so the compiler vectorizes them (NEON / SSE). Output rows
+ * are spread over the thread pool bound to the calling thread, if any.
+ * The destination's type selects the output format (see pixel_store.h):
+ * CV_8UC4 RGBA, CV_8UC2 RGB565 or CV_8UC1 gray.
+ */
+
+/**
+ * Resample an 8-bit plane into an output image of a different size, writing
+ * R = G = B = value (and A = 255), or lut[value]
+ * @param source CV_8UC1 image (may be a view)
+ * @param destination Target-size view in the output format
+ * @param lut Optional color table (see gray_expand.h)
+ */
+void resampleGray(const cv::Mat& source, cv::Mat& destination, const uint32_t* lut = nullptr);
+
+/**
+ * Resample an RGBA image into an output image of a different size
+ * @param source CV_8UC4 image (may be a view), opaque
+ * @param destination Target-size view in the output format
+ */
+void resampleRgba(const cv::Mat& source, cv::Mat& destination);
+
+#endif // RESAMPLE_H
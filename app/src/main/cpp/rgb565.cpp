@@ -0,0 +1,216 @@
+#include "rgb565.h"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// BT.601 video range in 20-bit fixed point, as in OpenCVProcessor's yuvPixel()
+const int kYuvShift = 20;
+const int kYuvRound = 1 << (kYuvShift - 1);
+const int kYuvCY = 1220542;    //  1.164
+const int kYuvCVR = 1673527;   //  1.596
+const int kYuvCVG = -852492;   // -0.813
+const int kYuvCUG = -409993;   // -0.391
+const int kYuvCUB = 2116026;   //  2.018
+
+inline int clampByte(int value) {
+    return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+inline uint16_t yuvToRgb565(int y, int u, int v) {
+    int luma = (y > 16 ? y - 16 : 0) * kYuvCY + kYuvRound;
+    u -= 128;
+    v -= 128;
+    return packRgb565(clampByte((luma + kYuvCVR * v) >> kYuvShift),
+                      clampByte((luma + kYuvCVG * v + kYuvCUG * u) >> kYuvShift),
+                      clampByte((luma + kYuvCUB * u) >> kYuvShift));
+}
+
+#if defined(__ARM_NEON)
+// One channel of 4 pixels, exactly like the scalar code
+inline uint16x4_t yuvChannel(int32x4_t luma, int16x4_t u, int cu, int16x4_t v, int cv) {
+    int32x4_t sum = vmlaq_n_s32(vmlaq_n_s32(luma, vmovl_s16(u), cu), vmovl_s16(v), cv);
+    return vqmovun_s32(vshrq_n_s32(sum, kYuvShift));
+}
+
+// 8 pixels: luma, and U / V already centered and repeated per pixel
+inline uint16x8_t yuvToRgb565x8(uint16x8_t y, int16x8_t u, int16x8_t v) {
+    const int32x4_t round = vdupq_n_s32(kYuvRound);
+    int32x4_t lumaLo = vmlaq_n_s32(round, vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(y))),
+                                   kYuvCY);
+    int32x4_t lumaHi = vmlaq_n_s32(round, vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(y))),
+                                   kYuvCY);
+    int16x4_t uLo = vget_low_s16(u);
+    int16x4_t uHi = vget_high_s16(u);
+    int16x4_t vLo = vget_low_s16(v);
+    int16x4_t vHi = vget_high_s16(v);
+
+    uint8x8_t r = vqmovn_u16(vcombine_u16(yuvChannel(lumaLo, uLo, 0, vLo, kYuvCVR),
+                                          yuvChannel(lumaHi, uHi, 0, vHi, kYuvCVR)));
+    uint8x8_t g = vqmovn_u16(vcombine_u16(yuvChannel(lumaLo, uLo, kYuvCUG, vLo, kYuvCVG),
+                                          yuvChannel(lumaHi, uHi, kYuvCUG, vHi, kYuvCVG)));
+    uint8x8_t b = vqmovn_u16(vcombine_u16(yuvChannel(lumaLo, uLo, kYuvCUB, vLo, 0),
+                                          yuvChannel(lumaHi, uHi, kYuvCUB, vHi, 0)));
+
+    // Same insert trick as the gray packer
+    uint16x8_t packed = vsriq_n_u16(vshll_n_u8(r, 8), vshll_n_u8(g, 8), 5);
+    return vsriq_n_u16(packed, vshll_n_u8(b, 8), 11);
+}
+#elif defined(__SSE2__)
+// Coefficients in 14-bit fixed point for _mm_mulhi_epi16 on values shifted
+// up by 8, which leaves products in 6-bit fixed point. 2.018 does not fit
+// and is split into 2 (a shift) and the remainder.
+const int kYuvCY14 = 19071;
+const int kYuvCVR14 = 26149;
+const int kYuvCVG14 = -13320;
+const int kYuvCUG14 = -6406;
+const int kYuvCUB14 = 295;
+
+// 8 pixels: luma, and U / V already centered and repeated per pixel
+inline __m128i yuvToRgb565x8(__m128i y, __m128i u, __m128i v) {
+    __m128i luma = _mm_mulhi_epu16(_mm_slli_epi16(y, 8), _mm_set1_epi16(kYuvCY14));
+    __m128i uHigh = _mm_slli_epi16(u, 8);
+    __m128i vHigh = _mm_slli_epi16(v, 8);
+
+    // Saturating sums only clip values far above 255
+    __m128i r = _mm_adds_epi16(luma, _mm_mulhi_epi16(vHigh, _mm_set1_epi16(kYuvCVR14)));
+    __m128i g = _mm_adds_epi16(luma,
+                               _mm_adds_epi16(_mm_mulhi_epi16(vHigh, _mm_set1_epi16(kYuvCVG14)),
+                                              _mm_mulhi_epi16(uHigh, _mm_set1_epi16(kYuvCUG14))));
+    __m128i b = _mm_adds_epi16(_mm_adds_epi16(luma, _mm_slli_epi16(u, 7)),
+                               _mm_mulhi_epi16(uHigh, _mm_set1_epi16(kYuvCUB14)));
+
+    const __m128i round = _mm_set1_epi16(32);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i max = _mm_set1_epi16(255);
+    r = _mm_min_epi16(_mm_max_epi16(_mm_srai_epi16(_mm_adds_epi16(r, round), 6), zero), max);
+    g = _mm_min_epi16(_mm_max_epi16(_mm_srai_epi16(_mm_adds_epi16(g, round), 6), zero), max);
+    b = _mm_min_epi16(_mm_max_epi16(_mm_srai_epi16(_mm_adds_epi16(b, round), 6), zero), max);
+
+    __m128i red = _mm_and_si128(_mm_slli_epi16(r, 8), _mm_set1_epi16(static_cast<short>(0xF800)));
+    __m128i green = _mm_and_si128(_mm_slli_epi16(g, 3), _mm_set1_epi16(0x07E0));
+    return _mm_or_si128(_mm_or_si128(red, green), _mm_srli_epi16(b, 3));
+}
+#endif
+
+} // namespace
+
+void grayToRgb565Row(const uint8_t* source, uint16_t* destination, int count) {
+    int i = 0;
+
+#if defined(__ARM_NEON)
+    // Shift each value into the top byte, then insert it below itself twice:
+    // the top 5, 6 and 5 bits end up as red, green and blue
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t v = vld1q_u8(source + i);
+        uint16x8_t lo = vshll_n_u8(vget_low_u8(v), 8);
+        uint16x8_t hi = vshll_n_u8(vget_high_u8(v), 8);
+        uint16x8_t packedLo = vsriq_n_u16(vsriq_n_u16(lo, lo, 5), lo, 11);
+        uint16x8_t packedHi = vsriq_n_u16(vsriq_n_u16(hi, hi, 5), hi, 11);
+        vst1q_u16(destination + i, packedLo);
+        vst1q_u16(destination + i + 8, packedHi);
+    }
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i redMask = _mm_set1_epi16(static_cast<short>(0xF800));
+    const __m128i greenMask = _mm_set1_epi16(0x07E0);
+    for (; i + 16 <= count; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        __m128i halves[] = {_mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero)};
+        for (int h = 0; h < 2; ++h) {
+            __m128i x = halves[h];
+            __m128i red = _mm_and_si128(_mm_slli_epi16(x, 8), redMask);
+            __m128i green = _mm_and_si128(_mm_slli_epi16(x, 3), greenMask);
+            __m128i blue = _mm_srli_epi16(x, 3);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i + h * 8),
+                             _mm_or_si128(_mm_or_si128(red, green), blue));
+        }
+    }
+#endif
+
+    for (; i < count; ++i) {
+        destination[i] = grayToRgb565(source[i]);
+    }
+}
+
+void yuvToRgb565Row(const uint8_t* y, const uint8_t* u, const uint8_t* v, int chromaStep,
+                    uint16_t* destination, int count) {
+    int i = 0;
+
+#if defined(__ARM_NEON) || defined(__SSE2__)
+    // 16 pixels share 8 chroma pairs; interleaved pairs are loaded together
+    // from whichever of U and V comes first
+    const uint8_t* pairs = u < v ? u : v;
+    bool uFirst = u < v;
+#endif
+
+#if defined(__ARM_NEON)
+    const uint8x16_t lumaOffset = vdupq_n_u8(16);
+    const uint8x8_t chromaOffset = vdup_n_u8(128);
+    for (; i + 16 <= count; i += 16) {
+        uint8x8_t u8;
+        uint8x8_t v8;
+        if (chromaStep == 2) {
+            uint8x8x2_t c = vld2_u8(pairs + i);
+            u8 = uFirst ? c.val[0] : c.val[1];
+            v8 = uFirst ? c.val[1] : c.val[0];
+        } else {
+            u8 = vld1_u8(u + i / 2);
+            v8 = vld1_u8(v + i / 2);
+        }
+        int16x8_t uc = vreinterpretq_s16_u16(vsubl_u8(u8, chromaOffset));
+        int16x8_t vc = vreinterpretq_s16_u16(vsubl_u8(v8, chromaOffset));
+        int16x8x2_t uz = vzipq_s16(uc, uc);
+        int16x8x2_t vz = vzipq_s16(vc, vc);
+
+        uint8x16_t luma = vqsubq_u8(vld1q_u8(y + i), lumaOffset);
+        vst1q_u16(destination + i, yuvToRgb565x8(vmovl_u8(vget_low_u8(luma)), uz.val[0],
+                                                 vz.val[0]));
+        vst1q_u16(destination + i + 8, yuvToRgb565x8(vmovl_u8(vget_high_u8(luma)), uz.val[1],
+                                                     vz.val[1]));
+    }
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lumaOffset = _mm_set1_epi8(16);
+    const __m128i chromaOffset = _mm_set1_epi16(128);
+    const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+    for (; i + 16 <= count; i += 16) {
+        __m128i u16;
+        __m128i v16;
+        if (chromaStep == 2) {
+            __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pairs + i));
+            __m128i first = _mm_and_si128(c, lowBytes);
+            __m128i second = _mm_srli_epi16(c, 8);
+            u16 = uFirst ? first : second;
+            v16 = uFirst ? second : first;
+        } else {
+            u16 = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(u + i / 2)),
+                                    zero);
+            v16 = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(v + i / 2)),
+                                    zero);
+        }
+        u16 = _mm_sub_epi16(u16, chromaOffset);
+        v16 = _mm_sub_epi16(v16, chromaOffset);
+
+        __m128i luma = _mm_subs_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y + i)),
+                                     lumaOffset);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i),
+                         yuvToRgb565x8(_mm_unpacklo_epi8(luma, zero),
+                                       _mm_unpacklo_epi16(u16, u16),
+                                       _mm_unpacklo_epi16(v16, v16)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i + 8),
+                         yuvToRgb565x8(_mm_unpackhi_epi8(luma, zero),
+                                       _mm_unpackhi_epi16(u16, u16),
+                                       _mm_unpackhi_epi16(v16, v16)));
+    }
+#endif
+
+    for (; i < count; ++i) {
+        int c = (i >> 1) * chromaStep;
+        destination[i] = yuvToRgb565(y[i], u[c], v[c]);
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef RGB565_H
+#define RGB565_H
+
+#include <cstdint>
+
+/**
+ * 16-bit RGB565 output packing
+ *
+ * Pixels are native-endian uint16 with red in the top five bits, the layout
+ * GL_UNSIGNED_SHORT_5_6_5 and Bitmap.Config.RGB_565 expect. Channels are
+ * truncated, like OpenCV's RGB -> BGR565 conversion.
+ */
+
+inline uint16_t packRgb565(int r, int g, int b) {
+    return static_cast<uint16_t>(((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3));
+}
+
+inline uint16_t grayToRgb565(int value) {
+    return packRgb565(value, value, value);
+}
+
+/**
+ * Pack a row of 8-bit gray values (NEON / SSE2 with a scalar tail)
+ */
+void grayToRgb565Row(const uint8_t* source, uint16_t* destination, int count);
+
+/**
+ * Convert and pack a row of 4:2:0 YUV (NEON / SSE2 with a scalar tail)
+ * BT.601 video range like the processor's scalar conversion. NEON and the
+ * tail compute it exactly; SSE2 lacks 32-bit multiplies and works with
+ * 16-bit products, which can move a channel by one 8-bit step.
+ * @param y Luma of the first pixel, which must be in an even column
+ * @param u U sample of the first pixel
+ * @param v V sample of the first pixel
+ * @param chromaStep 2 for interleaved NV21 / NV12 chroma, 1 for planar I420
+ * @param destination Output pixels
+ * @param count Pixels in the row
+ */
+void yuvToRgb565Row(const uint8_t* y, const uint8_t* u, const uint8_t* v, int chromaStep,
+                    uint16_t* destination, int count);
+
+#endif // RGB565_H
@@ -0,0 +1,61 @@
+#include "scratch_buffer.h"
+
+#include <algorithm>
+
+void MemoryTracker::allocated(size_t bytes) {
+    size_t now = currentBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    size_t peak = peakBytes.load(std::memory_order_relaxed);
+    while (now > peak && !peakBytes.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {
+    }
+}
+
+void MemoryTracker::freed(size_t bytes) {
+    currentBytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+ScratchBuffer::ScratchBuffer(MemoryTracker* tracker)
+        : highWaterBytes(0)
+        , tracker(tracker) {
+}
+
+ScratchBuffer::~ScratchBuffer() {
+    release();
+}
+
+cv::Mat ScratchBuffer::get(int rows, int cols, int type) {
+    size_t bytes = static_cast<size_t>(rows) * cols * CV_ELEM_SIZE(type);
+    highWaterBytes = std::max(highWaterBytes, bytes);
+
+    if (capacity() < bytes) {
+        reallocate(bytes);
+    }
+
+    return cv::Mat(rows, cols, type, storage.data);
+}
+
+void ScratchBuffer::shrink() {
+    if (capacity() > highWaterBytes) {
+        reallocate(highWaterBytes);
+    }
+    highWaterBytes = 0;
+}
+
+void ScratchBuffer::release() {
+    reallocate(0);
+    highWaterBytes = 0;
+}
+
+void ScratchBuffer::reallocate(size_t bytes) {
+    // Drop the old block first so resizing never holds both
+    if (tracker) {
+        tracker->freed(capacity());
+    }
+    storage.release();
+
+    if (bytes > 0) {
+        storage.create(1, static_cast<int>(bytes), CV_8UC1);
+        if (tracker) {
+            tracker->allocated(bytes);
+        }
+    }
+}
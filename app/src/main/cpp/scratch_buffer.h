@@ -0,0 +1,77 @@
+#ifndef SCRATCH_BUFFER_H
+#define SCRATCH_BUFFER_H
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+
+/**
+ * Current / peak byte counters shared by a group of buffers
+ */
+class MemoryTracker {
+public:
+    MemoryTracker() : currentBytes(0), peakBytes(0) {}
+
+    void allocated(size_t bytes);
+    void freed(size_t bytes);
+
+    size_t current() const { return currentBytes.load(std::memory_order_relaxed); }
+    size_t peak() const { return peakBytes.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<size_t> currentBytes;
+    std::atomic<size_t> peakBytes;
+};
+
+/**
+ * Lazily allocated scratch storage with capacity semantics
+ *
+ * Nothing is allocated until the first get(). The backing storage only grows:
+ * a request that fits the current capacity (e.g. after switching to a smaller
+ * resolution or ROI) reuses it without touching the allocator. shrink() and
+ * release() give memory back; the next get() re-allocates transparently.
+ */
+class ScratchBuffer {
+public:
+    explicit ScratchBuffer(MemoryTracker* tracker = nullptr);
+    ~ScratchBuffer();
+
+    ScratchBuffer(const ScratchBuffer&) = delete;
+    ScratchBuffer& operator=(const ScratchBuffer&) = delete;
+
+    /**
+     * Get a continuous rows x cols matrix of the given type
+     * The view stays valid until the next get() that needs to grow, shrink()
+     * or release().
+     */
+    cv::Mat get(int rows, int cols, int type);
+
+    /**
+     * Bytes currently held
+     */
+    size_t capacity() const { return storage.total(); }
+
+    /**
+     * Drop spare capacity beyond the largest request since the last shrink
+     * or resetHighWater()
+     */
+    void shrink();
+
+    /**
+     * Forget earlier request sizes, e.g. after the frame size changed
+     */
+    void resetHighWater() { highWaterBytes = 0; }
+
+    /**
+     * Free the backing storage
+     */
+    void release();
+
+private:
+    cv::Mat storage;        // 1 x capacity CV_8UC1
+    size_t highWaterBytes;  // Largest request since the last shrink()
+    MemoryTracker* tracker;
+
+    void reallocate(size_t bytes);
+};
+
+#endif // SCRATCH_BUFFER_H
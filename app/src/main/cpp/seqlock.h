@@ -0,0 +1,111 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/**
+ * Sequence lock publishing a small trivially copyable value
+ *
+ * Readers never block and never write shared memory: they copy the value
+ * and retry only if a writer was active during the copy, so every load()
+ * returns one consistent snapshot. Writers mark the sequence odd, store the
+ * words and mark it even again; concurrent writers serialize on the
+ * sequence itself. The payload is kept in atomic words so the racing copy
+ * is well defined.
+ */
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "SeqLock payload must be trivially copyable");
+
+public:
+    explicit SeqLock(const T& value)
+            : sequence(0) {
+        storeWords(value);
+    }
+
+    /**
+     * Consistent copy of the current value
+     */
+    T load() const {
+        uint64_t buffer[kWords];
+        for (;;) {
+            uint32_t before = sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                continue;  // Write in progress
+            }
+
+            for (size_t i = 0; i < kWords; ++i) {
+                buffer[i] = words[i].load(std::memory_order_relaxed);
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before) {
+                break;
+            }
+        }
+
+        T value;
+        std::memcpy(&value, buffer, sizeof(T));
+        return value;
+    }
+
+    /**
+     * Replace the value
+     */
+    void store(const T& value) {
+        update([&value](T& current) { current = value; });
+    }
+
+    /**
+     * Read-modify-write; modify(T&) runs while other writers are held off,
+     * so partial updates never lose a concurrent one
+     */
+    template <typename Modify>
+    void update(Modify modify) {
+        uint32_t seq = sequence.load(std::memory_order_relaxed);
+        for (;;) {
+            if (seq & 1) {
+                seq = sequence.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (sequence.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire,
+                                               std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+
+        // Only one writer gets here at a time, so the words are stable
+        uint64_t buffer[kWords];
+        for (size_t i = 0; i < kWords; ++i) {
+            buffer[i] = words[i].load(std::memory_order_relaxed);
+        }
+        T value;
+        std::memcpy(&value, buffer, sizeof(T));
+
+        modify(value);
+        storeWords(value);
+
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+private:
+    static const size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint64_t> words[kWords];
+
+    void storeWords(const T& value) {
+        uint64_t buffer[kWords] = {};
+        std::memcpy(buffer, &value, sizeof(T));
+        for (size_t i = 0; i < kWords; ++i) {
+            words[i].store(buffer[i], std::memory_order_relaxed);
+        }
+    }
+};
+
+#endif // SEQLOCK_H
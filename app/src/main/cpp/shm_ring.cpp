@@ -0,0 +1,360 @@
+#include "shm_ring.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define LOG_TAG "ShmRing"
+#include "native_log.h"
+
+namespace {
+
+const uint32_t kMagic = 0x52474445;  // "EDGR"
+const uint32_t kVersion = 1;
+const size_t kPageBytes = 4096;
+const int kMaxSlots = 64;
+
+// Slot sequence while the writer renders into it (never a frame number)
+const uint64_t kWriting = ~0ull;
+
+size_t roundUp(size_t value, size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+uint64_t monotonicNs() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ull + now.tv_nsec;
+}
+
+// Shared (not process-private) futex operations on a word in the mapping
+int futexWait(std::atomic<uint32_t>* word, uint32_t expected, const timespec* timeout) {
+    return static_cast<int>(syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT,
+                                    expected, timeout, nullptr, 0));
+}
+
+void futexWakeAll(std::atomic<uint32_t>* word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+} // namespace
+
+/**
+ * Slot descriptor, one cache line each so readers pinning different slots
+ * do not contend
+ */
+struct alignas(64) ShmSlot {
+    std::atomic<uint64_t> sequence;   // Frame number held, kWriting, or 0 (empty)
+    std::atomic<uint32_t> readers;    // Readers pinning the slot
+    uint32_t mode;
+    uint64_t timestampNs;
+};
+
+/**
+ * Start of the shared mapping; frame slots follow at dataOffset
+ */
+struct ShmRingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t width;
+    uint32_t height;
+    uint32_t reserved;
+    uint64_t slotBytes;    // Bytes between slots (page multiple)
+    uint64_t dataOffset;
+
+    // Written by the writer, read by every reader
+    alignas(64) std::atomic<uint64_t> latest;      // (frame number << 8) | slot, 0 = none
+    std::atomic<uint32_t> published;               // Futex word: bumped on every commit
+    std::atomic<uint32_t> waiters;                 // Readers sleeping on 'published'
+
+    ShmSlot slots[kMaxSlots];
+
+    uint8_t* slotData(int slot) {
+        return reinterpret_cast<uint8_t*>(this) + dataOffset + slotBytes * slot;
+    }
+};
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "shared-memory atomics must be lock-free");
+
+// ---------------------------------------------------------------------------
+// ShmFrameWriter
+// ---------------------------------------------------------------------------
+
+ShmFrameWriter::ShmFrameWriter()
+        : header(nullptr)
+        , mappingBytes(0)
+        , slotBytes(0)
+        , writeSlot(-1)
+        , latestSlot(-1)
+        , frameNumber(0)
+        , dropped(0) {
+}
+
+ShmFrameWriter::~ShmFrameWriter() {
+    close();
+}
+
+bool ShmFrameWriter::create(const std::string& ringName, int width, int height, int slotCount) {
+    close();
+    if (width <= 0 || height <= 0 || slotCount < 2 || slotCount > kMaxSlots) {
+        LOGE("Invalid ring %dx%d with %d slots", width, height, slotCount);
+        return false;
+    }
+
+    // Start from a fresh object so stale pins from a previous run vanish
+    shm_unlink(ringName.c_str());
+    int fd = shm_open(ringName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        LOGE("shm_open %s failed: %s", ringName.c_str(), strerror(errno));
+        return false;
+    }
+
+    size_t frameBytes = static_cast<size_t>(width) * height * 4;
+    size_t dataOffset = roundUp(sizeof(ShmRingHeader), kPageBytes);
+    size_t stride = roundUp(frameBytes, kPageBytes);
+    size_t total = dataOffset + stride * slotCount;
+
+    void* addr = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(total)) == 0) {
+        addr = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    }
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        LOGE("Mapping %s (%zu bytes) failed: %s", ringName.c_str(), total, strerror(errno));
+        shm_unlink(ringName.c_str());
+        return false;
+    }
+
+    // ftruncate zero-fills the object, so every atomic starts at 0
+    header = static_cast<ShmRingHeader*>(addr);
+    header->version = kVersion;
+    header->slotCount = static_cast<uint32_t>(slotCount);
+    header->width = static_cast<uint32_t>(width);
+    header->height = static_cast<uint32_t>(height);
+    header->slotBytes = stride;
+    header->dataOffset = dataOffset;
+
+    // Readers check the magic last
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = kMagic;
+
+    name = ringName;
+    mappingBytes = total;
+    slotBytes = frameBytes;
+    writeSlot = -1;
+    latestSlot = -1;
+    frameNumber = 0;
+    dropped = 0;
+
+    LOGI("Shared ring %s: %dx%d, %d slots, %zu bytes", ringName.c_str(), width, height,
+         slotCount, total);
+    return true;
+}
+
+void ShmFrameWriter::close() {
+    if (!header) {
+        return;
+    }
+    munmap(header, mappingBytes);
+    shm_unlink(name.c_str());
+    header = nullptr;
+    mappingBytes = 0;
+}
+
+uint8_t* ShmFrameWriter::acquire() {
+    if (!header) {
+        return nullptr;
+    }
+    if (writeSlot >= 0) {
+        return header->slotData(writeSlot);
+    }
+
+    int slotCount = static_cast<int>(header->slotCount);
+    for (int i = 1; i <= slotCount; ++i) {
+        int slot = (latestSlot + i + slotCount) % slotCount;
+        if (slot == latestSlot) {
+            continue;
+        }
+
+        // Mark, then look for readers: a reader pins, then re-checks the
+        // sequence, so with both sides seq_cst one of them sees the other
+        ShmSlot& candidate = header->slots[slot];
+        uint64_t previous = candidate.sequence.exchange(kWriting, std::memory_order_seq_cst);
+        if (candidate.readers.load(std::memory_order_seq_cst) == 0) {
+            writeSlot = slot;
+            return header->slotData(slot);
+        }
+        candidate.sequence.store(previous, std::memory_order_release);
+    }
+
+    ++dropped;
+    return nullptr;
+}
+
+void ShmFrameWriter::commit(int mode) {
+    if (!header || writeSlot < 0) {
+        return;
+    }
+
+    ShmSlot& slot = header->slots[writeSlot];
+    slot.mode = static_cast<uint32_t>(mode);
+    slot.timestampNs = monotonicNs();
+    ++frameNumber;
+    slot.sequence.store(frameNumber, std::memory_order_release);
+
+    header->latest.store((frameNumber << 8) | static_cast<uint64_t>(writeSlot),
+                         std::memory_order_release);
+    latestSlot = writeSlot;
+    writeSlot = -1;
+
+    // Bump the futex word, then wake only if a reader announced it sleeps
+    header->published.fetch_add(1, std::memory_order_seq_cst);
+    if (header->waiters.load(std::memory_order_seq_cst) > 0) {
+        futexWakeAll(&header->published);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// ShmFrameReader
+// ---------------------------------------------------------------------------
+
+ShmFrameReader::ShmFrameReader()
+        : header(nullptr)
+        , mappingBytes(0)
+        , heldSlot(-1)
+        , lastFrame(0) {
+}
+
+ShmFrameReader::~ShmFrameReader() {
+    close();
+}
+
+bool ShmFrameReader::open(const std::string& name) {
+    close();
+
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        LOGE("shm_open %s failed: %s", name.c_str(), strerror(errno));
+        return false;
+    }
+
+    struct stat info;
+    void* addr = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(ShmRingHeader)) {
+        addr = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        LOGE("Mapping %s failed", name.c_str());
+        return false;
+    }
+
+    ShmRingHeader* mapped = static_cast<ShmRingHeader*>(addr);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (mapped->magic != kMagic || mapped->version != kVersion ||
+        mapped->dataOffset + mapped->slotBytes * mapped->slotCount >
+                static_cast<uint64_t>(info.st_size)) {
+        LOGE("%s is not a frame ring (or not initialized yet)", name.c_str());
+        munmap(addr, info.st_size);
+        return false;
+    }
+
+    header = mapped;
+    mappingBytes = info.st_size;
+    heldSlot = -1;
+    lastFrame = 0;
+    return true;
+}
+
+void ShmFrameReader::close() {
+    if (!header) {
+        return;
+    }
+    release();
+    munmap(header, mappingBytes);
+    header = nullptr;
+    mappingBytes = 0;
+}
+
+int ShmFrameReader::getWidth() const {
+    return header ? static_cast<int>(header->width) : 0;
+}
+
+int ShmFrameReader::getHeight() const {
+    return header ? static_cast<int>(header->height) : 0;
+}
+
+const uint8_t* ShmFrameReader::acquire(int timeoutMs, ShmFrameInfo& info) {
+    if (!header) {
+        return nullptr;
+    }
+    release();
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+
+    for (;;) {
+        // Read the futex word before 'latest': a commit in between changes
+        // the word and the wait below returns at once
+        uint32_t seen = header->published.load(std::memory_order_seq_cst);
+        uint64_t latest = header->latest.load(std::memory_order_acquire);
+        uint64_t frame = latest >> 8;
+
+        if (frame > lastFrame) {
+            int slot = static_cast<int>(latest & 0xff);
+            ShmSlot& candidate = header->slots[slot];
+
+            candidate.readers.fetch_add(1, std::memory_order_seq_cst);
+            if (candidate.sequence.load(std::memory_order_seq_cst) == frame) {
+                info.frameNumber = frame;
+                info.timestampNs = candidate.timestampNs;
+                info.width = static_cast<int>(header->width);
+                info.height = static_cast<int>(header->height);
+                info.mode = static_cast<int>(candidate.mode);
+                info.skipped = lastFrame > 0 ? frame - lastFrame - 1 : 0;
+
+                heldSlot = slot;
+                lastFrame = frame;
+                return header->slotData(slot);
+            }
+
+            // Overwritten between reading 'latest' and pinning: try the newer one
+            candidate.readers.fetch_sub(1, std::memory_order_release);
+            continue;
+        }
+
+        timespec timeout;
+        timespec* timeoutPtr = nullptr;
+        if (timeoutMs >= 0) {
+            auto remaining = deadline - std::chrono::steady_clock::now();
+            if (remaining <= std::chrono::steady_clock::duration::zero()) {
+                return nullptr;
+            }
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(remaining).count();
+            timeout.tv_sec = static_cast<time_t>(ns / 1000000000);
+            timeout.tv_nsec = static_cast<long>(ns % 1000000000);
+            timeoutPtr = &timeout;
+        }
+
+        header->waiters.fetch_add(1, std::memory_order_seq_cst);
+        futexWait(&header->published, seen, timeoutPtr);
+        header->waiters.fetch_sub(1, std::memory_order_seq_cst);
+    }
+}
+
+void ShmFrameReader::release() {
+    if (header && heldSlot >= 0) {
+        header->slots[heldSlot].readers.fetch_sub(1, std::memory_order_release);
+        heldSlot = -1;
+    }
+}
@@ -0,0 +1,134 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Shared-memory frame ring between processes (Linux host builds)
+ *
+ * One writer process creates a POSIX shared memory object holding a small
+ * header and slotCount page-aligned frame slots. The processor renders
+ * straight into a slot (acquire / processFrame / commit), and any number of
+ * reader processes map the same object and look at the newest committed
+ * frame in place - no socket, no copy per consumer.
+ *
+ * Each slot carries a sequence counter (the frame number it holds, or a
+ * "being written" marker) and a count of readers pinning it. The writer
+ * never picks the latest slot or a pinned one, so a frame a reader holds
+ * stays intact until it is released. Readers that fall behind simply get
+ * the newest frame next (latest-frame semantics). Waiting readers sleep on
+ * a futex in the header, which commit() wakes only when someone is waiting.
+ *
+ * Use at least readers + 2 slots so the writer always finds a free one; if
+ * every slot is busy acquire() fails and the frame is dropped. A reader that
+ * dies while pinning a slot leaves it pinned until the ring is recreated.
+ */
+
+/**
+ * Description of a frame held by a reader
+ */
+struct ShmFrameInfo {
+    uint64_t frameNumber;   // 1 for the first frame committed
+    uint64_t timestampNs;   // CLOCK_MONOTONIC at commit (comparable across processes)
+    int width;
+    int height;
+    int mode;               // OpenCVProcessor::ProcessingMode of the frame
+    uint64_t skipped;       // Frames committed since the previous one this reader took
+};
+
+struct ShmRingHeader;
+
+/**
+ * Creates the ring and publishes frames (single writer)
+ */
+class ShmFrameWriter {
+public:
+    ShmFrameWriter();
+    ~ShmFrameWriter();
+
+    ShmFrameWriter(const ShmFrameWriter&) = delete;
+    ShmFrameWriter& operator=(const ShmFrameWriter&) = delete;
+
+    /**
+     * Create (or replace) the shared memory object
+     * @param name Object name, e.g. "/edge_frames"
+     * @param width Frame width
+     * @param height Frame height
+     * @param slotCount Frame slots (at least 2)
+     */
+    bool create(const std::string& name, int width, int height, int slotCount);
+
+    /**
+     * Unmap and unlink the object; readers keep their mappings
+     */
+    void close();
+
+    /**
+     * Slot to render the next frame into (width * height * 4 bytes)
+     * @return nullptr if every slot is pinned by readers (frame dropped)
+     */
+    uint8_t* acquire();
+
+    /**
+     * Publish the acquired slot as the latest frame and wake readers
+     */
+    void commit(int mode);
+
+    size_t frameBytes() const { return slotBytes; }
+
+    uint64_t framesCommitted() const { return frameNumber; }
+    uint64_t framesDropped() const { return dropped; }
+
+private:
+    std::string name;
+    ShmRingHeader* header;
+    size_t mappingBytes;
+    size_t slotBytes;
+    int writeSlot;    // Acquired slot, -1 when none
+    int latestSlot;   // Slot of the latest committed frame, -1 before the first
+    uint64_t frameNumber;
+    uint64_t dropped;
+};
+
+/**
+ * Maps an existing ring and takes the newest frames
+ */
+class ShmFrameReader {
+public:
+    ShmFrameReader();
+    ~ShmFrameReader();
+
+    ShmFrameReader(const ShmFrameReader&) = delete;
+    ShmFrameReader& operator=(const ShmFrameReader&) = delete;
+
+    bool open(const std::string& name);
+
+    void close();
+
+    /**
+     * Pin the newest frame not seen yet, waiting for one if necessary;
+     * releases the frame held before
+     * @param timeoutMs Longest wait, negative to wait forever
+     * @param info Receives the frame description
+     * @return RGBA pixels valid until release(), or nullptr on timeout
+     */
+    const uint8_t* acquire(int timeoutMs, ShmFrameInfo& info);
+
+    /**
+     * Unpin the frame returned by acquire()
+     */
+    void release();
+
+    int getWidth() const;
+    int getHeight() const;
+
+private:
+    ShmRingHeader* header;
+    size_t mappingBytes;
+    int heldSlot;
+    uint64_t lastFrame;
+};
+
+#endif // SHM_RING_H
@@ -0,0 +1,599 @@
+#include "stream_server.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define LOG_TAG "StreamServer"
+#include "native_log.h"
+
+namespace {
+
+const int kFresh = 4;       // Set in StreamServer::latest while the frame is unread
+const int kIndexMask = 3;
+
+const int kPollTimeoutMs = 100;
+const size_t kMaxRequestBytes = 8192;
+const size_t kMaxClients = 16;
+
+const char kWebSocketGuid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+const uint8_t kEncodingPacked = 0;
+const uint8_t kEncodingRle = 1;
+const uint8_t kEncodingGray = 2;
+
+typedef std::shared_ptr<const std::vector<uint8_t>> Bundle;
+
+/**
+ * SHA-1 of a short message (only used for the handshake)
+ */
+void sha1(const std::string& message, uint8_t digest[20]) {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+    std::vector<uint8_t> data(message.begin(), message.end());
+    uint64_t bitLength = static_cast<uint64_t>(data.size()) * 8;
+    data.push_back(0x80);
+    while (data.size() % 64 != 56) {
+        data.push_back(0);
+    }
+    for (int i = 7; i >= 0; --i) {
+        data.push_back(static_cast<uint8_t>(bitLength >> (i * 8)));
+    }
+
+    for (size_t chunk = 0; chunk < data.size(); chunk += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i) {
+            const uint8_t* p = &data[chunk + i * 4];
+            w[i] = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+        }
+        for (int i = 16; i < 80; ++i) {
+            uint32_t v = w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16];
+            w[i] = (v << 1) | (v >> 31);
+        }
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i) {
+            uint32_t f;
+            uint32_t k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t temp = ((a << 5) | (a >> 27)) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = (b << 30) | (b >> 2);
+            b = a;
+            a = temp;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+
+    for (int i = 0; i < 5; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            digest[i * 4 + j] = static_cast<uint8_t>(h[i] >> (24 - j * 8));
+        }
+    }
+}
+
+std::string base64(const uint8_t* data, size_t length) {
+    static const char kAlphabet[] =
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < length; i += 3) {
+        uint32_t v = uint32_t(data[i]) << 16;
+        if (i + 1 < length) v |= uint32_t(data[i + 1]) << 8;
+        if (i + 2 < length) v |= data[i + 2];
+        out.push_back(kAlphabet[(v >> 18) & 63]);
+        out.push_back(kAlphabet[(v >> 12) & 63]);
+        out.push_back(i + 1 < length ? kAlphabet[(v >> 6) & 63] : '=');
+        out.push_back(i + 2 < length ? kAlphabet[v & 63] : '=');
+    }
+    return out;
+}
+
+// Value of an HTTP header (case-insensitive name), or "" if missing
+std::string headerValue(const std::string& request, const std::string& name) {
+    std::string lower(request);
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    std::string key = "\r\n" + name + ":";
+    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+
+    size_t start = lower.find(key);
+    if (start == std::string::npos) {
+        return "";
+    }
+    start += key.size();
+    size_t end = request.find("\r\n", start);
+    std::string value = request.substr(start, end - start);
+    value.erase(0, value.find_first_not_of(" \t"));
+    value.erase(value.find_last_not_of(" \t") + 1);
+    return value;
+}
+
+// Append a complete unmasked server frame
+void appendWebSocketFrame(std::vector<uint8_t>& out, uint8_t opcode,
+                          const uint8_t* payload, size_t length) {
+    out.push_back(0x80 | opcode);
+    if (length < 126) {
+        out.push_back(static_cast<uint8_t>(length));
+    } else if (length <= 0xFFFF) {
+        out.push_back(126);
+        out.push_back(static_cast<uint8_t>(length >> 8));
+        out.push_back(static_cast<uint8_t>(length));
+    } else {
+        out.push_back(127);
+        for (int i = 7; i >= 0; --i) {
+            out.push_back(static_cast<uint8_t>(static_cast<uint64_t>(length) >> (i * 8)));
+        }
+    }
+    out.insert(out.end(), payload, payload + length);
+}
+
+void putVarint(std::vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+template <typename T>
+void putLe(std::vector<uint8_t>& out, T value) {
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        out.push_back(static_cast<uint8_t>(static_cast<uint64_t>(value) >> (i * 8)));
+    }
+}
+
+/**
+ * Encode a frame payload; returns the encoding used
+ */
+uint8_t encodePayload(const std::vector<uint8_t>& luma, int width, int height, bool mask,
+                      std::vector<uint8_t>& packed, std::vector<uint8_t>& rle) {
+    size_t pixels = static_cast<size_t>(width) * height;
+    if (!mask) {
+        packed.assign(luma.begin(), luma.begin() + pixels);
+        return kEncodingGray;
+    }
+
+    size_t rowBytes = (static_cast<size_t>(width) + 7) / 8;
+    packed.assign(rowBytes * height, 0);
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* row = luma.data() + static_cast<size_t>(y) * width;
+        uint8_t* out = packed.data() + rowBytes * y;
+        for (int x = 0; x < width; ++x) {
+            if (row[x]) {
+                out[x >> 3] |= static_cast<uint8_t>(0x80 >> (x & 7));
+            }
+        }
+    }
+
+    // Runs alternate off / on; give up as soon as RLE is no smaller
+    rle.clear();
+    bool on = false;
+    uint32_t run = 0;
+    for (size_t i = 0; i < pixels && rle.size() < packed.size(); ++i) {
+        if ((luma[i] != 0) != on) {
+            putVarint(rle, run);
+            on = !on;
+            run = 0;
+        }
+        ++run;
+    }
+    putVarint(rle, run);
+
+    if (rle.size() < packed.size()) {
+        packed.swap(rle);
+        return kEncodingRle;
+    }
+    return kEncodingPacked;
+}
+
+} // namespace
+
+/**
+ * One connection; all fields belong to the server thread
+ */
+struct StreamServer::Client {
+    int fd;
+    bool upgraded;
+    bool closing;             // Close once the current bundle is sent
+    std::string request;      // Handshake bytes so far
+    std::vector<uint8_t> input;
+
+    std::vector<uint8_t> control;  // Handshake / pong / close bytes, sent first
+    Bundle sending;
+    size_t sent;
+    Bundle pending;           // Newest frame waiting behind 'sending'
+    uint64_t dropped;
+};
+
+StreamServer::StreamServer()
+        : latest(2)
+        , producerIndex(0)
+        , consumerIndex(1)
+        , published(0)
+        , listenFd(-1)
+        , wakeFd(-1)
+        , running(false)
+        , clients(0) {
+}
+
+StreamServer::~StreamServer() {
+    stop();
+}
+
+bool StreamServer::start(int port) {
+    if (running.load()) {
+        return false;
+    }
+
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        LOGE("socket failed: %s", strerror(errno));
+        return false;
+    }
+
+    int reuse = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    // Loopback only: the viewer runs on the same machine
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listenFd, 8) != 0) {
+        LOGE("Cannot listen on 127.0.0.1:%d: %s", port, strerror(errno));
+        close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd < 0) {
+        LOGE("eventfd failed: %s", strerror(errno));
+        close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+
+    running.store(true);
+    thread = std::thread(&StreamServer::serverLoop, this);
+    LOGI("Streaming on ws://127.0.0.1:%d", port);
+    return true;
+}
+
+void StreamServer::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+
+    wake();
+    thread.join();
+
+    close(wakeFd);
+    close(listenFd);
+    wakeFd = -1;
+    listenFd = -1;
+}
+
+void StreamServer::publish(const uint8_t* rgba, int width, int height,
+                           OpenCVProcessor::ProcessingMode mode, const ProcessorStats& stats) {
+    ++published;
+    if (!running.load(std::memory_order_relaxed) ||
+        clients.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Only channel 0 travels: masks and grayscale are R = G = B
+    Frame& frame = frames[producerIndex];
+    size_t pixels = static_cast<size_t>(width) * height;
+    frame.luma.resize(pixels);
+    for (size_t i = 0; i < pixels; ++i) {
+        frame.luma[i] = rgba[i * 4];
+    }
+    frame.width = width;
+    frame.height = height;
+    frame.mode = mode;
+    frame.stats = stats;
+    frame.number = published;
+    frame.publishMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+
+    int previous = latest.exchange(producerIndex | kFresh, std::memory_order_acq_rel);
+    producerIndex = previous & kIndexMask;
+    wake();
+}
+
+bool StreamServer::takeLatest() {
+    if (!(latest.load(std::memory_order_acquire) & kFresh)) {
+        return false;
+    }
+    int previous = latest.exchange(consumerIndex, std::memory_order_acq_rel);
+    consumerIndex = previous & kIndexMask;
+    return true;
+}
+
+void StreamServer::wake() {
+    uint64_t one = 1;
+    ssize_t written = write(wakeFd, &one, sizeof(one));
+    (void) written;  // Counter already non-zero: the server is awake anyway
+}
+
+void StreamServer::serverLoop() {
+    std::vector<std::unique_ptr<Client>> connections;
+    std::vector<uint8_t> packed;
+    std::vector<uint8_t> rle;
+    uint64_t totalDropped = 0;
+
+    std::chrono::steady_clock::time_point lastFrameTime;
+    bool haveLastFrame = false;
+    double streamFps = 0.0;
+
+    while (running.load()) {
+        std::vector<pollfd> fds;
+        fds.push_back({listenFd, POLLIN, 0});
+        fds.push_back({wakeFd, POLLIN, 0});
+        for (auto& client : connections) {
+            bool hasOutput = !client->control.empty() || client->sending;
+            fds.push_back({client->fd, static_cast<short>(POLLIN | (hasOutput ? POLLOUT : 0)), 0});
+        }
+
+        // Clients accepted below have no poll entry until the next pass
+        size_t polled = connections.size();
+
+        if (poll(fds.data(), fds.size(), kPollTimeoutMs) < 0 && errno != EINTR) {
+            LOGE("poll failed: %s", strerror(errno));
+            break;
+        }
+
+        // New connections
+        if (fds[0].revents & POLLIN) {
+            int fd;
+            while ((fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                if (connections.size() >= kMaxClients) {
+                    close(fd);
+                    continue;
+                }
+                int noDelay = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+                connections.emplace_back(new Client{fd, false, false, "", {}, {}, nullptr, 0,
+                                                    nullptr, 0});
+            }
+        }
+
+        // A new frame: encode once, offer to every client
+        if (fds[1].revents & POLLIN) {
+            uint64_t counter;
+            ssize_t drained = read(wakeFd, &counter, sizeof(counter));
+            (void) drained;
+
+            if (takeLatest()) {
+                const Frame& frame = frames[consumerIndex];
+                auto start = std::chrono::steady_clock::now();
+
+                uint8_t encoding = encodePayload(frame.luma, frame.width, frame.height,
+                                                 frame.mode == OpenCVProcessor::MODE_CANNY,
+                                                 packed, rle);
+
+                std::vector<uint8_t> message;
+                message.insert(message.end(), {'E', 'D', 'G', 'F', 1, encoding, 0, 0});
+                putLe<uint32_t>(message, static_cast<uint32_t>(frame.width));
+                putLe<uint32_t>(message, static_cast<uint32_t>(frame.height));
+                putLe<uint32_t>(message, frame.number);
+                message.insert(message.end(), packed.begin(), packed.end());
+
+                double encodeMs = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start).count();
+
+                double interval = std::chrono::duration<double>(start - lastFrameTime).count();
+                if (haveLastFrame && interval > 0.0) {
+                    streamFps = streamFps > 0.0 ? streamFps + 0.1 * (1.0 / interval - streamFps)
+                                                : 1.0 / interval;
+                }
+                lastFrameTime = start;
+                haveLastFrame = true;
+
+                char json[512];
+                int jsonLength = snprintf(
+                        json, sizeof(json),
+                        "{\"type\":\"stats\",\"frame\":%u,\"width\":%d,\"height\":%d,"
+                        "\"mode\":%d,\"framesProcessed\":%llu,\"processMs\":%.3f,"
+                        "\"averageProcessMs\":%.3f,\"qualityLevel\":%d,\"nativeBytes\":%zu,"
+                        "\"publishMs\":%.3f,\"encodeMs\":%.3f,\"encodedBytes\":%zu,"
+                        "\"rawBytes\":%zu,\"streamFps\":%.2f,\"clients\":%zu,\"dropped\":%llu}",
+                        frame.number, frame.width, frame.height, frame.mode,
+                        static_cast<unsigned long long>(frame.stats.framesProcessed),
+                        frame.stats.lastFrameMs, frame.stats.averageFrameMs,
+                        frame.stats.qualityLevel, frame.stats.nativeBytes, frame.publishMs,
+                        encodeMs, message.size(),
+                        static_cast<size_t>(frame.width) * frame.height * 4, streamFps,
+                        connections.size(), static_cast<unsigned long long>(totalDropped));
+
+                std::shared_ptr<std::vector<uint8_t>> bundle(new std::vector<uint8_t>());
+                appendWebSocketFrame(*bundle, 0x1, reinterpret_cast<const uint8_t*>(json),
+                                     std::min<size_t>(jsonLength, sizeof(json) - 1));
+                appendWebSocketFrame(*bundle, 0x2, message.data(), message.size());
+
+                for (auto& client : connections) {
+                    if (!client->upgraded || client->closing) {
+                        continue;
+                    }
+                    if (!client->sending) {
+                        client->sending = bundle;
+                        client->sent = 0;
+                    } else {
+                        // Still writing an older frame: replace whatever waits behind it
+                        if (client->pending) {
+                            ++client->dropped;
+                            ++totalDropped;
+                        }
+                        client->pending = bundle;
+                    }
+                }
+            }
+        }
+
+        // Client I/O
+        for (size_t i = 0; i < polled; ++i) {
+            Client& client = *connections[i];
+            short revents = fds[i + 2].revents;
+            bool drop = (revents & (POLLERR | POLLHUP | POLLNVAL)) != 0;
+
+            if (!drop && (revents & POLLIN)) {
+                uint8_t buffer[4096];
+                ssize_t n = recv(client.fd, buffer, sizeof(buffer), 0);
+                if (n <= 0) {
+                    drop = n == 0 || (errno != EAGAIN && errno != EINTR);
+                } else if (!client.upgraded) {
+                    client.request.append(reinterpret_cast<char*>(buffer), n);
+                    if (client.request.find("\r\n\r\n") != std::string::npos) {
+                        std::string key = headerValue(client.request, "Sec-WebSocket-Key");
+                        std::string response;
+                        if (key.empty()) {
+                            response = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n"
+                                       "Connection: close\r\n\r\n";
+                            client.closing = true;
+                        } else {
+                            uint8_t digest[20];
+                            sha1(key + kWebSocketGuid, digest);
+                            response = "HTTP/1.1 101 Switching Protocols\r\n"
+                                       "Upgrade: websocket\r\nConnection: Upgrade\r\n"
+                                       "Sec-WebSocket-Accept: " + base64(digest, 20) +
+                                       "\r\n\r\n";
+                            client.upgraded = true;
+                        }
+                        client.control.assign(response.begin(), response.end());
+                        client.request.clear();
+                    } else if (client.request.size() > kMaxRequestBytes) {
+                        drop = true;
+                    }
+                } else {
+                    // Client frames are masked; only close and ping need an answer
+                    client.input.insert(client.input.end(), buffer, buffer + n);
+                    while (client.input.size() >= 2) {
+                        uint8_t opcode = client.input[0] & 0x0f;
+                        size_t length = client.input[1] & 0x7f;
+                        size_t headerBytes = 2;
+                        if (length == 126) {
+                            headerBytes = 4;
+                        } else if (length == 127) {
+                            headerBytes = 10;
+                        }
+                        if (client.input.size() < headerBytes + 4) {
+                            break;
+                        }
+                        if (length >= 126) {
+                            length = 0;
+                            for (size_t b = 2; b < headerBytes; ++b) {
+                                length = (length << 8) | client.input[b];
+                            }
+                        }
+                        if (length > kMaxRequestBytes) {
+                            drop = true;
+                            break;
+                        }
+                        size_t total = headerBytes + 4 + length;
+                        if (client.input.size() < total) {
+                            break;
+                        }
+
+                        if (opcode == 0x8) {
+                            const uint8_t closeFrame[] = {0x88, 0x00};
+                            client.control.insert(client.control.end(), closeFrame,
+                                                  closeFrame + 2);
+                            client.closing = true;
+                        } else if (opcode == 0x9) {
+                            std::vector<uint8_t> payload(length);
+                            const uint8_t* mask = &client.input[headerBytes];
+                            for (size_t b = 0; b < length; ++b) {
+                                payload[b] = client.input[headerBytes + 4 + b] ^ mask[b & 3];
+                            }
+                            appendWebSocketFrame(client.control, 0xA, payload.data(), length);
+                        }
+                        client.input.erase(client.input.begin(), client.input.begin() + total);
+                    }
+                }
+            }
+
+            if (!drop && (revents & POLLOUT)) {
+                // Control bytes first, then the current frame bundle
+                while (!client.control.empty()) {
+                    ssize_t n = send(client.fd, client.control.data(), client.control.size(),
+                                     MSG_NOSIGNAL | MSG_DONTWAIT);
+                    if (n <= 0) {
+                        drop = n < 0 && errno != EAGAIN && errno != EINTR;
+                        break;
+                    }
+                    client.control.erase(client.control.begin(), client.control.begin() + n);
+                }
+
+                while (!drop && client.control.empty() && client.sending) {
+                    const std::vector<uint8_t>& data = *client.sending;
+                    ssize_t n = send(client.fd, data.data() + client.sent,
+                                     data.size() - client.sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+                    if (n <= 0) {
+                        drop = n < 0 && errno != EAGAIN && errno != EINTR;
+                        break;
+                    }
+                    client.sent += n;
+                    if (client.sent == data.size()) {
+                        client.sending = std::move(client.pending);
+                        client.pending.reset();
+                        client.sent = 0;
+                    }
+                }
+            }
+
+            if (client.closing && client.control.empty() && !client.sending) {
+                drop = true;
+            }
+
+            if (drop) {
+                close(client.fd);
+                connections[i].reset();
+            }
+        }
+
+        connections.erase(std::remove(connections.begin(), connections.end(), nullptr),
+                          connections.end());
+
+        int upgraded = 0;
+        for (auto& client : connections) {
+            upgraded += client->upgraded ? 1 : 0;
+        }
+        clients.store(upgraded, std::memory_order_relaxed);
+    }
+
+    for (auto& client : connections) {
+        close(client->fd);
+    }
+    clients.store(0);
+}
@@ -0,0 +1,95 @@
+#ifndef STREAM_SERVER_H
+#define STREAM_SERVER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "opencv_processor.h"
+
+/**
+ * Live frame streaming to the web viewer over WebSocket (host builds)
+ *
+ * The processing thread calls publish(), which copies the frame into a
+ * lock-free triple buffer and returns; it never encodes, never touches a
+ * socket and never waits. A server thread owns everything else: accepting
+ * loopback connections, the WebSocket handshake, encoding the newest frame
+ * once and fanning it out. Every client holds at most one frame besides
+ * the one being written, so a slow client skips stale frames (counted as
+ * dropped) instead of building a backlog.
+ *
+ * Messages to the client:
+ *   text    JSON stats: {"type":"stats", ...}, once per encoded frame
+ *   binary  frame: magic "EDGF", version u8, encoding u8, reserved u16,
+ *           width u32, height u32, frame number u32, then the payload
+ *           (little-endian). Encodings:
+ *             0  bit-packed mask, MSB first, rows padded to whole bytes
+ *             1  run-length mask: varint run lengths alternating off / on,
+ *                starting with off, over the whole frame in row order
+ *             2  8-bit grayscale
+ *           Masks use whichever of 0 and 1 is smaller.
+ */
+class StreamServer {
+public:
+    StreamServer();
+    ~StreamServer();
+
+    StreamServer(const StreamServer&) = delete;
+    StreamServer& operator=(const StreamServer&) = delete;
+
+    /**
+     * Listen on 127.0.0.1:port and start the server thread
+     */
+    bool start(int port);
+
+    void stop();
+
+    /**
+     * Offer a processed frame (processing thread; never blocks)
+     * @param rgba RGBA frame as produced by OpenCVProcessor
+     * @param width Frame width
+     * @param height Frame height
+     * @param mode Mode the frame was processed with (MODE_CANNY = binary mask)
+     * @param stats Processor statistics after the frame
+     */
+    void publish(const uint8_t* rgba, int width, int height,
+                 OpenCVProcessor::ProcessingMode mode, const ProcessorStats& stats);
+
+    int clientCount() const { return clients.load(std::memory_order_relaxed); }
+
+private:
+    struct Frame {
+        std::vector<uint8_t> luma;  // Channel 0 of the RGBA frame
+        int width = 0;
+        int height = 0;
+        OpenCVProcessor::ProcessingMode mode = OpenCVProcessor::MODE_RAW;
+        ProcessorStats stats = {};
+        uint32_t number = 0;
+        double publishMs = 0.0;     // Copy time on the processing thread
+    };
+
+    struct Client;
+
+    // Triple buffer: the producer owns one frame, the consumer one, and the
+    // third is exchanged through 'latest' (index | kFresh when unread)
+    Frame frames[3];
+    std::atomic<int> latest;
+    int producerIndex;
+    int consumerIndex;
+    uint32_t published;
+
+    int listenFd;
+    int wakeFd;
+    std::thread thread;
+    std::atomic<bool> running;
+    std::atomic<int> clients;
+
+    void serverLoop();
+    bool takeLatest();
+    void wake();
+};
+
+#endif // STREAM_SERVER_H
@@ -0,0 +1,312 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define LOG_TAG "ThreadPool"
+#include "native_log.h"
+
+namespace {
+
+// Highest CPU index covered by a 64-bit affinity mask
+const int kMaxCpus = 64;
+
+// Niceness value meaning "leave the scheduler default alone"
+const int kKeepNiceness = INT_MIN;
+
+thread_local int t_workerIndex = 0;
+thread_local int t_parallelDepth = 0;
+thread_local ThreadPool* t_currentPool = nullptr;
+
+void applyAffinity(uint64_t mask) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu = 0; cpu < kMaxCpus; ++cpu) {
+        if (mask & (uint64_t(1) << cpu)) {
+            CPU_SET(cpu, &set);
+        }
+    }
+
+    // pid 0 = calling thread
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        LOGE("sched_setaffinity(0x%llx) failed: %s",
+             static_cast<unsigned long long>(mask), strerror(errno));
+    }
+}
+
+void applyNiceness(int niceness) {
+    // On Linux, PRIO_PROCESS with a thread id only affects that thread
+    id_t tid = static_cast<id_t>(syscall(SYS_gettid));
+    if (setpriority(PRIO_PROCESS, tid, niceness) != 0) {
+        LOGE("setpriority(%d) failed: %s", niceness, strerror(errno));
+    }
+}
+
+} // namespace
+
+/**
+ * One parallelFor() call in flight
+ */
+struct ThreadPool::Job {
+    const std::function<void(int, int)>* body;
+    std::atomic<int> remaining;
+    std::mutex mutex;
+    std::condition_variable done;
+    std::exception_ptr error;
+};
+
+ThreadPool::ThreadPool(const ThreadPoolConfig& config)
+        : pendingTasks(0)
+        , stopping(false) {
+    int count = config.threadCount;
+    if (count == 0) {
+        count = std::max(1, static_cast<int>(std::thread::hardware_concurrency())) - 1;
+    } else if (count < 0) {
+        count = 0;  // The calling thread does all the work
+    }
+
+    for (int i = 0; i < count; ++i) {
+        workers.emplace_back(new Worker());
+    }
+
+    // Start threads only after the worker table is complete - they steal from each other
+    for (int i = 0; i < count; ++i) {
+        uint64_t mask = 0;
+        if (!config.affinityMasks.empty()) {
+            mask = config.affinityMasks[std::min<size_t>(i, config.affinityMasks.size() - 1)];
+        }
+
+        int niceness = kKeepNiceness;
+        if (!config.niceness.empty()) {
+            niceness = config.niceness[std::min<size_t>(i, config.niceness.size() - 1)];
+        }
+
+        workers[i]->thread = std::thread(&ThreadPool::workerLoop, this, i, mask, niceness);
+    }
+
+    LOGI("Started %d workers (affinity masks: %zu, niceness values: %zu)",
+         count, config.affinityMasks.size(), config.niceness.size());
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+
+    for (auto& worker : workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+void ThreadPool::parallelFor(int begin, int end, int grain,
+                             const std::function<void(int, int)>& body) {
+    if (end <= begin) {
+        return;
+    }
+
+    grain = std::max(1, grain);
+    int chunks = (end - begin + grain - 1) / grain;
+
+    // Nothing to share, or already inside a chunk: run inline
+    if (workers.empty() || chunks == 1 || t_parallelDepth > 0) {
+        ++t_parallelDepth;
+        try {
+            body(begin, end);
+        } catch (...) {
+            --t_parallelDepth;
+            throw;
+        }
+        --t_parallelDepth;
+        return;
+    }
+
+    Job job;
+    job.body = &body;
+    job.remaining.store(chunks, std::memory_order_relaxed);
+
+    // Deal chunks out round-robin so every worker starts with local work
+    int n = size();
+    for (int c = 0; c < chunks; ++c) {
+        int chunkBegin = begin + c * grain;
+        Task task = {&job, chunkBegin, std::min(end, chunkBegin + grain)};
+        Worker& worker = *workers[c % n];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(task);
+    }
+
+    pendingTasks.fetch_add(chunks, std::memory_order_release);
+    {
+        // Taking the lock orders the push against a worker about to sleep
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wakeCondition.notify_all();
+
+    // Help out until the queues are empty, then wait for chunks still running
+    Task task;
+    while (job.remaining.load(std::memory_order_acquire) > 0 && stealTask(-1, task)) {
+        runTask(task);
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(job.mutex);
+        job.done.wait(lock, [&job] {
+            return job.remaining.load(std::memory_order_acquire) == 0;
+        });
+    }
+
+    if (job.error) {
+        std::rethrow_exception(job.error);
+    }
+}
+
+void ThreadPool::workerLoop(int index, uint64_t affinityMask, int niceness) {
+    t_workerIndex = index + 1;
+
+    if (affinityMask != 0) {
+        applyAffinity(affinityMask);
+    }
+    if (niceness != kKeepNiceness) {
+        applyNiceness(niceness);
+    }
+
+    Task task;
+    for (;;) {
+        if (popTask(index, task) || stealTask(index, task)) {
+            runTask(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeCondition.wait(lock, [this] {
+            return stopping || pendingTasks.load(std::memory_order_acquire) > 0;
+        });
+        if (stopping && pendingTasks.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::popTask(int index, Task& task) {
+    Worker& worker = *workers[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.tasks.empty()) {
+        return false;
+    }
+
+    task = worker.tasks.back();
+    worker.tasks.pop_back();
+    pendingTasks.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool ThreadPool::stealTask(int thief, Task& task) {
+    int n = size();
+    int start = thief < 0 ? 0 : thief + 1;
+
+    for (int i = 0; i < n; ++i) {
+        int victim = (start + i) % n;
+        if (victim == thief) {
+            continue;
+        }
+
+        Worker& worker = *workers[victim];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.tasks.empty()) {
+            task = worker.tasks.front();
+            worker.tasks.pop_front();
+            pendingTasks.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::runTask(const Task& task) {
+    Job& job = *task.job;
+
+    ++t_parallelDepth;
+    try {
+        (*job.body)(task.begin, task.end);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(job.mutex);
+        if (!job.error) {
+            job.error = std::current_exception();
+        }
+    }
+    --t_parallelDepth;
+
+    // Decrement under the lock: the caller may destroy the job as soon as it sees zero
+    std::lock_guard<std::mutex> lock(job.mutex);
+    if (job.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        job.done.notify_all();
+    }
+}
+
+int ThreadPool::currentWorkerIndex() {
+    return t_workerIndex;
+}
+
+ThreadPool* ThreadPool::current() {
+    return t_currentPool;
+}
+
+ThreadPool::Scope::Scope(ThreadPool* pool)
+        : previous(t_currentPool) {
+    t_currentPool = pool;
+}
+
+ThreadPool::Scope::~Scope() {
+    t_currentPool = previous;
+}
+
+uint64_t ThreadPool::performanceCoreMask() {
+    long maxFreq[kMaxCpus];
+    long lowest = LONG_MAX;
+    int cpus = 0;
+
+    for (int cpu = 0; cpu < kMaxCpus; ++cpu) {
+        char path[96];
+        snprintf(path, sizeof(path),
+                 "/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq", cpu);
+
+        FILE* file = fopen(path, "r");
+        if (!file) {
+            break;
+        }
+        if (fscanf(file, "%ld", &maxFreq[cpu]) != 1) {
+            maxFreq[cpu] = 0;
+        }
+        fclose(file);
+
+        lowest = std::min(lowest, maxFreq[cpu]);
+        cpus = cpu + 1;
+    }
+
+    if (cpus == 0) {
+        return 0;
+    }
+
+    uint64_t mask = 0;
+    uint64_t all = 0;
+    for (int cpu = 0; cpu < cpus; ++cpu) {
+        all |= uint64_t(1) << cpu;
+        if (maxFreq[cpu] > lowest) {
+            mask |= uint64_t(1) << cpu;
+        }
+    }
+
+    // Homogeneous CPU: every core counts as a performance core
+    return mask != 0 ? mask : all;
+}
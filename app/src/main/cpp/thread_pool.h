@@ -0,0 +1,118 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Thread pool configuration
+ *
+ * affinityMasks and niceness are optional: leave them empty to keep the
+ * scheduler defaults, give one entry to apply it to every worker, or one
+ * entry per worker. Bit N of a mask selects CPU N.
+ */
+struct ThreadPoolConfig {
+    int threadCount = 0;                  // Worker threads; 0 = online CPUs - 1, < 0 = none
+    std::vector<uint64_t> affinityMasks;  // sched_setaffinity() masks
+    std::vector<int> niceness;            // setpriority() values (-20..19)
+};
+
+/**
+ * Work-stealing thread pool
+ *
+ * Every worker owns a deque of tasks. parallelFor() deals chunks out to the
+ * deques round-robin; workers pop their own deque from the back and steal
+ * from the front of the others once it runs dry. The calling thread helps
+ * until the loop is finished, so a pool with N workers runs N + 1 threads.
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(const ThreadPoolConfig& config);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Run body(begin, end) over [begin, end) in chunks of at most grain items
+     * Blocks until every chunk is done. Calls made from inside a running
+     * chunk execute inline. The first exception thrown by a chunk is
+     * rethrown here once the loop has drained.
+     */
+    void parallelFor(int begin, int end, int grain,
+                     const std::function<void(int, int)>& body);
+
+    /**
+     * Number of worker threads (excluding the calling thread)
+     */
+    int size() const { return static_cast<int>(workers.size()); }
+
+    /**
+     * Threads taking part in parallelFor(), including the caller
+     */
+    int concurrency() const { return size() + 1; }
+
+    /**
+     * Index of the calling thread: 1..size() for workers, 0 otherwise
+     */
+    static int currentWorkerIndex();
+
+    /**
+     * Pool bound to the calling thread by a Scope, or nullptr
+     */
+    static ThreadPool* current();
+
+    /**
+     * Binds a pool to the calling thread for the lifetime of the scope
+     * Used to route OpenCV's parallel loops onto the pool.
+     */
+    class Scope {
+    public:
+        explicit Scope(ThreadPool* pool);
+        ~Scope();
+    private:
+        ThreadPool* previous;
+    };
+
+    /**
+     * Mask of the fastest CPU cluster(s) on big.LITTLE systems
+     * Derived from cpufreq maximum frequencies; CPUs in the slowest cluster
+     * are left out. Returns 0 when the topology cannot be read.
+     */
+    static uint64_t performanceCoreMask();
+
+private:
+    struct Job;
+
+    struct Task {
+        Job* job;
+        int begin;
+        int end;
+    };
+
+    struct Worker {
+        std::thread thread;
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::mutex sleepMutex;
+    std::condition_variable wakeCondition;
+    std::atomic<int> pendingTasks;
+    bool stopping;
+
+    void workerLoop(int index, uint64_t affinityMask, int niceness);
+    bool popTask(int index, Task& task);
+    bool stealTask(int thief, Task& task);
+    void runTask(const Task& task);
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,74 @@
+/**
+ * Batch processing benchmark
+ *
+ * Processes the same block of synthetic frames once through the per-frame
+ * path (processFrame in a loop, parallel inside each frame) and once through
+ * processBatch (frames spread across the workers), and prints the throughput
+ * of both.
+ *
+ * Usage: bench_batch [width] [height] [frames] [threads] [mode]
+ */
+#include <cstdlib>
+
+#include "../opencv_processor.h"
+#include "bench_common.h"
+
+int main(int argc, char** argv) {
+    int width = argc > 1 ? std::atoi(argv[1]) : 1920;
+    int height = argc > 2 ? std::atoi(argv[2]) : 1080;
+    int frames = argc > 3 ? std::atoi(argv[3]) : 120;
+    int threads = argc > 4 ? std::atoi(argv[4]) : 0;
+    OpenCVProcessor::ProcessingMode mode = static_cast<OpenCVProcessor::ProcessingMode>(
+            argc > 5 ? std::atoi(argv[5]) : OpenCVProcessor::MODE_CANNY);
+
+    OpenCVProcessor processor;
+    if (frames <= 0 || !processor.init(width, height)) {
+        return 1;
+    }
+
+    ThreadPoolConfig config;
+    config.threadCount = threads;
+    processor.configureThreads(config);
+
+    size_t inputBytes = static_cast<size_t>(width) * height * 3 / 2;
+    size_t outputBytes = static_cast<size_t>(width) * height * 4;
+
+    // Contiguous input block as a recording would provide it
+    std::vector<uint8_t> input(inputBytes * frames);
+    for (int i = 0; i < frames; ++i) {
+        std::vector<uint8_t> frame = bench::makeSyntheticNv21(width, height, i);
+        std::copy(frame.begin(), frame.end(), input.begin() + inputBytes * i);
+    }
+    std::vector<uint8_t> output(outputBytes * frames);
+    std::vector<uint8_t> status(frames);
+
+    // Warm up both paths (thread pool start, workspace allocation)
+    processor.processBatch(input.data(), input.size(), output.data(), output.size(),
+                           frames, mode, status.data());
+
+    std::printf("%dx%d, %d frames, threads=%d, mode=%d\n",
+                width, height, frames, threads, mode);
+
+    auto start = bench::Clock::now();
+    int perFrameOk = 0;
+    for (int i = 0; i < frames; ++i) {
+        if (processor.processFrame(input.data() + inputBytes * i, inputBytes,
+                                   output.data() + outputBytes * i, mode)) {
+            ++perFrameOk;
+        }
+    }
+    double perFrameMs = bench::elapsedMs(start, bench::Clock::now());
+
+    start = bench::Clock::now();
+    int batchOk = processor.processBatch(input.data(), input.size(),
+                                         output.data(), output.size(),
+                                         frames, mode, status.data());
+    double batchMs = bench::elapsedMs(start, bench::Clock::now());
+
+    std::printf("%-16s %4d ok  %9.2f ms  %8.1f fps\n", "per-frame loop",
+                perFrameOk, perFrameMs, frames * 1000.0 / perFrameMs);
+    std::printf("%-16s %4d ok  %9.2f ms  %8.1f fps\n", "batch",
+                batchOk, batchMs, frames * 1000.0 / batchMs);
+    std::printf("speedup: %.2fx\n", perFrameMs / batchMs);
+    return 0;
+}
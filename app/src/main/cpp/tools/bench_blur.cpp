@@ -0,0 +1,95 @@
+/**
+ * Blur engine benchmark
+ *
+ * Blurs a synthetic luma plane over a range of sigmas with cv::GaussianBlur
+ * and each engine of gaussian_blur.h, single-threaded, and prints the mean
+ * time and the largest difference from OpenCV's result. The box and
+ * recursive engines should stay nearly flat as sigma grows.
+ *
+ * Usage: bench_blur [width] [height] [runs]
+ */
+#include <cstdlib>
+
+#include "../gaussian_blur.h"
+#include "bench_common.h"
+
+namespace {
+
+const double kSigmas[] = {0.8, 1.5, 3.0, 5.0, 8.0, 12.0, 20.0, 40.0};
+
+const struct {
+    BlurMethod method;
+    const char* name;
+} kEngines[] = {
+        {BLUR_SEPARABLE, "separable"},
+        {BLUR_BOX, "box"},
+        {BLUR_RECURSIVE, "recursive"},
+};
+
+int maxDifference(const cv::Mat& a, const cv::Mat& b) {
+    int largest = 0;
+    for (int y = 0; y < a.rows; ++y) {
+        const uint8_t* p = a.ptr<uint8_t>(y);
+        const uint8_t* q = b.ptr<uint8_t>(y);
+        for (int x = 0; x < a.cols; ++x) {
+            largest = std::max(largest, std::abs(p[x] - q[x]));
+        }
+    }
+    return largest;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int width = argc > 1 ? std::atoi(argv[1]) : 1280;
+    int height = argc > 2 ? std::atoi(argv[2]) : 720;
+    int runs = argc > 3 ? std::atoi(argv[3]) : 20;
+
+    std::vector<uint8_t> frame = bench::makeSyntheticNv21(width, height, 0);
+    cv::Mat source(height, width, CV_8UC1, frame.data());
+    cv::Mat reference(height, width, CV_8UC1);
+    cv::Mat blurred(height, width, CV_8UC1);
+    ScratchBuffer scratch;
+
+    std::printf("%dx%d, %d runs, mean ms (max difference from cv::GaussianBlur)\n",
+                width, height, runs);
+    std::printf("%7s %6s %10s", "sigma", "kernel", "opencv");
+    for (const auto& engine : kEngines) {
+        std::printf(" %16s", engine.name);
+    }
+    std::printf(" %10s\n", "auto");
+
+    for (double sigma : kSigmas) {
+        int kernelSize = gaussianKernelSize(sigma);
+        cv::Size kernel(kernelSize, kernelSize);
+
+        auto start = bench::Clock::now();
+        for (int i = 0; i < runs; ++i) {
+            cv::GaussianBlur(source, reference, kernel, sigma);
+        }
+        std::printf("%7.1f %6d %10.2f", sigma, kernelSize,
+                    bench::elapsedMs(start, bench::Clock::now()) / runs);
+
+        for (const auto& engine : kEngines) {
+            if (resolveBlurMethod(engine.method, kernelSize, sigma) != engine.method) {
+                std::printf(" %16s", "-");
+                continue;
+            }
+            start = bench::Clock::now();
+            for (int i = 0; i < runs; ++i) {
+                gaussianBlur(source, blurred, kernelSize, sigma, engine.method, scratch);
+            }
+            double ms = bench::elapsedMs(start, bench::Clock::now()) / runs;
+            std::printf(" %10.2f (%3d)", ms, maxDifference(reference, blurred));
+        }
+
+        const char* chosen = "";
+        for (const auto& engine : kEngines) {
+            if (resolveBlurMethod(BLUR_AUTO, kernelSize, sigma) == engine.method) {
+                chosen = engine.name;
+            }
+        }
+        std::printf(" %10s\n", chosen);
+    }
+    return 0;
+}
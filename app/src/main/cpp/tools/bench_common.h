@@ -0,0 +1,88 @@
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+/**
+ * Helpers shared by the host benchmarks
+ */
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+inline double elapsedMs(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+/**
+ * Deterministic NV21 test frame: a gradient with moving boxes and light noise,
+ * so Canny has a realistic amount of edges to trace
+ */
+inline std::vector<uint8_t> makeSyntheticNv21(int width, int height, int frameIndex) {
+    std::vector<uint8_t> frame(static_cast<size_t>(width) * height * 3 / 2);
+    uint32_t seed = 0x9e3779b9u ^ static_cast<uint32_t>(frameIndex);
+
+    for (int y = 0; y < height; ++y) {
+        uint8_t* row = frame.data() + static_cast<size_t>(y) * width;
+        for (int x = 0; x < width; ++x) {
+            seed = seed * 1664525u + 1013904223u;
+            int value = (x * 255 / width + y * 64 / height) / 2 + static_cast<int>(seed >> 29);
+
+            int cx = (x + frameIndex * 4) % 160;
+            int cy = (y + frameIndex * 2) % 120;
+            if (cx > 40 && cx < 120 && cy > 30 && cy < 90) {
+                value += 96;
+            }
+            row[x] = static_cast<uint8_t>(std::min(value, 255));
+        }
+    }
+
+    // Neutral chroma
+    std::fill(frame.begin() + static_cast<size_t>(width) * height, frame.end(), 128);
+    return frame;
+}
+
+/**
+ * Per-frame latency collector
+ */
+class LatencyStats {
+public:
+    void add(double ms) { samples.push_back(ms); }
+
+    size_t count() const { return samples.size(); }
+
+    double percentile(double p) const {
+        if (samples.empty()) {
+            return 0.0;
+        }
+        std::vector<double> sorted(samples);
+        std::sort(sorted.begin(), sorted.end());
+        size_t index = static_cast<size_t>(p / 100.0 * (sorted.size() - 1) + 0.5);
+        return sorted[std::min(index, sorted.size() - 1)];
+    }
+
+    double mean() const {
+        double sum = 0.0;
+        for (double s : samples) {
+            sum += s;
+        }
+        return samples.empty() ? 0.0 : sum / samples.size();
+    }
+
+    void print(const char* label) const {
+        std::printf("%-24s n=%-6zu mean=%7.2f  p50=%7.2f  p90=%7.2f  p99=%7.2f  max=%7.2f ms\n",
+                    label, count(), mean(), percentile(50), percentile(90),
+                    percentile(99), percentile(100));
+    }
+
+private:
+    std::vector<double> samples;
+};
+
+} // namespace bench
+
+#endif // BENCH_COMMON_H
@@ -0,0 +1,98 @@
+/**
+ * Edge-stream codec benchmark
+ *
+ * Runs MODE_CANNY over synthetic frames, encodes the edge masks into an
+ * edge-stream file, decodes them again, verifies the round trip and a few
+ * random seeks, and prints the size ratio against raw RGBA and the mask
+ * encode / decode rates.
+ *
+ * Usage: bench_edge_stream [width] [height] [frames] [keyframeInterval] [path]
+ */
+#include <cstdlib>
+#include <cstring>
+
+#include "../edge_stream.h"
+#include "../opencv_processor.h"
+#include "bench_common.h"
+
+int main(int argc, char** argv) {
+    int width = argc > 1 ? std::atoi(argv[1]) : 1280;
+    int height = argc > 2 ? std::atoi(argv[2]) : 720;
+    int frames = argc > 3 ? std::atoi(argv[3]) : 300;
+    int interval = argc > 4 ? std::atoi(argv[4]) : 60;
+    std::string path = argc > 5 ? argv[5] : "/tmp/bench_edge_stream.edgs";
+
+    OpenCVProcessor processor;
+    if (frames <= 0 || !processor.init(width, height)) {
+        return 1;
+    }
+
+    // Edge masks of a moving scene, kept as RGBA like the processor outputs them
+    size_t rgbaBytes = static_cast<size_t>(width) * height * 4;
+    std::vector<uint8_t> rgba(rgbaBytes * frames);
+    for (int i = 0; i < frames; ++i) {
+        std::vector<uint8_t> input = bench::makeSyntheticNv21(width, height, i);
+        processor.processFrame(input.data(), input.size(), rgba.data() + rgbaBytes * i,
+                               OpenCVProcessor::MODE_CANNY);
+    }
+
+    EdgeStreamWriter writer;
+    if (!writer.open(path, width, height, interval)) {
+        return 1;
+    }
+
+    bench::LatencyStats encode;
+    for (int i = 0; i < frames; ++i) {
+        auto start = bench::Clock::now();
+        writer.addFrame(rgba.data() + rgbaBytes * i, 4, static_cast<size_t>(width) * 4);
+        encode.add(bench::elapsedMs(start, bench::Clock::now()));
+    }
+    if (!writer.close()) {
+        return 1;
+    }
+
+    EdgeStreamReader reader;
+    if (!reader.open(path) || reader.frameCount() != frames) {
+        std::printf("Cannot read back %s\n", path.c_str());
+        return 1;
+    }
+
+    std::vector<uint8_t> mask(static_cast<size_t>(width) * height);
+    bench::LatencyStats decode;
+    int mismatches = 0;
+    for (int i = 0; i < frames; ++i) {
+        auto start = bench::Clock::now();
+        reader.next(mask.data(), width);
+        decode.add(bench::elapsedMs(start, bench::Clock::now()));
+
+        const uint8_t* expected = rgba.data() + rgbaBytes * i;
+        for (size_t p = 0; p < mask.size(); ++p) {
+            if ((mask[p] != 0) != (expected[p * 4] != 0)) {
+                ++mismatches;
+                break;
+            }
+        }
+    }
+
+    // Random access through the index
+    uint32_t seed = 12345;
+    for (int i = 0; i < 10; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        int frame = static_cast<int>(seed % frames);
+        if (!reader.seek(frame) || !reader.next(mask.data(), width) ||
+            (mask[0] != 0) != (rgba[rgbaBytes * frame] != 0)) {
+            ++mismatches;
+        }
+    }
+
+    uint64_t fileBytes = writer.bytesWritten();
+    std::printf("%dx%d, %d frames, keyframe every %d\n", width, height, frames, interval);
+    std::printf("size: %.2f MB vs %.2f MB RGBA (%.1fx), %.2f bits/pixel\n",
+                fileBytes / 1e6, rgbaBytes * frames / 1e6,
+                static_cast<double>(rgbaBytes) * frames / fileBytes,
+                fileBytes * 8.0 / (static_cast<double>(width) * height * frames));
+    encode.print("encode");
+    decode.print("decode");
+    std::printf("round trip: %s\n", mismatches == 0 ? "ok" : "MISMATCH");
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+/**
+ * Edge mode benchmark
+ *
+ * Runs MODE_CANNY and the single-pass edge modes (Sobel, Scharr, LoG) over
+ * synthetic frames, each drawing edge strength and a thresholded mask, and
+ * prints the frame latency distribution with the mean cost relative to
+ * Canny. Canny is then repeated with FAST keypoints on its blurred luma to
+ * show the cost they add. Use it to size the preview tier on a device.
+ *
+ * Usage: bench_modes [width] [height] [frames] [threads] [threshold]
+ */
+#include <cstdlib>
+
+#include "../opencv_processor.h"
+#include "bench_common.h"
+
+namespace {
+
+const struct {
+    OpenCVProcessor::ProcessingMode mode;
+    const char* name;
+} kModes[] = {
+        {OpenCVProcessor::MODE_CANNY, "canny"},
+        {OpenCVProcessor::MODE_SOBEL, "sobel"},
+        {OpenCVProcessor::MODE_SCHARR, "scharr"},
+        {OpenCVProcessor::MODE_LOG, "log"},
+};
+
+bench::LatencyStats runMode(OpenCVProcessor& processor, OpenCVProcessor::ProcessingMode mode,
+                            const std::vector<std::vector<uint8_t>>& inputs,
+                            std::vector<uint8_t>& output, int frames) {
+    for (int i = 0; i < 10; ++i) {
+        processor.processFrame(inputs[i % inputs.size()].data(), inputs[0].size(),
+                               output.data(), mode);
+    }
+
+    bench::LatencyStats stats;
+    for (int i = 0; i < frames; ++i) {
+        const std::vector<uint8_t>& input = inputs[i % inputs.size()];
+        auto start = bench::Clock::now();
+        processor.processFrame(input.data(), input.size(), output.data(), mode);
+        stats.add(bench::elapsedMs(start, bench::Clock::now()));
+    }
+    return stats;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int width = argc > 1 ? std::atoi(argv[1]) : 1280;
+    int height = argc > 2 ? std::atoi(argv[2]) : 720;
+    int frames = argc > 3 ? std::atoi(argv[3]) : 200;
+    int threads = argc > 4 ? std::atoi(argv[4]) : -1;
+    double threshold = argc > 5 ? std::atof(argv[5]) : 150.0;
+
+    OpenCVProcessor processor;
+    if (!processor.init(width, height)) {
+        return 1;
+    }
+    ThreadPoolConfig config;
+    config.threadCount = threads;
+    processor.configureThreads(config);
+
+    std::vector<std::vector<uint8_t>> inputs;
+    for (int i = 0; i < 8; ++i) {
+        inputs.push_back(bench::makeSyntheticNv21(width, height, i));
+    }
+    std::vector<uint8_t> output(static_cast<size_t>(width) * height * 4);
+
+    std::printf("%dx%d, %d frames, threads=%d, mask threshold=%.0f\n",
+                width, height, frames, threads, threshold);
+
+    double cannyMs = 0.0;
+    for (const auto& entry : kModes) {
+        for (double t : {0.0, threshold}) {
+            if (entry.mode == OpenCVProcessor::MODE_CANNY && t == 0.0) {
+                continue;  // Canny always draws a mask
+            }
+            processor.setGradientThreshold(t);
+            bench::LatencyStats stats = runMode(processor, entry.mode, inputs, output, frames);
+
+            char label[32];
+            std::snprintf(label, sizeof(label), "%s %s", entry.name,
+                          t > 0.0 ? "mask" : "strength");
+            stats.print(label);
+            if (entry.mode == OpenCVProcessor::MODE_CANNY) {
+                cannyMs = stats.mean();
+            } else if (cannyMs > 0.0) {
+                std::printf("%24s %.0f%% of canny\n", "", 100.0 * stats.mean() / cannyMs);
+            }
+        }
+    }
+
+    processor.setKeypoints(20, FAST_9, 1000);
+    bench::LatencyStats stats = runMode(processor, OpenCVProcessor::MODE_CANNY, inputs, output,
+                                        frames);
+    stats.print("canny + fast9");
+    if (cannyMs > 0.0) {
+        std::printf("%24s +%.2f ms, %zu keypoints\n", "", stats.mean() - cannyMs,
+                    processor.getKeypoints().size());
+    }
+    return 0;
+}
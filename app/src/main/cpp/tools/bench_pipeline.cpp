@@ -0,0 +1,122 @@
+/**
+ * Pipelined throughput benchmark
+ *
+ * For each resolution, runs MODE_CANNY over synthetic frames through the
+ * serial processFrame() path and through FramePipeline, and prints the
+ * throughput and per-frame latency of both.
+ *
+ * Usage: bench_pipeline [frames] [slots] [threads] [edgeThreads] [WxH ...]
+ */
+#include <cstdlib>
+#include <string>
+
+#include "../frame_pipeline.h"
+#include "bench_common.h"
+
+namespace {
+
+void runResolution(int width, int height, int frames, int slotCount, int threads,
+                   int edgeThreads) {
+    OpenCVProcessor processor;
+    if (!processor.init(width, height)) {
+        return;
+    }
+
+    ThreadPoolConfig config;
+    config.threadCount = threads;
+    processor.configureThreads(config);
+
+    std::vector<std::vector<uint8_t>> inputs;
+    for (int i = 0; i < 8; ++i) {
+        inputs.push_back(bench::makeSyntheticNv21(width, height, i));
+    }
+    size_t outputBytes = static_cast<size_t>(width) * height * 4;
+
+    // One output per slot, reused in submission order as the pipeline would
+    std::vector<std::vector<uint8_t>> outputs(slotCount, std::vector<uint8_t>(outputBytes));
+
+    std::printf("%dx%d, %d frames\n", width, height, frames);
+
+    // Serial path (intra-frame parallelism only)
+    for (int i = 0; i < 10; ++i) {
+        processor.processFrame(inputs[i % inputs.size()].data(), inputs[0].size(),
+                               outputs[0].data(), OpenCVProcessor::MODE_CANNY);
+    }
+
+    bench::LatencyStats serial;
+    auto start = bench::Clock::now();
+    for (int i = 0; i < frames; ++i) {
+        const std::vector<uint8_t>& input = inputs[i % inputs.size()];
+        auto frameStart = bench::Clock::now();
+        processor.processFrame(input.data(), input.size(), outputs[0].data(),
+                               OpenCVProcessor::MODE_CANNY);
+        serial.add(bench::elapsedMs(frameStart, bench::Clock::now()));
+    }
+    double serialMs = bench::elapsedMs(start, bench::Clock::now());
+    serial.print("  serial");
+    std::printf("  serial    %8.1f fps\n", frames * 1000.0 / serialMs);
+
+    // Pipelined path; latency measured from submit to collect
+    FramePipeline pipeline(processor, slotCount, edgeThreads);
+    std::printf("  pipeline: %d threads\n", pipeline.threadCount());
+    std::vector<bench::Clock::time_point> submitTimes(slotCount);
+    bench::LatencyStats pipelined;
+
+    start = bench::Clock::now();
+    for (int i = 0; i < frames; ++i) {
+        if (pipeline.inFlight() == slotCount) {
+            pipeline.collect(nullptr, nullptr);
+            pipelined.add(bench::elapsedMs(submitTimes[(i - slotCount) % slotCount],
+                                           bench::Clock::now()));
+        }
+
+        const std::vector<uint8_t>& input = inputs[i % inputs.size()];
+        submitTimes[i % slotCount] = bench::Clock::now();
+        pipeline.submit(input.data(), input.size(), outputs[i % slotCount].data(),
+                        OpenCVProcessor::MODE_CANNY);
+    }
+    for (int i = frames - pipeline.inFlight(); i < frames; ++i) {
+        pipeline.collect(nullptr, nullptr);
+        pipelined.add(bench::elapsedMs(submitTimes[i % slotCount], bench::Clock::now()));
+    }
+    double pipelinedMs = bench::elapsedMs(start, bench::Clock::now());
+    pipelined.print("  pipeline");
+    std::printf("  pipeline  %8.1f fps (%.2fx)\n", frames * 1000.0 / pipelinedMs,
+                serialMs / pipelinedMs);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int frames = argc > 1 ? std::atoi(argv[1]) : 300;
+    int threads = argc > 3 ? std::atoi(argv[3]) : 0;
+    int edgeThreads = argc > 4 ? std::atoi(argv[4]) : 1;
+    int slotCount = argc > 2 ? std::atoi(argv[2])
+                             : FramePipeline::stageCount() + edgeThreads + 1;
+
+    std::vector<std::string> sizes;
+    for (int i = 5; i < argc; ++i) {
+        sizes.push_back(argv[i]);
+    }
+    if (sizes.empty()) {
+        sizes = {"640x480", "1280x720", "1920x1080"};
+    }
+
+    if (frames <= 0 || slotCount <= 0 || edgeThreads <= 0) {
+        return 1;
+    }
+
+    // Rounded like the pipeline does, so every slot gets an output buffer
+    slotCount = (slotCount + edgeThreads - 1) / edgeThreads * edgeThreads;
+
+    for (const std::string& size : sizes) {
+        int width = 0;
+        int height = 0;
+        if (std::sscanf(size.c_str(), "%dx%d", &width, &height) != 2) {
+            std::printf("Bad size: %s\n", size.c_str());
+            continue;
+        }
+        runResolution(width, height, frames, slotCount, threads, edgeThreads);
+    }
+    return 0;
+}
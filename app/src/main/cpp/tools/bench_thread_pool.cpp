@@ -0,0 +1,95 @@
+/**
+ * Thread pool benchmark
+ *
+ * Runs MODE_CANNY over synthetic frames with the processor's worker threads
+ * unpinned and then pinned to the performance cores, and prints the frame
+ * latency distribution for both. Optional busy "load" threads stand in for
+ * the camera HAL and other work competing for the same cores.
+ *
+ * Usage: bench_thread_pool [width] [height] [frames] [threads] [load] [maskHex]
+ */
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+
+#include "../opencv_processor.h"
+#include "bench_common.h"
+
+namespace {
+
+bench::LatencyStats runCanny(OpenCVProcessor& processor, const ThreadPoolConfig& config,
+                             int width, int height, int frames) {
+    processor.configureThreads(config);
+
+    std::vector<std::vector<uint8_t>> inputs;
+    for (int i = 0; i < 8; ++i) {
+        inputs.push_back(bench::makeSyntheticNv21(width, height, i));
+    }
+    std::vector<uint8_t> output(static_cast<size_t>(width) * height * 4);
+
+    // Warm-up also applies the new thread configuration
+    for (int i = 0; i < 10; ++i) {
+        processor.processFrame(inputs[i % inputs.size()].data(), inputs[0].size(),
+                               output.data(), OpenCVProcessor::MODE_CANNY);
+    }
+
+    bench::LatencyStats stats;
+    for (int i = 0; i < frames; ++i) {
+        const std::vector<uint8_t>& input = inputs[i % inputs.size()];
+        auto start = bench::Clock::now();
+        processor.processFrame(input.data(), input.size(), output.data(),
+                               OpenCVProcessor::MODE_CANNY);
+        stats.add(bench::elapsedMs(start, bench::Clock::now()));
+    }
+    return stats;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int width = argc > 1 ? std::atoi(argv[1]) : 1920;
+    int height = argc > 2 ? std::atoi(argv[2]) : 1080;
+    int frames = argc > 3 ? std::atoi(argv[3]) : 300;
+    int threads = argc > 4 ? std::atoi(argv[4]) : 0;
+    int loadThreads = argc > 5 ? std::atoi(argv[5]) : 0;
+    uint64_t mask = argc > 6 ? std::strtoull(argv[6], nullptr, 16)
+                             : ThreadPool::performanceCoreMask();
+
+    OpenCVProcessor processor;
+    if (!processor.init(width, height)) {
+        return 1;
+    }
+
+    std::atomic<bool> stopLoad(false);
+    std::vector<std::thread> load;
+    for (int i = 0; i < loadThreads; ++i) {
+        load.emplace_back([&stopLoad] {
+            volatile uint64_t sink = 0;
+            while (!stopLoad.load(std::memory_order_relaxed)) {
+                sink = sink + 1;
+            }
+        });
+    }
+
+    std::printf("%dx%d, %d frames, threads=%d, load=%d, pin mask=0x%llx\n",
+                width, height, frames, threads, loadThreads,
+                static_cast<unsigned long long>(mask));
+
+    ThreadPoolConfig unpinned;
+    unpinned.threadCount = threads;
+    runCanny(processor, unpinned, width, height, frames).print("canny unpinned");
+
+    if (mask != 0) {
+        ThreadPoolConfig pinned = unpinned;
+        pinned.affinityMasks.push_back(mask);
+        runCanny(processor, pinned, width, height, frames).print("canny pinned");
+    } else {
+        std::printf("CPU topology unknown, skipping pinned run\n");
+    }
+
+    stopLoad = true;
+    for (std::thread& t : load) {
+        t.join();
+    }
+    return 0;
+}
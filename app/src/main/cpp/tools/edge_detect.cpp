@@ -0,0 +1,639 @@
+/**
+ * Headless batch edge detection
+ *
+ * Runs the app's edge pipeline over archived footage: image files (PNG,
+ * JPEG, BMP) and raw YUV sequence files, given directly or found in
+ * directories. A reader thread loads input files, N workers each decode,
+ * drive their own OpenCVProcessor and encode, and a writer thread stores the
+ * results, so disk I/O overlaps with compute and the I/O threads never spend
+ * time in codecs. Work items come from a fixed pool, which bounds the memory
+ * in flight and makes the reader wait when the workers fall behind.
+ *
+ * Usage: edge_detect [options] <file|directory>...
+ *   --output DIR      Write results to DIR (default: process only)
+ *   --size WxH        Frame size of raw sequence files (.yuv/.nv21/.i420)
+ *   --i420            Raw sequences are I420 (.i420 files always are)
+ *   --mode N          0 = raw, 1 = grayscale, 2 = canny (default), 3 = sobel,
+ *                     4 = scharr, 5 = Laplacian of Gaussian
+ *   --workers N       Processor instances (default: online CPUs)
+ *   --threads N       Worker threads inside each processor (default: none)
+ *   --queue N         Work items in flight (default: 4 per worker)
+ *   --segments N      Also extract line segments of at least N pixels (canny)
+ *   --polylines T     Also trace polylines at tolerance T pixels (canny)
+ *   --keypoints N     Also detect up to N FAST-9 corners per frame (canny)
+ *
+ * Images are written as PNG, sequences as raw RGBA sequence files; a frame
+ * that fails is written blank so later frames keep their place. Line
+ * segments go to <output>.segments, one "frame x1 y1 x2 y2 strength" line
+ * per segment, polylines to <output>.polylines, one "frame x0 y0 x1 y1 ..."
+ * line per polyline, keypoints to <output>.keypoints ("frame x y score").
+ */
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <dirent.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+
+#include "../frame_io.h"
+#include "../opencv_processor.h"
+#include "bench_common.h"
+
+namespace {
+
+// Vertex capacity per frame with --polylines
+const int kMaxPolylineVertices = 1 << 16;
+
+// FAST threshold with --keypoints
+const int kKeypointThreshold = 20;
+
+/**
+ * Unbounded FIFO that can be closed; the item pool bounds its length
+ */
+template <typename T>
+class BlockingQueue {
+public:
+    BlockingQueue() : closed(false) {}
+
+    void push(T value) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            items.push_back(value);
+        }
+        ready.notify_one();
+    }
+
+    // false once the queue is closed and drained
+    bool pop(T& value) {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [this] { return closed || !items.empty(); });
+        if (items.empty()) {
+            return false;
+        }
+        value = items.front();
+        items.pop_front();
+        return true;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        ready.notify_all();
+    }
+
+private:
+    std::deque<T> items;
+    bool closed;
+    std::mutex mutex;
+    std::condition_variable ready;
+};
+
+struct Options {
+    std::vector<std::string> inputs;
+    std::string outputDir;
+    int width = 0;
+    int height = 0;
+    bool i420 = false;
+    OpenCVProcessor::ProcessingMode mode = OpenCVProcessor::MODE_CANNY;
+    int workers = 0;
+    int threads = -1;
+    int queueDepth = 0;
+    int segments = 0;
+    double polylines = -1.0;  // Tolerance; < 0 = off
+    int keypoints = 0;
+};
+
+/**
+ * One input: an image file or a raw sequence
+ */
+struct Job {
+    std::string path;
+    std::string outputPath;
+    bool sequence;
+    FrameFormat format;
+    int width = 0;   // Sequences only; images carry their size per item
+    int height = 0;
+    int frames = 0;
+
+    // Sequence output; frames may finish out of order
+    std::unique_ptr<FrameSink> sink;
+    int nextFrame = 0;
+
+    // Geometry text output (--segments, --polylines)
+    std::FILE* segmentsFile = nullptr;
+    std::FILE* polylinesFile = nullptr;
+    std::FILE* keypointsFile = nullptr;
+};
+
+/**
+ * One frame travelling reader -> worker -> writer
+ */
+struct Item {
+    Job* job;
+    int frame;
+    int width;
+    int height;
+    std::vector<uint8_t> encoded;  // Image file bytes in, PNG bytes out
+    std::vector<uint8_t> yuv;
+    std::vector<uint8_t> rgba;
+    std::vector<LineSegment> segments;
+    PolylineSet polylines;
+    std::vector<Keypoint> keypoints;
+    bench::Clock::time_point readTime;
+    double processMs;
+    bool ok;
+};
+
+bool hasSuffix(const std::string& name, const char* suffix) {
+    size_t length = std::strlen(suffix);
+    if (name.size() < length) {
+        return false;
+    }
+    std::string tail = name.substr(name.size() - length);
+    std::transform(tail.begin(), tail.end(), tail.begin(), ::tolower);
+    return tail == suffix;
+}
+
+std::string baseName(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    size_t dot = name.find_last_of('.');
+    return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+bool addFile(const std::string& path, const Options& options,
+             std::vector<std::unique_ptr<Job>>& jobs) {
+    std::unique_ptr<Job> job(new Job());
+    job->path = path;
+
+    if (hasSuffix(path, ".yuv") || hasSuffix(path, ".nv21") || hasSuffix(path, ".i420")) {
+        if (options.width <= 0 || options.height <= 0) {
+            std::fprintf(stderr, "Skipping %s: raw sequences need --size\n", path.c_str());
+            return false;
+        }
+        job->sequence = true;
+        job->width = options.width;
+        job->height = options.height;
+        job->format = options.i420 || hasSuffix(path, ".i420") ? FRAME_I420 : FRAME_NV21;
+        job->outputPath = options.outputDir + "/" + baseName(path) + ".rgba";
+    } else if (hasSuffix(path, ".png") || hasSuffix(path, ".jpg") ||
+               hasSuffix(path, ".jpeg") || hasSuffix(path, ".bmp")) {
+        job->sequence = false;
+        job->format = FRAME_NV21;
+        job->outputPath = options.outputDir + "/" + baseName(path) + ".png";
+    } else {
+        return false;
+    }
+
+    jobs.push_back(std::move(job));
+    return true;
+}
+
+void collectJobs(const Options& options, std::vector<std::unique_ptr<Job>>& jobs) {
+    for (const std::string& input : options.inputs) {
+        struct stat info;
+        if (stat(input.c_str(), &info) != 0) {
+            std::fprintf(stderr, "Cannot access %s\n", input.c_str());
+            continue;
+        }
+
+        if (!S_ISDIR(info.st_mode)) {
+            if (!addFile(input, options, jobs)) {
+                std::fprintf(stderr, "Skipping %s: unknown file type\n", input.c_str());
+            }
+            continue;
+        }
+
+        // Directory entries in name order, so runs are repeatable
+        std::vector<std::string> names;
+        if (DIR* dir = opendir(input.c_str())) {
+            while (dirent* entry = readdir(dir)) {
+                if (entry->d_name[0] != '.') {
+                    names.push_back(entry->d_name);
+                }
+            }
+            closedir(dir);
+        }
+        std::sort(names.begin(), names.end());
+
+        for (const std::string& name : names) {
+            addFile(input + "/" + name, options, jobs);
+        }
+    }
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--output" && hasValue) {
+            options.outputDir = argv[++i];
+        } else if (arg == "--size" && hasValue) {
+            if (std::sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2) {
+                return false;
+            }
+        } else if (arg == "--i420") {
+            options.i420 = true;
+        } else if (arg == "--mode" && hasValue) {
+            options.mode = static_cast<OpenCVProcessor::ProcessingMode>(std::atoi(argv[++i]));
+        } else if (arg == "--workers" && hasValue) {
+            options.workers = std::atoi(argv[++i]);
+        } else if (arg == "--threads" && hasValue) {
+            options.threads = std::atoi(argv[++i]);
+        } else if (arg == "--queue" && hasValue) {
+            options.queueDepth = std::atoi(argv[++i]);
+        } else if (arg == "--segments" && hasValue) {
+            options.segments = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--polylines" && hasValue) {
+            options.polylines = std::atof(argv[++i]);
+        } else if (arg == "--keypoints" && hasValue) {
+            options.keypoints = std::max(0, std::atoi(argv[++i]));
+        } else if (arg.compare(0, 2, "--") == 0) {
+            std::fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+            return false;
+        } else {
+            options.inputs.push_back(arg);
+        }
+    }
+
+    if (options.workers <= 0) {
+        options.workers = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+    if (options.queueDepth <= 0) {
+        options.queueDepth = options.workers * 4;
+    }
+    return !options.inputs.empty();
+}
+
+bool readFile(const std::string& path, std::vector<uint8_t>& data) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    bool ok = std::fseek(file, 0, SEEK_END) == 0;
+    long size = ok ? std::ftell(file) : -1;
+    ok = size > 0 && std::fseek(file, 0, SEEK_SET) == 0;
+    if (ok) {
+        data.resize(static_cast<size_t>(size));
+        ok = std::fread(data.data(), 1, data.size(), file) == data.size();
+    }
+    std::fclose(file);
+    return ok;
+}
+
+bool writeFile(const std::string& path, const std::vector<uint8_t>& data) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool ok = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+    return std::fclose(file) == 0 && ok;
+}
+
+/**
+ * Decode the image file bytes in item.encoded into an even-sized NV21 frame
+ */
+bool decodeImage(Item& item) {
+    cv::Mat image = cv::imdecode(item.encoded, cv::IMREAD_COLOR);
+    if (image.empty()) {
+        return false;
+    }
+
+    // 4:2:0 needs even dimensions
+    image = image(cv::Rect(0, 0, image.cols & ~1, image.rows & ~1));
+    if (image.empty()) {
+        return false;
+    }
+
+    cv::Mat i420;
+    cv::cvtColor(image, i420, cv::COLOR_BGR2YUV_I420);
+
+    item.width = image.cols;
+    item.height = image.rows;
+    item.yuv.resize(static_cast<size_t>(item.width) * item.height * 3 / 2);
+    convertI420ToNv21(i420.ptr(), item.yuv.data(), item.width, item.height);
+    return true;
+}
+
+void readerLoop(std::vector<std::unique_ptr<Job>>& jobs, BlockingQueue<Item*>& freeItems,
+                BlockingQueue<Item*>& work, std::atomic<int>& failures) {
+    for (auto& job : jobs) {
+        if (!job->sequence) {
+            Item* item = nullptr;
+            freeItems.pop(item);
+            item->job = job.get();
+            item->frame = 0;
+            item->readTime = bench::Clock::now();
+            if (readFile(job->path, item->encoded)) {
+                job->frames = 1;
+                work.push(item);
+            } else {
+                std::fprintf(stderr, "Cannot read %s\n", job->path.c_str());
+                ++failures;
+                freeItems.push(item);
+            }
+            continue;
+        }
+
+        FrameSource source;
+        if (!source.open(job->path, job->width, job->height, job->format, ACCESS_MMAP)) {
+            std::fprintf(stderr, "Cannot read %s\n", job->path.c_str());
+            ++failures;
+            continue;
+        }
+
+        // The writer sizes the output from the frame count before the first frame lands
+        job->frames = source.frameCount();
+        for (int frame = 0; const uint8_t* yuv = source.next(); ++frame) {
+            Item* item = nullptr;
+            freeItems.pop(item);
+            item->job = job.get();
+            item->frame = frame;
+            item->width = job->width;
+            item->height = job->height;
+            item->readTime = bench::Clock::now();
+            item->yuv.assign(yuv, yuv + source.frameBytes());
+            work.push(item);
+        }
+    }
+    work.close();
+}
+
+void workerLoop(const Options& options, BlockingQueue<Item*>& work,
+                BlockingQueue<Item*>& done) {
+    OpenCVProcessor processor;
+    ThreadPoolConfig config;
+    config.threadCount = options.threads;
+    processor.configureThreads(config);
+    processor.setLineSegments(options.segments);
+    if (options.polylines >= 0.0) {
+        processor.setPolylines(options.polylines, kMaxPolylineVertices);
+    }
+    if (options.keypoints > 0) {
+        processor.setKeypoints(kKeypointThreshold, FAST_9, options.keypoints);
+    }
+
+    Item* item = nullptr;
+    while (work.pop(item)) {
+        bool image = !item->job->sequence;
+        if (image && !decodeImage(*item)) {
+            std::fprintf(stderr, "Cannot decode %s\n", item->job->path.c_str());
+            item->yuv.clear();
+            item->processMs = 0.0;
+            item->ok = false;
+            done.push(item);
+            continue;
+        }
+
+        auto start = bench::Clock::now();
+
+        // init() is a no-op while the size stays the same
+        item->rgba.resize(static_cast<size_t>(item->width) * item->height * 4);
+        item->ok = processor.init(item->width, item->height) &&
+                   processor.processFrame(item->yuv.data(), item->yuv.size(),
+                                          item->rgba.data(), options.mode);
+        if (options.segments > 0) {
+            item->segments = processor.getLineSegments();
+        }
+        if (options.polylines >= 0.0) {
+            processor.getPolylines(item->polylines);
+        }
+        if (options.keypoints > 0) {
+            item->keypoints = processor.getKeypoints();
+        }
+
+        item->processMs = bench::elapsedMs(start, bench::Clock::now());
+
+        if (!item->ok) {
+            // Written blank so the sequence file keeps every later frame in place
+            std::fill(item->rgba.begin(), item->rgba.end(), 0);
+            item->segments.clear();
+            item->polylines = PolylineSet();
+            item->keypoints.clear();
+        } else if (image && !options.outputDir.empty()) {
+            cv::Mat rgba(item->height, item->width, CV_8UC4, item->rgba.data());
+            cv::Mat bgr;
+            cv::cvtColor(rgba, bgr, cv::COLOR_RGBA2BGR);
+            item->ok = cv::imencode(".png", bgr, item->encoded);
+        }
+        done.push(item);
+    }
+}
+
+// Text file next to the job's output, opened with its first frame
+bool openText(const Job& job, const char* suffix, std::FILE*& file) {
+    if (!file) {
+        std::string path = job.outputPath + suffix;
+        file = std::fopen(path.c_str(), "w");
+    }
+    return file != nullptr;
+}
+
+// Closed after the job's last frame (frames arrive in order)
+bool finishText(const Job& job, const Item& item, std::FILE*& file) {
+    if (item.frame + 1 == job.frames) {
+        bool ok = std::fclose(file) == 0;
+        file = nullptr;
+        return ok;
+    }
+    return !std::ferror(file);
+}
+
+bool writeSegments(Job& job, const Item& item) {
+    if (!openText(job, ".segments", job.segmentsFile)) {
+        return false;
+    }
+    for (const LineSegment& s : item.segments) {
+        std::fprintf(job.segmentsFile, "%d %.2f %.2f %.2f %.2f %.1f\n", item.frame,
+                     s.x1, s.y1, s.x2, s.y2, s.strength);
+    }
+    return finishText(job, item, job.segmentsFile);
+}
+
+bool writePolylines(Job& job, const Item& item) {
+    if (!openText(job, ".polylines", job.polylinesFile)) {
+        return false;
+    }
+    const PolylineSet& polylines = item.polylines;
+    for (int i = 0; i < polylines.count(); ++i) {
+        std::fprintf(job.polylinesFile, "%d", item.frame);
+        for (int v = polylines.offsets[i]; v < polylines.offsets[i + 1]; ++v) {
+            std::fprintf(job.polylinesFile, " %.1f %.1f", polylines.vertices[2 * v],
+                         polylines.vertices[2 * v + 1]);
+        }
+        std::fputc('\n', job.polylinesFile);
+    }
+    return finishText(job, item, job.polylinesFile);
+}
+
+bool writeKeypoints(Job& job, const Item& item) {
+    if (!openText(job, ".keypoints", job.keypointsFile)) {
+        return false;
+    }
+    for (const Keypoint& k : item.keypoints) {
+        std::fprintf(job.keypointsFile, "%d %.1f %.1f %.0f\n", item.frame, k.x, k.y, k.score);
+    }
+    return finishText(job, item, job.keypointsFile);
+}
+
+bool writeItem(const Options& options, Item& item) {
+    Job& job = *item.job;
+    if (options.outputDir.empty()) {
+        return true;
+    }
+
+    if (options.segments > 0 && !writeSegments(job, item)) {
+        return false;
+    }
+    if (options.polylines >= 0.0 && !writePolylines(job, item)) {
+        return false;
+    }
+    if (options.keypoints > 0 && !writeKeypoints(job, item)) {
+        return false;
+    }
+
+    if (!job.sequence) {
+        return writeFile(job.outputPath, item.encoded);
+    }
+
+    if (!job.sink) {
+        job.sink.reset(new FrameSink());
+        if (!job.sink->open(job.outputPath, item.rgba.size(), ACCESS_MMAP, job.frames)) {
+            return false;
+        }
+    }
+
+    uint8_t* target = job.sink->acquire();
+    if (!target) {
+        return false;
+    }
+    std::memcpy(target, item.rgba.data(), item.rgba.size());
+    job.sink->commit();
+
+    if (job.sink->frameCount() == job.frames) {
+        job.sink->close();
+    }
+    return true;
+}
+
+void writerLoop(const Options& options, BlockingQueue<Item*>& done,
+                BlockingQueue<Item*>& freeItems, std::atomic<int>& failures,
+                bench::LatencyStats& processStats, bench::LatencyStats& endToEndStats,
+                size_t& bytesIn) {
+    // Sequence frames that arrived ahead of their predecessors
+    std::map<std::pair<Job*, int>, Item*> parked;
+
+    Item* item = nullptr;
+    while (done.pop(item)) {
+        parked[std::make_pair(item->job, item->frame)] = item;
+
+        Job* job = item->job;
+        auto next = parked.find(std::make_pair(job, job->nextFrame));
+        while (next != parked.end()) {
+            Item* ready = next->second;
+            parked.erase(next);
+
+            // Failed images have nothing to store; failed sequence frames arrive blank
+            bool written = (ready->ok || job->sequence) && writeItem(options, *ready);
+            if (!ready->ok || !written) {
+                std::fprintf(stderr, "Failed: %s frame %d\n", job->path.c_str(), ready->frame);
+                ++failures;
+            }
+
+            processStats.add(ready->processMs);
+            endToEndStats.add(bench::elapsedMs(ready->readTime, bench::Clock::now()));
+            bytesIn += ready->yuv.size();
+            freeItems.push(ready);
+
+            // Images are single-frame jobs; only sequences keep an order
+            if (!job->sequence) {
+                break;
+            }
+            ++job->nextFrame;
+            next = parked.find(std::make_pair(job, job->nextFrame));
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::fprintf(stderr,
+                     "Usage: %s [--output DIR] [--size WxH] [--i420] [--mode N] [--workers N]\n"
+                     "       [--threads N] [--queue N] [--segments N] [--polylines T]\n"
+                     "       [--keypoints N]\n"
+                     "       <file|directory>...\n", argv[0]);
+        return 2;
+    }
+
+    if (!options.outputDir.empty()) {
+        mkdir(options.outputDir.c_str(), 0755);
+    }
+
+    std::vector<std::unique_ptr<Job>> jobs;
+    collectJobs(options, jobs);
+    if (jobs.empty()) {
+        std::fprintf(stderr, "No inputs to process\n");
+        return 1;
+    }
+
+    std::printf("%zu inputs, %d workers x %d threads, %d items in flight, mode %d\n",
+                jobs.size(), options.workers, std::max(0, options.threads) + 1,
+                options.queueDepth, options.mode);
+
+    std::vector<Item> items(options.queueDepth);
+    BlockingQueue<Item*> freeItems;
+    BlockingQueue<Item*> work;
+    BlockingQueue<Item*> done;
+    for (Item& item : items) {
+        freeItems.push(&item);
+    }
+
+    std::atomic<int> failures(0);
+    bench::LatencyStats processStats;
+    bench::LatencyStats endToEndStats;
+    size_t bytesIn = 0;
+
+    auto start = bench::Clock::now();
+
+    std::thread reader(readerLoop, std::ref(jobs), std::ref(freeItems), std::ref(work),
+                       std::ref(failures));
+    std::thread writer(writerLoop, std::cref(options), std::ref(done), std::ref(freeItems),
+                       std::ref(failures), std::ref(processStats), std::ref(endToEndStats),
+                       std::ref(bytesIn));
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < options.workers; ++i) {
+        workers.emplace_back(workerLoop, std::cref(options), std::ref(work), std::ref(done));
+    }
+
+    reader.join();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    done.close();
+    writer.join();
+
+    double totalMs = bench::elapsedMs(start, bench::Clock::now());
+    size_t frames = processStats.count();
+
+    processStats.print("process");
+    endToEndStats.print("read to written");
+    std::printf("%zu frames in %.1f ms: %.1f fps, %.1f MB/s in, %d failed\n", frames, totalMs,
+                frames * 1000.0 / totalMs, bytesIn / 1e6 / (totalMs / 1000.0),
+                failures.load());
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,216 @@
+/**
+ * Headless replay of raw YUV captures
+ *
+ * Drives OpenCVProcessor over an NV21 or I420 sequence file, either as fast
+ * as possible or paced to a fixed frame rate, optionally writing the RGBA
+ * output to another sequence file. Processing is deterministic, so the same
+ * input and options reproduce the same output bit for bit.
+ *
+ * Usage: replay <input.yuv> <width> <height> [options]
+ *   --i420            Input frames are I420 (default NV21)
+ *   --stream          Read/write through buffer rings instead of mmap
+ *   --mode N          0 = raw, 1 = grayscale, 2 = canny (default), 3 = sobel,
+ *                     4 = scharr, 5 = Laplacian of Gaussian
+ *   --fps N           Pace to N frames per second (default: max speed)
+ *   --loops N         Replay the file N times (default 1)
+ *   --threads N       Processor worker threads (default: online CPUs - 1)
+ *   --output PATH     Write RGBA frames to PATH
+ *   --serve PORT      Stream frames to the web viewer on ws://127.0.0.1:PORT
+ *   --shm NAME        Render into the shared-memory ring NAME (e.g. /edge_frames)
+ *                     for other processes (copied there when --output is given)
+ */
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "../frame_io.h"
+#include "../opencv_processor.h"
+#include "../shm_ring.h"
+#include "../stream_server.h"
+#include "bench_common.h"
+
+namespace {
+
+struct Options {
+    std::string input;
+    std::string output;
+    std::string shmName;
+    int width = 0;
+    int height = 0;
+    FrameFormat format = FRAME_NV21;
+    FrameAccess access = ACCESS_MMAP;
+    OpenCVProcessor::ProcessingMode mode = OpenCVProcessor::MODE_CANNY;
+    double fps = 0.0;
+    int loops = 1;
+    int threads = 0;
+    int servePort = 0;
+};
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    if (argc < 4) {
+        return false;
+    }
+
+    options.input = argv[1];
+    options.width = std::atoi(argv[2]);
+    options.height = std::atoi(argv[3]);
+
+    for (int i = 4; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--i420") {
+            options.format = FRAME_I420;
+        } else if (arg == "--stream") {
+            options.access = ACCESS_STREAM;
+        } else if (arg == "--mode" && hasValue) {
+            options.mode = static_cast<OpenCVProcessor::ProcessingMode>(std::atoi(argv[++i]));
+        } else if (arg == "--fps" && hasValue) {
+            options.fps = std::atof(argv[++i]);
+        } else if (arg == "--loops" && hasValue) {
+            options.loops = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--threads" && hasValue) {
+            options.threads = std::atoi(argv[++i]);
+        } else if (arg == "--output" && hasValue) {
+            options.output = argv[++i];
+        } else if (arg == "--shm" && hasValue) {
+            options.shmName = argv[++i];
+        } else if (arg == "--serve" && hasValue) {
+            options.servePort = std::atoi(argv[++i]);
+        } else {
+            std::fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+            return false;
+        }
+    }
+
+    return options.width > 0 && options.height > 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::fprintf(stderr,
+                     "Usage: %s <input.yuv> <width> <height> [--i420] [--stream] [--mode N]\n"
+                     "       [--fps N] [--loops N] [--threads N] [--output PATH]\n"
+                     "       [--serve PORT] [--shm NAME]\n", argv[0]);
+        return 2;
+    }
+
+    FrameSource source;
+    if (!source.open(options.input, options.width, options.height, options.format,
+                     options.access)) {
+        std::fprintf(stderr, "Cannot read %s as %dx%d frames\n", options.input.c_str(),
+                     options.width, options.height);
+        return 1;
+    }
+
+    OpenCVProcessor processor;
+    if (!processor.init(options.width, options.height)) {
+        return 1;
+    }
+
+    ThreadPoolConfig config;
+    config.threadCount = options.threads;
+    processor.configureThreads(config);
+
+    size_t outputBytes = static_cast<size_t>(options.width) * options.height * 4;
+    int totalFrames = source.frameCount() * options.loops;
+
+    FrameSink sink;
+    bool writeOutput = !options.output.empty();
+    if (writeOutput && !sink.open(options.output, outputBytes, options.access, totalFrames)) {
+        std::fprintf(stderr, "Cannot write %s\n", options.output.c_str());
+        return 1;
+    }
+    std::vector<uint8_t> scratchOutput(writeOutput ? 0 : outputBytes);
+
+    ShmFrameWriter ring;
+    bool shareOutput = !options.shmName.empty();
+    if (shareOutput && !ring.create(options.shmName, options.width, options.height, 4)) {
+        std::fprintf(stderr, "Cannot create shared ring %s\n", options.shmName.c_str());
+        return 1;
+    }
+
+    StreamServer server;
+    if (options.servePort > 0 && !server.start(options.servePort)) {
+        std::fprintf(stderr, "Cannot serve on port %d\n", options.servePort);
+        return 1;
+    }
+
+    std::printf("%s: %d frames %dx%d %s, mode %d, %s, %d loop(s)\n", options.input.c_str(),
+                source.frameCount(), options.width, options.height,
+                options.format == FRAME_I420 ? "I420" : "NV21", options.mode,
+                options.fps > 0.0 ? "paced" : "max speed", options.loops);
+
+    bench::LatencyStats latency;
+    int failures = 0;
+    auto period = std::chrono::duration_cast<bench::Clock::duration>(
+            std::chrono::duration<double>(options.fps > 0.0 ? 1.0 / options.fps : 0.0));
+    auto start = bench::Clock::now();
+
+    for (int loop = 0, frame = 0; loop < options.loops; ++loop) {
+        if (loop > 0) {
+            source.rewind();
+        }
+
+        while (const uint8_t* yuv = source.next()) {
+            if (options.fps > 0.0) {
+                std::this_thread::sleep_until(start + period * frame);
+            }
+
+            uint8_t* output = writeOutput ? sink.acquire() : scratchOutput.data();
+            if (!output) {
+                std::fprintf(stderr, "Output sink failed at frame %d\n", frame);
+                return 1;
+            }
+
+            // Readers pinning every slot: the frame still gets processed, not shared
+            uint8_t* shared = shareOutput ? ring.acquire() : nullptr;
+            if (shared && !writeOutput) {
+                output = shared;
+            }
+
+            auto frameStart = bench::Clock::now();
+            if (!processor.processFrame(yuv, source.frameBytes(), output, options.mode)) {
+                ++failures;
+            }
+            latency.add(bench::elapsedMs(frameStart, bench::Clock::now()));
+
+            if (shared) {
+                if (shared != output) {
+                    std::memcpy(shared, output, outputBytes);
+                }
+                ring.commit(options.mode);
+            }
+
+            if (options.servePort > 0) {
+                server.publish(output, options.width, options.height, options.mode,
+                               processor.getStats());
+            }
+
+            if (writeOutput) {
+                sink.commit();
+            }
+            ++frame;
+        }
+    }
+
+    double totalMs = bench::elapsedMs(start, bench::Clock::now());
+    if (writeOutput && !sink.close()) {
+        std::fprintf(stderr, "Writing %s failed\n", options.output.c_str());
+        return 1;
+    }
+
+    latency.print("process");
+    std::printf("%zu frames in %.1f ms: %.1f fps, %d failed\n", latency.count(), totalMs,
+                latency.count() * 1000.0 / totalMs, failures);
+    if (shareOutput) {
+        std::printf("shared ring: %llu frames committed, %llu dropped (all slots pinned)\n",
+                    static_cast<unsigned long long>(ring.framesCommitted()),
+                    static_cast<unsigned long long>(ring.framesDropped()));
+    }
+    return failures == 0 ? 0 : 1;
+}
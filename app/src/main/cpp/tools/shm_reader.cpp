@@ -0,0 +1,105 @@
+/**
+ * Shared-memory ring consumer
+ *
+ * Maps the ring a `replay --shm NAME` process renders into and takes the
+ * newest frames in place, as a visualization or recording process would.
+ * Prints the commit-to-pickup latency and how many frames were skipped; run
+ * several at once to see that every reader works on the same mapping.
+ *
+ * Usage: shm_reader <name> [--frames N] [--hold MS] [--timeout MS]
+ *   --frames N     Stop after N frames (default: until the writer goes quiet)
+ *   --hold MS      Keep each frame pinned for MS milliseconds (a slow consumer)
+ *   --timeout MS   Give up after MS without a new frame (default 2000)
+ */
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+
+#include "../shm_ring.h"
+#include "bench_common.h"
+
+namespace {
+
+uint64_t monotonicNs() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ull + now.tv_nsec;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "Usage: %s <name> [--frames N] [--hold MS] [--timeout MS]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    std::string name = argv[1];
+    int maxFrames = 0;
+    int holdMs = 0;
+    int timeoutMs = 2000;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--frames") {
+            maxFrames = std::atoi(argv[i + 1]);
+        } else if (arg == "--hold") {
+            holdMs = std::atoi(argv[i + 1]);
+        } else if (arg == "--timeout") {
+            timeoutMs = std::atoi(argv[i + 1]);
+        } else {
+            std::fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+            return 2;
+        }
+    }
+
+    // The writer may not have created the ring yet
+    ShmFrameReader reader;
+    auto openDeadline = bench::Clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (!reader.open(name)) {
+        if (bench::Clock::now() > openDeadline) {
+            std::fprintf(stderr, "Cannot open ring %s\n", name.c_str());
+            return 1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    std::printf("%s: %dx%d\n", name.c_str(), reader.getWidth(), reader.getHeight());
+
+    bench::LatencyStats pickup;
+    uint64_t skipped = 0;
+    uint64_t edgePixels = 0;
+    ShmFrameInfo info;
+
+    while (maxFrames <= 0 || static_cast<int>(pickup.count()) < maxFrames) {
+        const uint8_t* pixels = reader.acquire(timeoutMs, info);
+        if (!pixels) {
+            break;
+        }
+        pickup.add((monotonicNs() - info.timestampNs) / 1e6);
+        skipped += info.skipped;
+
+        // Touch the frame where it lies, as a consumer would
+        size_t count = static_cast<size_t>(info.width) * info.height;
+        for (size_t i = 0; i < count; ++i) {
+            edgePixels += pixels[i * 4] != 0;
+        }
+
+        if (holdMs > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(holdMs));
+        }
+        reader.release();
+    }
+
+    pickup.print("commit to pickup");
+    std::printf("%zu frames taken, %llu skipped, %.1f%% non-zero pixels\n", pickup.count(),
+                static_cast<unsigned long long>(skipped),
+                pickup.count() > 0
+                        ? 100.0 * edgePixels /
+                                  (pickup.count() * static_cast<double>(reader.getWidth()) *
+                                   reader.getHeight())
+                        : 0.0);
+    return pickup.count() > 0 ? 0 : 1;
+}
@@ -25,12 +25,34 @@ class MainActivity : AppCompatActivity() {
     private lateinit var glRenderer: GLRenderer
 
     private var isProcessingEnabled = true
+    private var processingMode = FrameProcessor.MODE_CANNY
     private var fps: Double = 0.0
 
+    // Native output buffers, wrapped once; frames are exchanged by index
+    private var outputBuffers: Array<java.nio.ByteBuffer>? = null
+    private var cameraWidth = 0
+    private var cameraHeight = 0
+
+    // What the buffers hold: the native output size and format, not the camera size
+    private var outputWidth = 0
+    private var outputHeight = 0
+    private var outputRgb565 = false
+    private var droppedFrames = 0L
+
     companion object {
         private const val CAMERA_PERMISSION_REQUEST_CODE = 100
         private const val TAG = "EdgeDetectionViewer"
 
+        // One on screen, one waiting for the next draw, one being filled
+        private const val OUTPUT_BUFFER_COUNT = 3
+
+        // Native output formats (nativeSetOutputFormat)
+        private const val OUTPUT_FORMAT_RGBA = 0
+        private const val OUTPUT_FORMAT_RGB565 = 1
+
+        // Format frames are rendered in; RGB565 halves the upload
+        private const val OUTPUT_FORMAT = OUTPUT_FORMAT_RGBA
+
         init {
             // Load native library
             System.loadLibrary("edge_detection_native")
@@ -51,10 +73,8 @@ class MainActivity : AppCompatActivity() {
         binding.toggleProcessing.setOnClickListener {
             isProcessingEnabled = !isProcessingEnabled
             updateToggleButton()
-            frameProcessor.setProcessingMode(
-                if (isProcessingEnabled) FrameProcessor.MODE_CANNY
-                else FrameProcessor.MODE_RAW
-            )
+            processingMode = if (isProcessingEnabled) FrameProcessor.MODE_CANNY
+                             else FrameProcessor.MODE_RAW
         }
 
         // FPS display
@@ -208,16 +228,65 @@ class MainActivity : AppCompatActivity() {
             .show()
     }
 
+    /**
+     * Size the native processor and its output pool for a camera frame size
+     * The texture takes the output size and format the native side reports,
+     * which differ from the camera size once frames are rotated, scaled or
+     * packed as RGB565.
+     */
+    private fun configureOutput(width: Int, height: Int): Boolean {
+        outputBuffers = null
+        if (!frameProcessor.nativeInit(width, height)) {
+            Log.e(TAG, "Native init failed for ${width}x${height}")
+            return false
+        }
+
+        val size = frameProcessor.nativeSetTransform(0, false, 0, 0, 0, 0)
+        val frameBytes = frameProcessor.nativeSetOutputFormat(OUTPUT_FORMAT)
+        if (size == null || frameBytes == 0) {
+            Log.e(TAG, "Output configuration rejected")
+            return false
+        }
+
+        outputBuffers = frameProcessor.nativeCreateOutputBuffers(OUTPUT_BUFFER_COUNT)
+        outputWidth = size[0]
+        outputHeight = size[1]
+        outputRgb565 = OUTPUT_FORMAT == OUTPUT_FORMAT_RGB565
+        cameraWidth = width
+        cameraHeight = height
+        return outputBuffers != null
+    }
+
     private fun processFrame(imageData: ByteArray, width: Int, height: Int) {
         val startTime = System.nanoTime()
 
         try {
-            // Process frame through JNI
-            val processedData = frameProcessor.processFrame(imageData, width, height)
+            // Re-initialize, then recreate the native output pool when the camera size changes
+            if (outputBuffers == null || width != cameraWidth || height != cameraHeight) {
+                if (!configureOutput(width, height)) {
+                    return
+                }
+            }
+            val buffers = outputBuffers ?: run {
+                Log.w(TAG, "Output buffers unavailable")
+                return
+            }
+
+            // All buffers on screen or queued: the renderer is behind, skip this frame
+            val index = frameProcessor.nativeAcquireOutputBuffer()
+            if (index < 0) {
+                droppedFrames++
+                return
+            }
 
-            if (processedData != null) {
-                // Update OpenGL texture
-                glRenderer.updateTexture(processedData, width, height)
+            // Process frame through JNI straight into the native buffer
+            if (frameProcessor.nativeProcessFrameToBuffer(imageData, index, width, height,
+                                                          processingMode)) {
+                // Update OpenGL texture; the renderer releases the buffer after upload
+                glRenderer.updateTexture(buffers[index], index, outputWidth, outputHeight,
+                                         { released ->
+                                             frameProcessor.nativeReleaseOutputBuffer(released)
+                                         }, outputRgb565)
 
                 // Calculate FPS
                 val endTime = System.nanoTime()
@@ -232,7 +301,8 @@ class MainActivity : AppCompatActivity() {
                     }
                 }
             } else {
-                Log.w(TAG, "Frame processing returned null")
+                frameProcessor.nativeReleaseOutputBuffer(index)
+                Log.w(TAG, "Frame processing failed")
             }
         } catch (e: Exception) {
             Log.e(TAG, "Error processing frame", e)
@@ -258,7 +328,7 @@ class MainActivity : AppCompatActivity() {
     override fun onDestroy() {
         super.onDestroy()
         if (::frameProcessor.isInitialized) {
-            frameProcessor.release()
+            frameProcessor.nativeRelease()
         }
         if (::cameraController.isInitialized) {
             cameraController.close()
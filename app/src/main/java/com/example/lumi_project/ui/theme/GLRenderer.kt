@@ -35,6 +35,12 @@ class GLRenderer : GLSurfaceView.Renderer {
     private var frameData: ByteBuffer? = null
     private val frameLock = Object()
 
+    // Native pool buffer waiting for upload, handed back through pooledRelease
+    private var pooledData: ByteBuffer? = null
+    private var pooledIndex: Int = -1
+    private var pooledRelease: ((Int) -> Unit)? = null
+    private var pooledRgb565: Boolean = false
+
     companion object {
         private const val TAG = "GLRenderer"
 
@@ -128,6 +134,32 @@ class GLRenderer : GLSurfaceView.Renderer {
         // Clear screen
         GLES20.glClear(GLES20.GL_COLOR_BUFFER_BIT)
 
+        // A pooled frame is uploaded once, outside the lock: nobody else
+        // touches the buffer until it is released
+        var pooled: ByteBuffer? = null
+        var index = -1
+        var release: ((Int) -> Unit)? = null
+        var width = 0
+        var height = 0
+        var rgb565 = false
+        synchronized(frameLock) {
+            if (pooledData != null) {
+                pooled = pooledData
+                index = pooledIndex
+                release = pooledRelease
+                width = frameWidth
+                height = frameHeight
+                rgb565 = pooledRgb565
+                pooledData = null
+                pooledIndex = -1
+                pooledRelease = null
+            }
+        }
+        if (pooled != null) {
+            GLTextureHandler.updateTexture(textureId, pooled!!, width, height, rgb565)
+            release?.invoke(index)
+        }
+
         // Check if we have frame data
         synchronized(frameLock) {
             if (frameData != null && frameWidth > 0 && frameHeight > 0) {
@@ -199,4 +231,35 @@ class GLRenderer : GLSurfaceView.Renderer {
             frameData!!.position(0)
         }
     }
+
+    /**
+     * Update texture with a native pool buffer, without copying it
+     * Thread-safe method called from camera callback. The buffer is uploaded
+     * on the next draw and then handed back via [release]; a buffer replaced
+     * by a newer frame before it was drawn is handed back right away.
+     * [rgb565] marks frames rendered with the native RGB565 output format.
+     */
+    fun updateTexture(buffer: ByteBuffer, index: Int, width: Int, height: Int,
+                      release: (Int) -> Unit, rgb565: Boolean = false) {
+        var skippedIndex = -1
+        var skippedRelease: ((Int) -> Unit)? = null
+
+        synchronized(frameLock) {
+            if (pooledData != null) {
+                skippedIndex = pooledIndex
+                skippedRelease = pooledRelease
+            }
+            frameWidth = width
+            frameHeight = height
+            pooledData = buffer
+            pooledIndex = index
+            pooledRelease = release
+            pooledRgb565 = rgb565
+
+            // The pooled path replaces the copied one
+            frameData = null
+        }
+
+        skippedRelease?.invoke(skippedIndex)
+    }
 }
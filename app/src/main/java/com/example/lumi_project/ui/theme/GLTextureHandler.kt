@@ -62,11 +62,13 @@ object GLTextureHandler {
     /**
      * Update texture with new frame data
      * @param textureId OpenGL texture ID
-     * @param data RGBA pixel data
+     * @param data RGBA pixel data, or RGB565 if [rgb565] is set
      * @param width Frame width
      * @param height Frame height
+     * @param rgb565 Data is 16-bit 5-6-5 (half the upload bandwidth)
      */
-    fun updateTexture(textureId: Int, data: ByteBuffer, width: Int, height: Int) {
+    fun updateTexture(textureId: Int, data: ByteBuffer, width: Int, height: Int,
+                      rgb565: Boolean = false) {
         if (textureId == 0) {
             Log.e(TAG, "Invalid texture ID")
             return
@@ -75,16 +77,20 @@ object GLTextureHandler {
         // Bind texture
         GLES20.glBindTexture(GLES20.GL_TEXTURE_2D, textureId)
 
+        // 16-bit rows are only 2-byte aligned for odd widths
+        val format = if (rgb565) GLES20.GL_RGB else GLES20.GL_RGBA
+        GLES20.glPixelStorei(GLES20.GL_UNPACK_ALIGNMENT, if (rgb565) 2 else 4)
+
         // Upload pixel data
         GLES20.glTexImage2D(
             GLES20.GL_TEXTURE_2D,
             0,                          // Mipmap level
-            GLES20.GL_RGBA,             // Internal format
+            format,                     // Internal format
             width,
             height,
             0,                          // Border (must be 0)
-            GLES20.GL_RGBA,             // Format
-            GLES20.GL_UNSIGNED_BYTE,    // Type
+            format,                     // Format
+            if (rgb565) GLES20.GL_UNSIGNED_SHORT_5_6_5 else GLES20.GL_UNSIGNED_BYTE,
             data
         )
 
@@ -1,46 +1,33 @@
-import { useState } from "react";
+import { useRef } from "react";
+import { MODE_NAMES, streamUrl, useEdgeStream } from "./lib/edgeStream";
 
 /**
  * Edge Detection Viewer - Web Component
  *
- * Displays sample processed frames from the Android app
- * Demonstrates TypeScript + React integration
+ * Displays live processed frames streamed by the native host build
+ * (replay --serve PORT) over a loopback WebSocket
  */
 
-// Sample processed frames (simulated edge detection results)
-const sampleFrames = [
-  {
-    id: 1,
-    name: "Edge Detection - High Detail",
-    fps: 14.2,
-    resolution: "1280x720",
-    mode: "Canny Edge Detection",
-    // Sample base64 edge-detected image (1x1 placeholder - replace with actual)
-    imageData: "data:image/svg+xml,%3Csvg xmlns='http://www.w3.org/2000/svg' width='1280' height='720'%3E%3Crect width='1280' height='720' fill='%23000'/%3E%3Cpath d='M100,100 L1180,100 L1180,620 L100,620 Z M200,200 L1080,200 M200,300 L1080,300 M200,400 L1080,400 M200,500 L1080,500' stroke='%23fff' stroke-width='2' fill='none'/%3E%3Ccircle cx='640' cy='360' r='150' stroke='%23fff' stroke-width='3' fill='none'/%3E%3C/svg%3E",
-    description: "Real-time edge detection using OpenCV Canny algorithm with thresholds 50/150"
-  },
-  {
-    id: 2,
-    name: "Grayscale Mode",
-    fps: 18.5,
-    resolution: "1280x720",
-    mode: "Grayscale Conversion",
-    imageData: "data:image/svg+xml,%3Csvg xmlns='http://www.w3.org/2000/svg' width='1280' height='720'%3E%3Cdefs%3E%3ClinearGradient id='grad' x1='0%25' y1='0%25' x2='100%25' y2='100%25'%3E%3Cstop offset='0%25' style='stop-color:%23888;stop-opacity:1'/%3E%3Cstop offset='100%25' style='stop-color:%23333;stop-opacity:1'/%3E%3C/linearGradient%3E%3C/defs%3E%3Crect width='1280' height='720' fill='url(%23grad)'/%3E%3Ctext x='640' y='360' font-size='48' fill='%23fff' text-anchor='middle' font-family='Arial'%3EGrayscale Preview%3C/text%3E%3C/svg%3E",
-    description: "Grayscale conversion using OpenCV cvtColor (RGBA to GRAY)"
-  },
-  {
-    id: 3,
-    name: "Raw Camera Feed",
-    fps: 22.8,
-    resolution: "1280x720",
-    mode: "Pass-through",
-    imageData: "data:image/svg+xml,%3Csvg xmlns='http://www.w3.org/2000/svg' width='1280' height='720'%3E%3Cdefs%3E%3CradialGradient id='grad2'%3E%3Cstop offset='0%25' style='stop-color:%234CAF50;stop-opacity:1'/%3E%3Cstop offset='100%25' style='stop-color:%231976D2;stop-opacity:1'/%3E%3C/radialGradient%3E%3C/defs%3E%3Crect width='1280' height='720' fill='url(%23grad2)'/%3E%3Ctext x='640' y='360' font-size='48' fill='%23fff' text-anchor='middle' font-family='Arial'%3ERaw Camera%3C/text%3E%3C/svg%3E",
-    description: "Unprocessed camera frames (no OpenCV processing)"
-  }
-];
+const STATUS_STYLES = {
+  open: { dot: "bg-green-500 animate-pulse", text: "text-green-400", label: "Live" },
+  connecting: { dot: "bg-yellow-500 animate-pulse", text: "text-yellow-400", label: "Connecting" },
+  closed: { dot: "bg-red-500", text: "text-red-400", label: "Disconnected" },
+};
+
+const TARGET_FPS = 15;
+
+function formatBytes(bytes: number) {
+  if (bytes >= 1 << 20) return `${(bytes / (1 << 20)).toFixed(1)} MB`;
+  if (bytes >= 1 << 10) return `${(bytes / (1 << 10)).toFixed(1)} KB`;
+  return `${bytes} B`;
+}
 
 function App() {
-  const [selectedFrame, setSelectedFrame] = useState(sampleFrames[0]);
+  const url = streamUrl();
+  const canvas = useRef<HTMLCanvasElement>(null);
+  const { status, stats, fps, decodeMs } = useEdgeStream(url, canvas);
+  const statusStyle = STATUS_STYLES[status];
+  const mode = stats ? MODE_NAMES[stats.mode] ?? `Mode ${stats.mode}` : "Waiting for frames";
 
   return (
     <div className="min-h-screen bg-gradient-to-br from-gray-900 via-black to-gray-900 text-white">
@@ -60,8 +47,8 @@ function App() {
               <div className="text-right">
                 <div className="text-sm text-gray-400">Status</div>
                 <div className="flex items-center space-x-2">
-                  <div className="w-2 h-2 bg-green-500 rounded-full animate-pulse"></div>
-                  <span className="text-green-400 font-semibold">Active</span>
+                  <div className={`w-2 h-2 rounded-full ${statusStyle.dot}`}></div>
+                  <span className={`font-semibold ${statusStyle.text}`}>{statusStyle.label}</span>
                 </div>
               </div>
             </div>
@@ -77,10 +64,10 @@ function App() {
             <div className="bg-gray-800/50 backdrop-blur-sm rounded-2xl border border-gray-700 overflow-hidden">
               {/* Frame Display */}
               <div className="relative aspect-video bg-black">
-                <img
-                  src={selectedFrame.imageData}
-                  alt={selectedFrame.name}
+                <canvas
+                  ref={canvas}
                   className="w-full h-full object-contain"
+                  style={{ imageRendering: "pixelated" }}
                 />
 
                 {/* Overlay Info */}
@@ -89,14 +76,14 @@ function App() {
                     <div>
                       <div className="text-xs text-gray-400">FPS</div>
                       <div className="text-2xl font-bold text-green-400 font-mono">
-                        {selectedFrame.fps.toFixed(1)}
+                        {fps.toFixed(1)}
                       </div>
                     </div>
                     <div className="w-px h-10 bg-gray-600"></div>
                     <div>
                       <div className="text-xs text-gray-400">Resolution</div>
                       <div className="text-lg font-semibold font-mono">
-                        {selectedFrame.resolution}
+                        {stats ? `${stats.width}x${stats.height}` : "--"}
                       </div>
                     </div>
                   </div>
@@ -106,7 +93,7 @@ function App() {
                 <div className="absolute top-4 right-4 bg-purple-600/90 backdrop-blur-sm rounded-lg px-4 py-2 border border-purple-500">
                   <div className="text-xs text-purple-200">Mode</div>
                   <div className="text-sm font-semibold">
-                    {selectedFrame.mode}
+                    {mode}
                   </div>
                 </div>
               </div>
@@ -114,10 +101,12 @@ function App() {
               {/* Frame Details */}
               <div className="p-6 border-t border-gray-700">
                 <h3 className="text-xl font-semibold mb-2">
-                  {selectedFrame.name}
+                  {stats ? `Frame ${stats.frame}` : "No frames yet"}
                 </h3>
                 <p className="text-gray-400">
-                  {selectedFrame.description}
+                  {status === "open"
+                    ? `Streaming from ${url}`
+                    : `Waiting for ${url} - start the host build with: replay <input.yuv> <width> <height> --serve 8765`}
                 </p>
               </div>
             </div>
@@ -165,28 +154,25 @@ function App() {
           {/* Sidebar */}
           <div className="space-y-6">
 
-            {/* Frame Selector */}
+            {/* Stream Stats */}
             <div className="bg-gray-800/50 backdrop-blur-sm rounded-2xl border border-gray-700 p-6">
-              <h3 className="text-lg font-semibold mb-4">Sample Frames</h3>
-              <div className="space-y-3">
-                {sampleFrames.map((frame) => (
-                  <button
-                    key={frame.id}
-                    onClick={() => setSelectedFrame(frame)}
-                    className={`w-full text-left p-4 rounded-xl border-2 transition-all ${
-                      selectedFrame.id === frame.id
-                        ? "border-purple-500 bg-purple-900/30"
-                        : "border-gray-700 bg-gray-900/30 hover:border-gray-600"
-                    }`}
-                  >
-                    <div className="font-semibold text-sm mb-1">
-                      {frame.name}
-                    </div>
-                    <div className="flex items-center justify-between text-xs text-gray-400">
-                      <span>{frame.fps.toFixed(1)} FPS</span>
-                      <span>{frame.mode}</span>
-                    </div>
-                  </button>
+              <h3 className="text-lg font-semibold mb-4">Stream</h3>
+              <div className="space-y-3 text-sm">
+                {[
+                  ["Processing", stats ? `${stats.processMs.toFixed(2)} ms` : "--"],
+                  ["Average", stats ? `${stats.averageProcessMs.toFixed(2)} ms` : "--"],
+                  ["Publish copy", stats ? `${stats.publishMs.toFixed(2)} ms` : "--"],
+                  ["Encode", stats ? `${stats.encodeMs.toFixed(2)} ms` : "--"],
+                  ["Decode + draw", status === "open" ? `${decodeMs.toFixed(2)} ms` : "--"],
+                  ["Frame size", stats ? `${formatBytes(stats.encodedBytes)} / ${formatBytes(stats.rawBytes)}` : "--"],
+                  ["Server FPS", stats ? stats.streamFps.toFixed(1) : "--"],
+                  ["Dropped", stats ? `${stats.dropped}` : "--"],
+                  ["Clients", stats ? `${stats.clients}` : "--"],
+                ].map(([label, value]) => (
+                  <div key={label} className="flex items-center justify-between">
+                    <span className="text-gray-400">{label}</span>
+                    <span className="font-mono bg-gray-900 px-2 py-1 rounded">{value}</span>
+                  </div>
                 ))}
               </div>
             </div>
@@ -224,29 +210,29 @@ function App() {
               <div className="space-y-4">
                 <div>
                   <div className="flex justify-between text-sm mb-2">
-                    <span className="text-gray-300">Target FPS</span>
-                    <span className="font-semibold">15+ FPS</span>
+                    <span className="text-gray-300">Viewer FPS (target {TARGET_FPS}+)</span>
+                    <span className="font-semibold">{fps.toFixed(1)} FPS</span>
                   </div>
                   <div className="w-full bg-gray-700 rounded-full h-2">
-                    <div className="bg-gradient-to-r from-green-500 to-emerald-400 h-2 rounded-full" style={{width: "80%"}}></div>
+                    <div className="bg-gradient-to-r from-green-500 to-emerald-400 h-2 rounded-full" style={{width: `${Math.min(100, (fps / TARGET_FPS) * 100)}%`}}></div>
                   </div>
                 </div>
                 <div>
                   <div className="flex justify-between text-sm mb-2">
-                    <span className="text-gray-300">Memory Usage</span>
-                    <span className="font-semibold">~60 MB</span>
+                    <span className="text-gray-300">Native Scratch Memory</span>
+                    <span className="font-semibold">{stats ? formatBytes(stats.nativeBytes) : "--"}</span>
                   </div>
                   <div className="w-full bg-gray-700 rounded-full h-2">
-                    <div className="bg-gradient-to-r from-blue-500 to-cyan-400 h-2 rounded-full" style={{width: "45%"}}></div>
+                    <div className="bg-gradient-to-r from-blue-500 to-cyan-400 h-2 rounded-full" style={{width: stats ? `${Math.min(100, (stats.nativeBytes / (64 << 20)) * 100)}%` : "0%"}}></div>
                   </div>
                 </div>
                 <div>
                   <div className="flex justify-between text-sm mb-2">
-                    <span className="text-gray-300">CPU Usage</span>
-                    <span className="font-semibold">~35%</span>
+                    <span className="text-gray-300">Frame Budget Used</span>
+                    <span className="font-semibold">{stats ? `${((stats.averageProcessMs * TARGET_FPS) / 10).toFixed(0)}%` : "--"}</span>
                   </div>
                   <div className="w-full bg-gray-700 rounded-full h-2">
-                    <div className="bg-gradient-to-r from-purple-500 to-pink-400 h-2 rounded-full" style={{width: "35%"}}></div>
+                    <div className="bg-gradient-to-r from-purple-500 to-pink-400 h-2 rounded-full" style={{width: stats ? `${Math.min(100, (stats.averageProcessMs * TARGET_FPS) / 10)}%` : "0%"}}></div>
                   </div>
                 </div>
               </div>
@@ -0,0 +1,225 @@
+import { useEffect, useRef, useState, type RefObject } from 'react'
+
+/**
+ * Client for the native streaming server (app/src/main/cpp/stream_server.h)
+ *
+ * The server sends a JSON stats message followed by a binary "EDGF" frame
+ * for every frame it encodes. Frames are decoded straight into a reused
+ * ImageData and drawn on a canvas; React state only carries the stats.
+ */
+
+export const DEFAULT_STREAM_URL = 'ws://localhost:8765'
+
+const ENCODING_PACKED = 0
+const ENCODING_RLE = 1
+const ENCODING_GRAY = 2
+const HEADER_BYTES = 20
+
+export type ConnectionStatus = 'connecting' | 'open' | 'closed'
+
+export interface ServerStats {
+  frame: number
+  width: number
+  height: number
+  mode: number
+  framesProcessed: number
+  processMs: number
+  averageProcessMs: number
+  qualityLevel: number
+  nativeBytes: number
+  publishMs: number
+  encodeMs: number
+  encodedBytes: number
+  rawBytes: number
+  streamFps: number
+  clients: number
+  dropped: number
+}
+
+export interface StreamState {
+  status: ConnectionStatus
+  stats: ServerStats | null
+  fps: number       // Frames drawn per second, measured here
+  decodeMs: number  // Decode + draw time of the last frame
+}
+
+export const MODE_NAMES = [
+  'Pass-through',
+  'Grayscale Conversion',
+  'Canny Edge Detection',
+  'Sobel Gradient',
+  'Scharr Gradient',
+  'Laplacian of Gaussian',
+]
+
+/**
+ * Stream URL: ?ws=<url> overrides the default
+ */
+export function streamUrl(): string {
+  const param = new URLSearchParams(window.location.search).get('ws')
+  return param || DEFAULT_STREAM_URL
+}
+
+/**
+ * Decode one binary frame into image (resized when the frame size changes)
+ * @returns the image, or null if the message is not a valid frame
+ */
+export function decodeFrame(buffer: ArrayBuffer, image: ImageData | null): ImageData | null {
+  if (buffer.byteLength < HEADER_BYTES) {
+    return null
+  }
+  const view = new DataView(buffer)
+  const magic = String.fromCharCode(view.getUint8(0), view.getUint8(1), view.getUint8(2), view.getUint8(3))
+  if (magic !== 'EDGF' || view.getUint8(4) !== 1) {
+    return null
+  }
+
+  const encoding = view.getUint8(5)
+  const width = view.getUint32(8, true)
+  const height = view.getUint32(12, true)
+  const payload = new Uint8Array(buffer, HEADER_BYTES)
+  const pixels = width * height
+
+  if (!image || image.width !== width || image.height !== height) {
+    image = new ImageData(width, height)
+  }
+  const out = image.data
+
+  // Writes one gray value to RGBA, alpha opaque
+  const put = (i: number, value: number) => {
+    const o = i * 4
+    out[o] = value
+    out[o + 1] = value
+    out[o + 2] = value
+    out[o + 3] = 255
+  }
+
+  if (encoding === ENCODING_GRAY) {
+    if (payload.length < pixels) {
+      return null
+    }
+    for (let i = 0; i < pixels; i++) {
+      put(i, payload[i])
+    }
+  } else if (encoding === ENCODING_PACKED) {
+    const rowBytes = (width + 7) >> 3
+    if (payload.length < rowBytes * height) {
+      return null
+    }
+    for (let y = 0; y < height; y++) {
+      const row = y * rowBytes
+      for (let x = 0; x < width; x++) {
+        put(y * width + x, payload[row + (x >> 3)] & (0x80 >> (x & 7)) ? 255 : 0)
+      }
+    }
+  } else if (encoding === ENCODING_RLE) {
+    let i = 0
+    let offset = 0
+    let on = false
+    while (i < pixels && offset < payload.length) {
+      let run = 0
+      let shift = 0
+      let byte
+      do {
+        byte = payload[offset++]
+        run += (byte & 0x7f) * 2 ** shift
+        shift += 7
+      } while (byte & 0x80 && offset < payload.length)
+
+      const end = Math.min(pixels, i + run)
+      const value = on ? 255 : 0
+      for (; i < end; i++) {
+        put(i, value)
+      }
+      on = !on
+    }
+    for (; i < pixels; i++) {
+      put(i, 0)
+    }
+  } else {
+    return null
+  }
+
+  return image
+}
+
+/**
+ * Connect to the stream, draw frames on the canvas, reconnect when dropped
+ */
+export function useEdgeStream(url: string, canvas: RefObject<HTMLCanvasElement>): StreamState {
+  const [state, setState] = useState<StreamState>({ status: 'connecting', stats: null, fps: 0, decodeMs: 0 })
+  const image = useRef<ImageData | null>(null)
+
+  useEffect(() => {
+    let socket: WebSocket | null = null
+    let retry: number | undefined
+    let disposed = false
+
+    let latestStats: ServerStats | null = null
+    let frames = 0
+    let fps = 0
+    let decodeMs = 0
+    let windowStart = performance.now()
+
+    // Publish to React a few times per second, not once per frame
+    const tick = window.setInterval(() => {
+      const now = performance.now()
+      fps = (frames * 1000) / (now - windowStart)
+      frames = 0
+      windowStart = now
+      setState((previous) => ({ ...previous, stats: latestStats, fps, decodeMs }))
+    }, 500)
+
+    const connect = () => {
+      setState((previous) => ({ ...previous, status: 'connecting' }))
+      socket = new WebSocket(url)
+      socket.binaryType = 'arraybuffer'
+
+      socket.onopen = () => setState((previous) => ({ ...previous, status: 'open' }))
+
+      socket.onmessage = (event) => {
+        if (typeof event.data === 'string') {
+          const message = JSON.parse(event.data)
+          if (message.type === 'stats') {
+            latestStats = message as ServerStats
+          }
+          return
+        }
+
+        const start = performance.now()
+        const decoded = decodeFrame(event.data as ArrayBuffer, image.current)
+        const target = canvas.current
+        if (!decoded || !target) {
+          return
+        }
+        image.current = decoded
+        if (target.width !== decoded.width || target.height !== decoded.height) {
+          target.width = decoded.width
+          target.height = decoded.height
+        }
+        target.getContext('2d')?.putImageData(decoded, 0, 0)
+        decodeMs = performance.now() - start
+        frames++
+      }
+
+      socket.onclose = () => {
+        socket = null
+        if (!disposed) {
+          setState((previous) => ({ ...previous, status: 'closed' }))
+          retry = window.setTimeout(connect, 1000)
+        }
+      }
+    }
+
+    connect()
+
+    return () => {
+      disposed = true
+      window.clearInterval(tick)
+      window.clearTimeout(retry)
+      socket?.close()
+    }
+  }, [url, canvas])
+
+  return state
+}